@@ -0,0 +1,755 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "astring.h"
+#include "json.h"
+#include "mpmc.h"
+#include "querystring.h"
+#include "urlencode.h"
+
+/** The time each measured run aims for, in nanoseconds. */
+#define BENCH_TARGET_NS 50000000LL
+
+/** The number of measured runs, the fastest is reported. */
+#define BENCH_RUNS 5
+
+/** The slowdown against the baseline reported as a regression, in percent. */
+#define BENCH_TOLERANCE 10.0
+
+/** The size of the generated wikitext. */
+#define BENCH_WIKITEXT_BYTES (128 * 1024)
+
+/** The most benchmarks a baseline may hold. */
+#define BENCH_MAX 64
+
+typedef void (*bench_fn_t)(size_t iters);
+
+typedef struct {
+    const char* name;
+    bench_fn_t fn;
+    const size_t* input;        /**< The input bytes per op, or NULL if throughput is not meaningful. */
+} bench_t;
+
+typedef struct {
+    const char* name;
+    double ns_per_op;
+    double bytes_per_op;
+    double allocs_per_op;
+    double mb_per_s;
+} bench_result_t;
+
+/* allocation counting, the bench target links with --wrap for these */
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, count * size, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+/* inputs */
+
+/** Keeps results alive so the compiler cannot drop the measured work. */
+static volatile size_t sink;
+
+static const char* short_value = "Main Page";
+static astring_t* title;
+static astring_t* wikitext;
+static astring_t* encoded;
+static astring_t* query;
+static astring_t* scratch;
+static querystring_t* qs;
+static char* parse_buf;
+static astring_t* json_doc;
+static size_t wikitext_bytes;
+static size_t encoded_bytes;
+static size_t json_bytes;
+
+/**
+ * @brief A small deterministic generator, so every run sees the same input.
+ * 
+ * @internal
+*/
+static uint32_t next_random(void) {
+    static uint64_t state = 0x2545F4914F6CDD1DULL;
+
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (uint32_t)(state >> 16);
+}
+
+/**
+ * @brief Build a page title of about 256 bytes mixing scripts, spaces and punctuation.
+ * 
+ * @internal
+*/
+static astring_t* make_title(void) {
+    static const char* parts[] = {
+        "\xC5\x8Ckami ", "\xE6\x9D\xB1\xE6\x96\xB9Project/", "\xE3\x82\xAD\xE3\x83\xA3\xE3\x83\xA9 ",
+        "(\xCE\x95\xCE\xBB\xCE\xBB\xCE\xB7\xCE\xBD\xCE\xB9\xCE\xBA\xCE\xAC) ", "\xE2\x80\x93 ", "Un\xC3\xAF" "c\xC3\xB6" "de & Co. ",
+        "Season 2: Episode 14 ", "\xF0\x9F\x8E\xAE ", "\"Quoted\" ", "100% ",
+    };
+    astring_t* str = astring_new(1);
+
+    while (str->len < 256) astring_append(str, parts[next_random() % (sizeof(parts) / sizeof(parts[0]))]);
+    return str;
+}
+
+/**
+ * @brief Build wikitext with links, templates, tables, markup and non-ASCII text.
+ * 
+ * @internal
+*/
+static astring_t* make_wikitext(size_t bytes) {
+    static const char* words[] = {
+        "the", "wiki", "character", "episode", "season", "appears", "in", "and", "of", "\xC3\xA9t\xC3\xA9",
+        "\xE6\x9D\xB1\xE6\x96\xB9", "\xD0\xBC\xD0\xB8\xD1\x80", "game", "first", "later", "battle",
+    };
+    static const char* markup[] = {
+        "[[Main Page|home]] ", "{{Infobox character|name=Reimu|age=?}}\n", "'''bold''' ", "''italic'' ",
+        "\n{| class=\"wikitable\"\n|-\n| a || b || c\n|}\n", "<ref>{{cite web|url=https://example.org/a?b=c&d=e}}</ref> ",
+        "\n== Section ==\n", "[[Category:Characters]]\n", "&nbsp;", "100% ",
+    };
+    astring_t* str = astring_new(bytes + 64);
+    size_t word_count = sizeof(words) / sizeof(words[0]);
+    size_t markup_count = sizeof(markup) / sizeof(markup[0]);
+
+    while (str->len < bytes) {
+        uint32_t r = next_random();
+
+        if (r % 8 == 0) {
+            astring_append(str, markup[(r >> 3) % markup_count]);
+        } else {
+            astring_append(str, words[(r >> 3) % word_count]);
+            astring_append(str, (r % 29 == 0) ? ".\n" : " ");
+        }
+    }
+
+    return str;
+}
+
+/**
+ * @brief Append text as the body of a JSON string.
+ * 
+ * @internal
+*/
+static void append_escaped(astring_t* dest, const char* src, size_t len) {
+    size_t i = 0;
+    for (; i < len; i++) {
+        if (src[i] == '"') astring_append(dest, "\\\"");
+        else if (src[i] == '\\') astring_append(dest, "\\\\");
+        else if (src[i] == '\n') astring_append(dest, "\\n");
+        else astring_appendn(dest, &src[i], 1);
+    }
+}
+
+static void inputs_new(void) {
+    title = make_title();
+    wikitext = make_wikitext(BENCH_WIKITEXT_BYTES);
+    encoded = urlencode(wikitext);
+    scratch = astring_new(1);
+
+    qs = querystring_new();
+    qs = querystring_addk(qs, APIKEY_ACTION, "query");
+    qs = querystring_addk(qs, APIKEY_TITLES, title->raw);
+    qs = querystring_addk(qs, APIKEY_PROP, "revisions|info");
+    qs = querystring_addk(qs, APIKEY_RVPROP, "content|timestamp");
+    qs = querystring_addk(qs, APIKEY_FORMAT, "json");
+    qs = querystring_addk(qs, APIKEY_FORMATVERSION, "2");
+    qs = querystring_addk(qs, APIKEY_CONTINUE, "");
+    qs = querystring_addk(qs, APIKEY_MAXLAG, "5");
+
+    query = querystring_tostring(qs);
+    parse_buf = malloc(query->len + 1);
+
+    // a response to a revisions query for 8 pages, each holding a slice of the wikitext
+    json_doc = astring_new(BENCH_WIKITEXT_BYTES + 1024);
+    astring_append(json_doc, "{\"batchcomplete\":true,\"query\":{\"pages\":[");
+
+    size_t i = 0;
+    for (; i < 8; i++) {
+        astring_append(json_doc, (i > 0) ? ",{\"title\":\"" : "{\"title\":\"");
+        append_escaped(json_doc, title->raw, title->len);
+        astring_append(json_doc, "\",\"revisions\":[{\"content\":\"");
+        append_escaped(json_doc, wikitext->raw + i * (BENCH_WIKITEXT_BYTES / 8), BENCH_WIKITEXT_BYTES / 8);
+        astring_append(json_doc, "\"}]}");
+    }
+
+    astring_append(json_doc, "]}}");
+
+    wikitext_bytes = wikitext->len;
+    encoded_bytes = encoded->len;
+    json_bytes = json_doc->len;
+}
+
+static void inputs_free(void) {
+    astring_free(title);
+    astring_free(wikitext);
+    astring_free(encoded);
+    astring_free(scratch);
+    astring_free(query);
+    querystring_free(qs, true);
+    free(parse_buf);
+    astring_free(json_doc);
+}
+
+/* benchmarks */
+
+static void bench_astring_from_short(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        astring_t* str = astring_from(short_value);
+        sink += str->len;
+        astring_free(str);
+    }
+}
+
+static void bench_astring_append_params(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        astring_t* str = astring_new(1);
+        astring_append(str, "action=query&titles=");
+        astring_append(str, short_value);
+        astring_append(str, "&prop=revisions&rvprop=content");
+        astring_append(str, "&format=json&formatversion=2");
+        sink += str->len;
+        astring_free(str);
+    }
+}
+
+static void bench_astring_append_wikitext(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        astring_t* str = astring_new(1);
+
+        // chunked like a network read, so growth is exercised
+        size_t pos = 0;
+        for (; pos < wikitext->len; pos += 16384) {
+            size_t len = (wikitext->len - pos < 16384) ? wikitext->len - pos : 16384;
+            astring_appendn(str, wikitext->raw + pos, len);
+        }
+
+        sink += str->len;
+        astring_free(str);
+    }
+}
+
+static void bench_astring_slice_title(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        astring_t* str = astring_slice(title, 16, title->len - 16);
+        sink += str->len;
+        astring_free(str);
+    }
+}
+
+static void bench_astring_containss_wikitext(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) sink += astring_containss(wikitext, "{{Infobox location");
+}
+
+static void bench_astring_containsc_wikitext(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) sink += astring_containsc(wikitext, '\x01');
+}
+
+static void bench_astring_findallc_wikitext(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        size_t count = 0;
+        size_t* indices = astring_findallc(wikitext, '|', &count);
+        sink += count;
+        astring_findallc_free(indices, count);
+    }
+}
+
+static void bench_urlencode_short(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        scratch->len = 0;
+        urlencode_append(scratch, short_value, strlen(short_value));
+        sink += scratch->len;
+    }
+}
+
+static void bench_urlencode_title(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        scratch->len = 0;
+        urlencode_into(scratch, title);
+        sink += scratch->len;
+    }
+}
+
+static void bench_urlencode_wikitext(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        scratch->len = 0;
+        urlencode_into(scratch, wikitext);
+        sink += scratch->len;
+    }
+}
+
+static void bench_urldecode_wikitext(size_t iters) {
+    astring_reserve(scratch, encoded->len + 1);
+
+    size_t i = 0;
+    for (; i < iters; i++) sink += urldecode_raw(scratch->raw, encoded->raw, encoded->len, false);
+}
+
+static void bench_querystring_tostring(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        astring_t* str = querystring_tostring(qs);
+        sink += str->len;
+        astring_free(str);
+    }
+}
+
+static void bench_querystring_tostring_into(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        scratch->len = 0;
+        querystring_tostring_into(qs, scratch);
+        sink += scratch->len;
+    }
+}
+
+static void bench_querystring_canonical(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        scratch->len = 0;
+        querystring_canonical_into(qs, scratch);
+        sink += scratch->len;
+    }
+}
+
+static void bench_querystring_parse(size_t iters) {
+    size_t i = 0;
+    for (; i < iters; i++) {
+        // the parser decodes in place, so every op starts from a fresh copy
+        memcpy(parse_buf, query->raw, query->len + 1);
+        querystring_t* parsed = querystring_parse(parse_buf, query->len);
+        sink += parsed->count;
+        querystring_free(parsed, true);
+    }
+}
+
+static void bench_querystring_parse_in(size_t iters) {
+    arena_t* arena = arena_new(4096);
+
+    size_t i = 0;
+    for (; i < iters; i++) {
+        memcpy(parse_buf, query->raw, query->len + 1);
+        querystring_t* parsed = querystring_parse_in(arena, parse_buf, query->len);
+        sink += parsed->count;
+        arena_reset(arena);
+    }
+
+    arena_free(arena);
+}
+
+static void count_event(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    sink += ev->len;
+}
+
+static void bench_json_parse(size_t iters) {
+    json_parser_t* parser = json_new();
+    json_subscribe(parser, "query.pages[].revisions[].content", count_event, NULL);
+
+    size_t i = 0;
+    for (; i < iters; i++) {
+        json_reset(parser);
+        json_feed(parser, json_doc->raw, json_doc->len);
+        json_finish(parser);
+    }
+
+    json_free(parser);
+}
+
+/* mpmc throughput, each op is one item passed from a producer to a consumer */
+
+typedef struct {
+    mpmc_t* queue;
+    size_t items;
+    bool produce;
+} mpmc_role_t;
+
+static void* mpmc_worker(void* arg) {
+    mpmc_role_t* role = arg;
+    void* batch[8];
+    size_t done = 0;
+
+    while (done < role->items) {
+        size_t want = (role->items - done < 8) ? role->items - done : 8;
+        size_t n;
+
+        if (role->produce) {
+            size_t k = 0;
+            for (; k < want; k++) batch[k] = (void*)(uintptr_t)(done + k + 1);
+            n = mpmc_pushn(role->queue, batch, want);
+        } else {
+            n = mpmc_popn(role->queue, batch, want);
+        }
+
+        // give the other side the core rather than spin when oversubscribed
+        if (n == 0) sched_yield();
+        done += n;
+    }
+
+    return NULL;
+}
+
+static void bench_mpmc(size_t iters, size_t threads) {
+    mpmc_t* queue = mpmc_new(1024);
+
+    if (threads == 1) {
+        void* batch[8];
+        size_t i = 0;
+
+        for (; i < iters; i += 8) {
+            size_t k = 0;
+            for (; k < 8; k++) batch[k] = (void*)(uintptr_t)(i + k + 1);
+            mpmc_pushn(queue, batch, 8);
+            sink += mpmc_popn(queue, batch, 8);
+        }
+
+        mpmc_free(queue);
+        return;
+    }
+
+    size_t pairs = threads / 2;
+    size_t per = iters / pairs + 1;
+    pthread_t tids[32];
+    mpmc_role_t roles[32];
+    size_t i = 0;
+
+    for (; i < threads; i++) {
+        roles[i].queue = queue;
+        roles[i].items = per;
+        roles[i].produce = (i % 2 == 0);
+        pthread_create(&tids[i], NULL, mpmc_worker, &roles[i]);
+    }
+
+    for (i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+    mpmc_free(queue);
+}
+
+static void bench_mpmc_1(size_t iters) { bench_mpmc(iters, 1); }
+static void bench_mpmc_2(size_t iters) { bench_mpmc(iters, 2); }
+static void bench_mpmc_4(size_t iters) { bench_mpmc(iters, 4); }
+static void bench_mpmc_8(size_t iters) { bench_mpmc(iters, 8); }
+static void bench_mpmc_16(size_t iters) { bench_mpmc(iters, 16); }
+static void bench_mpmc_32(size_t iters) { bench_mpmc(iters, 32); }
+
+static bench_t benches[] = {
+    { "astring_from/short", bench_astring_from_short, NULL },
+    { "astring_append/params", bench_astring_append_params, NULL },
+    { "astring_appendn/wikitext", bench_astring_append_wikitext, &wikitext_bytes },
+    { "astring_slice/title", bench_astring_slice_title, NULL },
+    { "astring_containss/wikitext", bench_astring_containss_wikitext, &wikitext_bytes },
+    { "astring_containsc/wikitext", bench_astring_containsc_wikitext, &wikitext_bytes },
+    { "astring_findallc/wikitext", bench_astring_findallc_wikitext, &wikitext_bytes },
+    { "urlencode/short", bench_urlencode_short, NULL },
+    { "urlencode/title", bench_urlencode_title, NULL },
+    { "urlencode/wikitext", bench_urlencode_wikitext, &wikitext_bytes },
+    { "urldecode/wikitext", bench_urldecode_wikitext, &encoded_bytes },
+    { "querystring_tostring/8", bench_querystring_tostring, NULL },
+    { "querystring_tostring_into/8", bench_querystring_tostring_into, NULL },
+    { "querystring_canonical/8", bench_querystring_canonical, NULL },
+    { "querystring_parse/8", bench_querystring_parse, NULL },
+    { "querystring_parse_in/8", bench_querystring_parse_in, NULL },
+    { "json_parse/pages", bench_json_parse, &json_bytes },
+    { "mpmc/threads=1", bench_mpmc_1, NULL },
+    { "mpmc/threads=2", bench_mpmc_2, NULL },
+    { "mpmc/threads=4", bench_mpmc_4, NULL },
+    { "mpmc/threads=8", bench_mpmc_8, NULL },
+    { "mpmc/threads=16", bench_mpmc_16, NULL },
+    { "mpmc/threads=32", bench_mpmc_32, NULL },
+};
+
+/* harness */
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Time a benchmark, growing the iteration count until a run takes the target time.
+ * 
+ * @internal
+*/
+static bench_result_t measure(const bench_t* bench, int64_t target_ns) {
+    bench_result_t result;
+    size_t iters = 1;
+    int64_t elapsed = 0;
+
+    // calibrate on a tenth of the target so the measured runs are not dominated by warm-up
+    while (iters < ((size_t)1 << 40)) {
+        int64_t start = now_ns();
+        bench->fn(iters);
+        elapsed = now_ns() - start;
+
+        if (elapsed >= target_ns / 10) break;
+        iters *= 2;
+    }
+
+    iters = (size_t)((double)iters * (double)target_ns / (double)(elapsed > 0 ? elapsed : 1)) + 1;
+
+    double best = -1;
+    size_t allocs = 0;
+    size_t bytes = 0;
+    int run = 0;
+
+    for (; run < BENCH_RUNS; run++) {
+        size_t count_before = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+        size_t bytes_before = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+        int64_t start = now_ns();
+
+        bench->fn(iters);
+
+        double ns = (double)(now_ns() - start) / (double)iters;
+        allocs = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED) - count_before;
+        bytes = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED) - bytes_before;
+
+        if (best < 0 || ns < best) best = ns;
+    }
+
+    result.name = bench->name;
+    result.ns_per_op = best;
+    result.bytes_per_op = (double)bytes / (double)iters;
+    result.allocs_per_op = (double)allocs / (double)iters;
+    result.mb_per_s = (bench->input != NULL) ? (double)*bench->input / best * 1e9 / (1024.0 * 1024.0) : 0;
+    return result;
+}
+
+static bool write_json(const char* path, const bench_result_t* results, size_t count) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) return false;
+
+    fprintf(f, "{\"benchmarks\":[\n");
+
+    size_t i = 0;
+    for (; i < count; i++) {
+        fprintf(f, "  {\"name\":\"%s\",\"ns_per_op\":%.3f,\"bytes_per_op\":%.3f,\"allocs_per_op\":%.4f,\"mb_per_s\":%.1f}%s\n",
+            results[i].name, results[i].ns_per_op, results[i].bytes_per_op, results[i].allocs_per_op, results[i].mb_per_s,
+            (i + 1 < count) ? "," : "");
+    }
+
+    fprintf(f, "]}\n");
+    return fclose(f) == 0;
+}
+
+typedef struct {
+    astring_t* names[BENCH_MAX];
+    double ns[BENCH_MAX];
+    size_t count;
+} baseline_t;
+
+static void on_baseline_name(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    baseline_t* baseline = userdata;
+
+    if (baseline->count == BENCH_MAX) return;
+    if (baseline->names[baseline->count] == NULL) baseline->names[baseline->count] = astring_new(1);
+
+    // strings arrive in fragments, the name is complete once more is false
+    astring_appendn(baseline->names[baseline->count], ev->data, ev->len);
+}
+
+static void on_baseline_ns(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    baseline_t* baseline = userdata;
+
+    if (baseline->count == BENCH_MAX || baseline->names[baseline->count] == NULL) return;
+
+    char number[64];
+    size_t len = (ev->len < sizeof(number) - 1) ? ev->len : sizeof(number) - 1;
+    memcpy(number, ev->data, len);
+    number[len] = '\0';
+
+    baseline->ns[baseline->count++] = strtod(number, NULL);
+}
+
+static bool read_baseline(const char* path, baseline_t* baseline, bool* missing) {
+    FILE* f = fopen(path, "r");
+    *missing = (f == NULL && errno == ENOENT);
+    if (f == NULL) return false;
+
+    json_parser_t* parser = json_new();
+    json_subscribe(parser, "benchmarks[].name", on_baseline_name, baseline);
+    json_subscribe(parser, "benchmarks[].ns_per_op", on_baseline_ns, baseline);
+
+    char buf[4096];
+    size_t n;
+    bool ok = true;
+
+    while (ok && (n = fread(buf, 1, sizeof(buf), f)) > 0) ok = json_feed(parser, buf, n);
+    ok = ok && json_finish(parser);
+
+    json_free(parser);
+    fclose(f);
+    return ok;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [--filter SUBSTR] [--json FILE] [--baseline FILE] [--save-baseline] [--tolerance PCT] [--quick]\n"
+        "  --baseline FILE   compare against FILE, and create it if it does not exist\n"
+        "  --save-baseline   overwrite the baseline with this run, even if it cannot be read\n"
+        "  --tolerance PCT   the slowdown reported as a regression, default %.0f\n"
+        "  --quick           shorter runs, for a smoke test\n",
+        argv0, BENCH_TOLERANCE);
+}
+
+int main(int argc, char** argv) {
+    const char* filter = NULL;
+    const char* json_path = NULL;
+    const char* baseline_path = NULL;
+    bool save_baseline = false;
+    double tolerance = BENCH_TOLERANCE;
+    int64_t target_ns = BENCH_TARGET_NS;
+    int arg = 1;
+
+    for (; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--filter") == 0 && arg + 1 < argc) filter = argv[++arg];
+        else if (strcmp(argv[arg], "--json") == 0 && arg + 1 < argc) json_path = argv[++arg];
+        else if (strcmp(argv[arg], "--baseline") == 0 && arg + 1 < argc) baseline_path = argv[++arg];
+        else if (strcmp(argv[arg], "--save-baseline") == 0) save_baseline = true;
+        else if (strcmp(argv[arg], "--tolerance") == 0 && arg + 1 < argc) tolerance = strtod(argv[++arg], NULL);
+        else if (strcmp(argv[arg], "--quick") == 0) target_ns = BENCH_TARGET_NS / 10;
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // an unreadable baseline is reported before the run rather than overwritten after it
+    baseline_t baseline;
+    bool have_baseline = false;
+    memset(&baseline, 0, sizeof(baseline));
+
+    if (baseline_path != NULL && save_baseline == false) {
+        bool missing;
+        have_baseline = read_baseline(baseline_path, &baseline, &missing);
+
+        if (have_baseline == false && missing == false) {
+            fprintf(stderr, "cannot read baseline %s, use --save-baseline to replace it\n", baseline_path);
+            for (arg = 0; arg < BENCH_MAX; arg++) astring_free(baseline.names[arg]);
+            return 2;
+        }
+    }
+
+    inputs_new();
+
+    size_t count = sizeof(benches) / sizeof(benches[0]);
+    bench_result_t results[sizeof(benches) / sizeof(benches[0])];
+    size_t ran = 0;
+    size_t b = 0;
+
+    printf("%-30s %14s %12s %12s %10s\n", "benchmark", "ns/op", "B/op", "allocs/op", "MB/s");
+
+    for (; b < count; b++) {
+        if (filter != NULL && strstr(benches[b].name, filter) == NULL) continue;
+
+        results[ran] = measure(&benches[b], target_ns);
+        printf("%-30s %14.1f %12.1f %12.3f %10.1f\n", results[ran].name, results[ran].ns_per_op,
+            results[ran].bytes_per_op, results[ran].allocs_per_op, results[ran].mb_per_s);
+        fflush(stdout);
+        ran++;
+    }
+
+    int status = 0;
+
+    if (json_path != NULL && write_json(json_path, results, ran) == false) {
+        fprintf(stderr, "cannot write %s\n", json_path);
+        status = 2;
+    }
+
+    if (baseline_path != NULL) {
+        if (have_baseline == false) {
+            if (write_json(baseline_path, results, ran)) {
+                printf("\nbaseline written to %s\n", baseline_path);
+            } else {
+                fprintf(stderr, "cannot write %s\n", baseline_path);
+                status = 2;
+            }
+        } else {
+            size_t regressions = 0;
+            printf("\n%-30s %14s %14s %9s\n", "against baseline", "before", "now", "change");
+
+            for (b = 0; b < ran; b++) {
+                size_t k = 0;
+                for (; k < baseline.count; k++) {
+                    if (astring_eqs(baseline.names[k], results[b].name) == false) continue;
+
+                    double change = (results[b].ns_per_op / baseline.ns[k] - 1.0) * 100.0;
+                    bool regressed = change > tolerance;
+                    printf("%-30s %14.1f %14.1f %+8.1f%%%s\n", results[b].name, baseline.ns[k], results[b].ns_per_op, change, regressed ? "  REGRESSION" : "");
+
+                    if (regressed) regressions++;
+                    break;
+                }
+            }
+
+            if (regressions > 0) {
+                printf("\n%zu regression(s) beyond %.0f%%\n", regressions, tolerance);
+                status = 1;
+            }
+        }
+    }
+
+    for (b = 0; b < BENCH_MAX; b++) astring_free(baseline.names[b]);
+
+    inputs_free();
+    return status;
+}
\ No newline at end of file
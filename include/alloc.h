@@ -0,0 +1,80 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** What an allocation is for, so hooks can route it and the counters can tell the kinds apart. */
+typedef enum {
+    ALLOC_ASTRING_BUFFER,       /**< The character buffer of an astring that outgrew its inline buffer. */
+    ALLOC_ASTRING_HEADER,       /**< An astring_t itself. */
+    ALLOC_ASTRING_INDICES,      /**< The index array returned by astring_findallc. */
+    ALLOC_QUERYPAIR,            /**< A querypair_t. */
+    ALLOC_PAIR_ARRAY,           /**< A querystring's pair array, hash index or sort scratch. */
+    ALLOC_QUERYSTRING,          /**< A querystring_t itself. */
+    ALLOC_CATEGORIES
+} alloc_category_t;
+
+/**
+ * The functions heap allocations of astrings and querystrings go through.
+ * Frees and reallocations are sized, as with jemalloc's sdallocx or
+ * mimalloc's mi_free_size, so hooks need no header of their own to know the
+ * size of a block. A hook may route categories to different heaps, as long
+ * as it frees a block the way it allocated it.
+ */
+typedef struct {
+    void* (*malloc)(void* ctx, alloc_category_t category, size_t size);
+    void* (*calloc)(void* ctx, alloc_category_t category, size_t size);
+    void* (*realloc)(void* ctx, alloc_category_t category, void* ptr, size_t old_size, size_t new_size);
+    void (*free)(void* ctx, alloc_category_t category, void* ptr, size_t size);
+    void* ctx;                  /**< Passed through to every hook. */
+} alloc_hooks_t;
+
+/** The allocation counters of one category, updated atomically. */
+typedef struct {
+    uint64_t allocs;            /**< The number of malloc and calloc calls, and reallocs from nothing. */
+    uint64_t reallocs;          /**< The number of realloc calls resizing an existing block. */
+    uint64_t frees;             /**< The number of free calls. */
+    uint64_t bytes;             /**< The bytes requested by allocations, plus the growth of reallocations. */
+    uint64_t live;              /**< The bytes currently allocated. */
+    uint64_t peak;              /**< The most bytes allocated at once. */
+} alloc_stats_t;
+
+void alloc_sethooks(const alloc_hooks_t* hooks);
+alloc_hooks_t alloc_gethooks(void);
+void* alloc_malloc(alloc_category_t category, size_t size);
+void* alloc_calloc(alloc_category_t category, size_t size);
+void* alloc_realloc(alloc_category_t category, void* ptr, size_t old_size, size_t new_size);
+void alloc_free(alloc_category_t category, void* ptr, size_t size);
+void alloc_setcounting(bool enabled);
+bool alloc_counting(void);
+void alloc_getstats(alloc_category_t category, alloc_stats_t* stats);
+void alloc_resetstats(void);
+const char* alloc_category_name(alloc_category_t category);
+
+#endif // __ALLOC_H__
@@ -0,0 +1,105 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __APIKEY_H__
+#define __APIKEY_H__
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "astring.h"
+
+/**
+ * Interned MediaWiki API parameter names.
+ *
+ * Each entry is X(NAME, "name", length, hash) where hash is
+ * astring_hashraw("name", length). Every key is made of unreserved characters,
+ * so its urlencoded form is the key itself. When adding a key, compute its
+ * hash with astring_hashraw.
+ */
+#define APIKEY_LIST(X) \
+    X(ACTION,         "action",          6u, 0x0d16965894c58f39ULL) \
+    X(TITLES,         "titles",          6u, 0x9f2bad6ce9b73540ULL) \
+    X(PAGEIDS,        "pageids",         7u, 0xf6ec273c9cdfeff1ULL) \
+    X(REVIDS,         "revids",          6u, 0x7c713278934e8dacULL) \
+    X(PROP,           "prop",            4u, 0x49a88053087caa48ULL) \
+    X(LIST,           "list",            4u, 0x4e5caa3e70f6f4aaULL) \
+    X(META,           "meta",            4u, 0x35952c72cf9a9c97ULL) \
+    X(GENERATOR,      "generator",       9u, 0x309c8f5e3cf4edffULL) \
+    X(REDIRECTS,      "redirects",       9u, 0x3cd8f0f600a6ae57ULL) \
+    X(CONVERTTITLES,  "converttitles",  13u, 0x5254aa8dbf647a8dULL) \
+    X(CONTINUE,       "continue",        8u, 0x46e2543c74c68245ULL) \
+    X(RVPROP,         "rvprop",          6u, 0xfdf0a71935cc43e0ULL) \
+    X(RVSLOTS,        "rvslots",         7u, 0x37161b41106fd20eULL) \
+    X(RVLIMIT,        "rvlimit",         7u, 0x04a42d5dcca160a5ULL) \
+    X(RVCONTINUE,     "rvcontinue",     10u, 0x4b2040b837c49920ULL) \
+    X(RVSTART,        "rvstart",         7u, 0x9c10b1e607743a0fULL) \
+    X(RVEND,          "rvend",           5u, 0x2f471079304a9455ULL) \
+    X(RVDIR,          "rvdir",           5u, 0x60c048b8b0dc832aULL) \
+    X(RVSECTION,      "rvsection",       9u, 0x6db770cfa02dcb46ULL) \
+    X(FORMAT,         "format",          6u, 0x486587f36d78fc68ULL) \
+    X(FORMATVERSION,  "formatversion",  13u, 0xfeea6088bb32d47aULL) \
+    X(MAXLAG,         "maxlag",          6u, 0xbca1d325766f2cdeULL) \
+    X(ASSERT,         "assert",          6u, 0xf255522d9dc7f334ULL) \
+    X(ERRORFORMAT,    "errorformat",    11u, 0xaa63b60d00141b2fULL) \
+    X(UTF8,           "utf8",            4u, 0xd64531d95dade0efULL) \
+    X(TOKEN,          "token",           5u, 0x39befdbd3775bf9dULL) \
+    X(TITLE,          "title",           5u, 0xbe220e03fccfdbe6ULL) \
+    X(TEXT,           "text",            4u, 0xbf6142c9d99229baULL) \
+    X(SUMMARY,        "summary",         7u, 0xa92c8ebbd95c26b9ULL) \
+    X(BOT,            "bot",             3u, 0x9a06f3eed3504284ULL) \
+    X(MINOR,          "minor",           5u, 0xf43b1e8276917609ULL) \
+    X(NOCREATE,       "nocreate",        8u, 0xdf3baafc0d30cb53ULL) \
+    X(BASETIMESTAMP,  "basetimestamp",  13u, 0xec65d4a2ccec7248ULL) \
+    X(STARTTIMESTAMP, "starttimestamp", 14u, 0xf8170769f97ce981ULL) \
+    X(APLIMIT,        "aplimit",         7u, 0x732e646e7d5a48fdULL) \
+    X(APCONTINUE,     "apcontinue",     10u, 0x34b2f801ca565802ULL) \
+    X(APNAMESPACE,    "apnamespace",    11u, 0x08d7d4743a045e86ULL) \
+    X(APFROM,         "apfrom",          6u, 0x0db07830c028702bULL) \
+    X(RCLIMIT,        "rclimit",         7u, 0x0ce145971fb7ef49ULL) \
+    X(RCCONTINUE,     "rccontinue",     10u, 0x0543fba957be7d71ULL) \
+    X(RCPROP,         "rcprop",          6u, 0x53fc09536e21a1eeULL) \
+    X(RCTYPE,         "rctype",          6u, 0x5f5b9b2e2ad60698ULL) \
+    X(RCNAMESPACE,    "rcnamespace",    11u, 0x43ac2fc460e5f7a9ULL) \
+    X(CMTITLE,        "cmtitle",         7u, 0x6294b163ca87292dULL) \
+    X(CMLIMIT,        "cmlimit",         7u, 0xf53f15ef80be00bfULL) \
+    X(CMCONTINUE,     "cmcontinue",     10u, 0x851afccdbb5d2903ULL) \
+    X(CMTYPE,         "cmtype",          6u, 0x3d722dda581b452aULL) \
+    X(SIPROP,         "siprop",          6u, 0xa39ca20eb799b5a1ULL) \
+    X(UIPROP,         "uiprop",          6u, 0x0f9b799c238d5998ULL)
+
+typedef enum {
+    APIKEY_NONE = -1,
+#define APIKEY_ENUM(name, str, len, hash) APIKEY_##name,
+    APIKEY_LIST(APIKEY_ENUM)
+#undef APIKEY_ENUM
+    APIKEY_COUNT
+} apikey_t;
+
+const astring_t* apikey_str(apikey_t key);
+uint64_t apikey_hash(apikey_t key);
+apikey_t apikey_lookup(const char* key, size_t len);
+apikey_t apikey_lookuph(const char* key, size_t len, uint64_t hash);
+
+#endif // __APIKEY_H__
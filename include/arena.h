@@ -0,0 +1,54 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define ARENA_ALIGN (sizeof(void*) * 2)
+#define ARENA_DEFAULT_BLOCK 4096
+
+typedef struct arena_block {
+    struct arena_block* next;   /**< The next block in the chain. */
+    size_t cap;                 /**< The usable size of the block. */
+    size_t used;                /**< The number of bytes handed out. */
+    char data[] __attribute__((aligned(ARENA_ALIGN))); /**< The block storage, aligned so that allocations honour ARENA_ALIGN. */
+} arena_block_t;
+
+typedef struct {
+    arena_block_t* first;       /**< The first block in the chain. */
+    arena_block_t* current;     /**< The block allocations are served from. */
+    size_t block_size;          /**< The default size of new blocks. */
+} arena_t;
+
+arena_t* arena_new(size_t block_size);
+void arena_free(arena_t* arena);
+void arena_reset(arena_t* arena);
+void* arena_alloc(arena_t* arena, size_t size);
+void* arena_calloc(arena_t* arena, size_t size);
+void* arena_realloc(arena_t* arena, void* ptr, size_t old_size, size_t new_size);
+
+#endif // __ARENA_H__
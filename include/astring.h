@@ -28,21 +28,59 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+/**
+ * Strings whose buffer fits in ASTRING_SMALL_CAP bytes (including the null
+ * terminator) are stored inline in the astring itself and only spill to a
+ * separate buffer when they grow past it. raw may point into the astring, so
+ * astrings must not be copied by value.
+ */
+#define ASTRING_SMALL_CAP 24
+
+/** Returned by the find functions when there is no match. */
+#define ASTRING_NPOS ((size_t)-1)
+
+/**
+ * Default growth policy: capacity doubles whenever an append or prepend runs
+ * out of room, and spilled buffers start at ASTRING_GROWTH_MIN bytes.
+ */
+#define ASTRING_GROWTH_FACTOR 200
+#define ASTRING_GROWTH_MIN 64
 
 typedef struct {
     char* raw;      /**< The raw character buffer. */
     size_t len;     /**< The length of the string. */
-    size_t cap;     /**< The capacity of the buffer. */
+    size_t cap;     /**< The capacity of the buffer, 0 if the buffer is borrowed. */
+    size_t head;    /**< The unused bytes reserved in front of raw. */
+    arena_t* arena; /**< The arena owning the astring, or NULL for the heap. */
+    char small[ASTRING_SMALL_CAP]; /**< The inline buffer for short strings. */
 } astring_t;
 
+typedef struct {
+    size_t factor;  /**< The growth factor in percent, e.g. 200 doubles. */
+    size_t min;     /**< The smallest capacity to grow to. */
+} astring_growth_t;
+
+void astring_setgrowth(astring_growth_t policy);
+astring_growth_t astring_getgrowth(void);
+
 
 astring_t* astring_new(size_t cap);
+astring_t* astring_new_in(arena_t* arena, size_t cap);
+astring_t* astring_borrow_in(arena_t* arena, char* raw, size_t len);
 void astring_free(astring_t* astr);
 astring_t* astring_resize(astring_t* astr, size_t cap);
+astring_t* astring_reserve(astring_t* astr, size_t cap);
+astring_t* astring_reservefront(astring_t* astr, size_t n);
 astring_t* astring_fit(astring_t* astr);
 astring_t* astring_from(const char* str);
+astring_t* astring_from_in(arena_t* arena, const char* str);
 astring_t* astring_into(astring_t* astr, const char* str);
 astring_t* astring_append(astring_t* astr, const char* str);
+astring_t* astring_appendn(astring_t* astr, const char* str, size_t len);
 astring_t* astring_prepend(astring_t* astr, const char* str);
 astring_t* astring_appenda(astring_t* astr, const astring_t* other);
 astring_t* astring_prependa(astring_t* astr, const astring_t* other);
@@ -52,7 +90,17 @@ astring_t* astring_slice(const astring_t* astr, size_t start, size_t end);
 bool astring_contains(const astring_t* astr, const astring_t* other);
 bool astring_containsc(const astring_t* astr, char c);
 bool astring_containss(const astring_t* astr, const char* str);
-size_t** astring_findallc(const astring_t* astr, const char c);
+size_t astring_find(const astring_t* astr, const astring_t* other);
+size_t astring_findc(const astring_t* astr, char c);
+size_t astring_finds(const astring_t* astr, const char* str);
+size_t astring_rfind(const astring_t* astr, const astring_t* other);
+size_t astring_rfindc(const astring_t* astr, char c);
+size_t astring_rfinds(const astring_t* astr, const char* str);
+size_t* astring_findallc(const astring_t* astr, const char c, size_t* count);
+void astring_findallc_free(size_t* indices, size_t count);
+size_t astring_findallc_into(const astring_t* astr, const char c, size_t* indices, size_t cap);
 bool astring_replaceindex(astring_t* astr, size_t index, const char c);
+uint64_t astring_hashraw(const char* raw, size_t len);
+uint64_t astring_hash(const astring_t* astr);
 
 #endif /* ASTRING_H */
@@ -0,0 +1,67 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ASTRING_VIEW_H__
+#define __ASTRING_VIEW_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "arena.h"
+#include "astring.h"
+
+/**
+ * A non-owning reference to a range of bytes, usually part of an astring.
+ * Views are passed by value, never allocate and are not null-terminated.
+ * A view is only valid while the memory it points into is.
+ */
+typedef struct {
+    const char* raw;    /**< The first byte of the view, or NULL. */
+    size_t len;         /**< The length of the view. */
+} astring_view_t;
+
+astring_view_t astring_view(const astring_t* astr);
+astring_view_t astring_view_of(const char* raw, size_t len);
+astring_view_t astring_view_from(const char* str);
+astring_view_t astring_sliceview(const astring_t* astr, size_t start, size_t end);
+astring_view_t astring_view_slice(astring_view_t view, size_t start, size_t end);
+astring_t* astring_view_toastring(astring_view_t view);
+astring_t* astring_view_toastring_in(arena_t* arena, astring_view_t view);
+bool astring_view_eq(astring_view_t view1, astring_view_t view2);
+bool astring_view_eqa(astring_view_t view, const astring_t* astr);
+bool astring_view_eqs(astring_view_t view, const char* str);
+bool astring_view_contains(astring_view_t view, astring_view_t other);
+bool astring_view_containsc(astring_view_t view, char c);
+bool astring_view_containss(astring_view_t view, const char* str);
+size_t astring_view_find(astring_view_t view, astring_view_t other);
+size_t astring_view_findc(astring_view_t view, char c);
+size_t astring_view_finds(astring_view_t view, const char* str);
+size_t astring_view_rfind(astring_view_t view, astring_view_t other);
+size_t astring_view_rfindc(astring_view_t view, char c);
+size_t astring_view_rfinds(astring_view_t view, const char* str);
+size_t astring_view_findallc(astring_view_t view, char c, size_t* indices, size_t cap);
+bool astring_view_splitc(astring_view_t* rest, char delim, astring_view_t* token);
+bool astring_view_splits(astring_view_t* rest, const char* delim, astring_view_t* token);
+
+#endif // __ASTRING_VIEW_H__
@@ -0,0 +1,107 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "apikey.h"
+#include "arena.h"
+#include "astring.h"
+#include "engine.h"
+#include "querystring.h"
+
+/** The most values per request the API accepts from normal accounts. */
+#define BATCH_DEFAULT_LIMIT 50
+
+/** The most values per request with the apihighlimits right. */
+#define BATCH_HIGH_LIMIT 500
+
+/** The default budget for the encoded multi-value parameter, keeping URLs short. */
+#define BATCH_DEFAULT_BYTES 4096
+
+/**
+ * The part of a shared response that belongs to one value. For titles,
+ * pageids and revids the value is followed through the normalized, converted
+ * and redirects maps to its entry in query.pages. Values under other keys
+ * cannot be matched to a page, so data is the whole body.
+ */
+typedef struct {
+    const astring_t* value;     /**< The title or page id that was added. */
+    const char* data;           /**< The value's page entry in the body, or NULL if it has none. */
+    size_t len;                 /**< The length of data. */
+    bool missing;               /**< Whether the value has no entry, or its entry is marked missing or invalid. */
+} batch_page_t;
+
+/**
+ * Called once per value when the request carrying it completes. Every value
+ * of a batch sees the same request, so the body must be treated as read-only.
+ */
+typedef void (*batch_callback_t)(engine_request_t* req, const batch_page_t* page, void* userdata);
+
+typedef struct batch_item {
+    astring_t* value;           /**< The title or page id. */
+    batch_callback_t callback;  /**< The function called with the response. */
+    void* userdata;             /**< Passed through to the callback. */
+    struct batch_item* next;    /**< The next value in the batch. */
+} batch_item_t;
+
+/**
+ * One pending or in-flight request. Items and their values live in the
+ * group's arena, which is released once every callback has run.
+ */
+typedef struct {
+    arena_t* arena;
+    apikey_t key;               /**< The multi-value key, deciding how values are matched to pages. */
+    batch_item_t* head;
+    batch_item_t* tail;
+    size_t count;               /**< The number of values in the group. */
+    size_t bytes;               /**< The encoded length of the joined values. */
+} batch_group_t;
+
+/**
+ * Collects single-page requests and sends them as one request with the
+ * values joined by '|' under a multi-value key such as titles or pageids.
+ * The shared parameters are kept in qs, which the batch owns.
+ */
+typedef struct {
+    engine_t* engine;
+    astring_t* endpoint;
+    querystring_t* qs;          /**< The shared parameters, including key. */
+    apikey_t key;               /**< The multi-value key, such as APIKEY_TITLES. */
+    size_t limit;               /**< The most values per request. */
+    size_t max_bytes;           /**< The budget for the encoded joined values. */
+    batch_group_t* group;       /**< The values waiting to be sent, or NULL. */
+} batch_t;
+
+batch_t* batch_new(engine_t* engine, const char* endpoint, querystring_t* qs, apikey_t key);
+void batch_free(batch_t* batch);
+void batch_setlimit(batch_t* batch, size_t limit, size_t max_bytes);
+bool batch_add(batch_t* batch, const char* value, batch_callback_t callback, void* userdata);
+bool batch_flush(batch_t* batch);
+size_t batch_pending(const batch_t* batch);
+
+#endif // __BATCH_H__
\ No newline at end of file
@@ -0,0 +1,101 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "astring.h"
+#include "querystring.h"
+
+/** The default budget of the in-memory front, in bytes of key and body. */
+#define CACHE_DEFAULT_MEMORY (16u * 1024u * 1024u)
+
+/** The initial length of the file mapping, grown geometrically. */
+#define CACHE_MAP_MIN (1u << 20)
+
+/**
+ * The header written in front of every record in the cache file, followed
+ * by the key and the body and padded to 8 bytes.
+ */
+typedef struct {
+    uint32_t magic;             /**< CACHE_RECORD_MAGIC, or CACHE_TOMBSTONE_MAGIC for a removal. */
+    uint32_t key_len;           /**< The length of the canonical key. */
+    uint64_t body_len;          /**< The length of the body. */
+    uint64_t hash;              /**< The hash of the canonical key. */
+    int64_t expires;            /**< The unix time the entry expires at, 0 for never. */
+    uint64_t revid;             /**< The revision the response reflects, 0 if unknown. */
+    uint64_t checksum;          /**< The hash of the fields above, the key and the body. */
+} cache_record_t;
+
+/** A recently used entry held in memory in front of the file. */
+typedef struct cache_entry {
+    uint64_t hash;
+    astring_t* key;
+    astring_t* body;
+    int64_t expires;
+    uint64_t revid;
+    struct cache_entry* prev;   /**< The more recently used neighbour. */
+    struct cache_entry* next;   /**< The less recently used neighbour. */
+    struct cache_entry* chain;  /**< The next entry in the same bucket. */
+} cache_entry_t;
+
+/**
+ * A response cache keyed by endpoint and canonical querystring. Entries are
+ * appended to a memory-mapped file that is never rewritten in place, with an
+ * in-memory hash index of record offsets rebuilt when the file is opened.
+ * Recently used entries are also kept in an LRU front bounded by
+ * memory_limit. A NULL path gives a memory-only cache.
+ */
+typedef struct {
+    int fd;                     /**< The cache file, or -1 if memory-only. */
+    char* map;                  /**< The read-only mapping of the file. */
+    size_t map_len;             /**< The length of the mapping. */
+    size_t size;                /**< The length of the valid part of the file. */
+    uint64_t* index;            /**< Record offsets plus one, by hash. */
+    size_t index_cap;           /**< The number of index entries, a power of two. */
+    size_t index_used;          /**< The number of occupied index entries. */
+    cache_entry_t** buckets;    /**< The LRU front's hash table. */
+    size_t bucket_cap;          /**< The number of buckets, a power of two. */
+    size_t count;               /**< The number of entries in the front. */
+    size_t memory;              /**< The bytes held by the front. */
+    size_t memory_limit;        /**< The most bytes the front may hold. */
+    cache_entry_t* head;        /**< The most recently used entry. */
+    cache_entry_t* tail;        /**< The least recently used entry. */
+    astring_t* key;             /**< Scratch space for building keys. */
+    astring_t* query;           /**< Scratch space for the canonical query. */
+    size_t hits;                /**< Lookups answered from the front or the file. */
+    size_t misses;              /**< Lookups that found nothing usable. */
+} cache_t;
+
+cache_t* cache_open(const char* path, size_t memory_limit);
+void cache_close(cache_t* cache);
+bool cache_get(cache_t* cache, const char* endpoint, const querystring_t* qs, uint64_t min_revid, astring_t* dest);
+bool cache_put(cache_t* cache, const char* endpoint, const querystring_t* qs, const char* body, size_t len, int64_t ttl, uint64_t revid);
+bool cache_remove(cache_t* cache, const char* endpoint, const querystring_t* qs);
+
+#endif // __CACHE_H__
\ No newline at end of file
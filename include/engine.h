@@ -0,0 +1,147 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <curl/curl.h>
+
+#include "astring.h"
+#include "mpmc.h"
+#include "querystring.h"
+#include "timing.h"
+
+/** The number of easy handles, and so in-flight requests, when none is given. */
+#define ENGINE_DEFAULT_HANDLES 256
+
+/** The most idle response buffers, and request structs, an engine keeps for reuse. */
+#define ENGINE_POOL_BUFFERS 64
+
+/** Response buffers larger than this are freed rather than pooled. */
+#define ENGINE_POOL_MAX_BYTES (8 * 1024 * 1024)
+
+/** The number of response size hints remembered, a power of two. */
+#define ENGINE_HINT_SLOTS 256
+
+/** The User-Agent sent with every request, as required by the API etiquette. */
+#define ENGINE_USER_AGENT "curlybot/0.1 (https://github.com/AbishYoung/curlybot)"
+
+/** The Accept-Encoding offered, empty for every encoding libcurl was built with (gzip, deflate, br, zstd). */
+#define ENGINE_ACCEPT_ENCODING ""
+
+typedef struct engine_request engine_request_t;
+
+/**
+ * Called once per request when it completes or fails. The request and its
+ * buffers are released after the callback returns; set body to NULL to keep
+ * the response buffer, and hand it back with engine_recycle once done with
+ * it. New requests may be submitted from the callback.
+ */
+typedef void (*engine_callback_t)(engine_request_t* req, void* userdata);
+
+/**
+ * Receives the response body chunk by chunk in place of req->body, such as
+ * json_sink. Returning false aborts the transfer.
+ */
+typedef bool (*engine_sink_t)(void* userdata, const char* data, size_t len);
+
+struct engine_request {
+    astring_t* url;             /**< The full request URL. */
+    astring_t* post;            /**< The form-encoded POST body, or NULL for GET. */
+    astring_t* body;            /**< The response body. */
+    long status;                /**< The HTTP status code, 0 if no response arrived. */
+    CURLcode result;            /**< The transfer result. */
+    curl_off_t retry_after;     /**< The Retry-After header in seconds, 0 if absent. */
+    curl_off_t wire_bytes;      /**< The body bytes received, before decompression. */
+    curl_off_t decoded_bytes;   /**< The body bytes delivered, after decompression. */
+    uint64_t phases[TIMING_PHASES]; /**< The time spent in each phase in nanoseconds, only measured while the engine has a timing collector. */
+    engine_callback_t callback; /**< The completion callback. */
+    void* userdata;             /**< Passed through to the callback. */
+    engine_sink_t sink;         /**< Receives the body instead of body, or NULL. */
+    void* sink_data;            /**< Passed through to the sink. */
+    CURL* easy;                 /**< The easy handle while the request is in flight. */
+    engine_request_t* next;     /**< The next request in the wait queue or in-flight list. */
+    engine_request_t* prev;     /**< The previous request in the in-flight list. */
+    struct engine* engine;      /**< The engine running the request. */
+};
+
+/** The expected decoded size of responses to one endpoint and action, learned from earlier responses. */
+typedef struct {
+    uint64_t hash;              /**< The hash of the URL up to the query and of the action. */
+    size_t size;                /**< The recent largest response, decaying by an eighth per response. */
+} engine_hint_t;
+
+/**
+ * Requests run on one thread over a curl multi handle driven by epoll. Easy
+ * handles are pooled and reused, and connections stay in the multi handle's
+ * keep-alive cache between requests. Requests submitted while every handle
+ * is busy wait in a FIFO queue. Response buffers are pooled too and pre-sized
+ * from Content-Length or the endpoint's earlier responses, so a warm engine
+ * receives a response without allocating. With a timing collector set, each
+ * request's phases are measured and recorded under its wiki and action.
+ * Only engine_wake and engine_recycle may be called from other threads.
+ */
+typedef struct engine {
+    CURLM* multi;
+    int epfd;                   /**< The epoll instance watching curl's sockets. */
+    int timerfd;                /**< The timerfd backing curl's timeout. */
+    int wakefd;                 /**< The eventfd other threads interrupt engine_poll with. */
+    CURL** pool;                /**< The idle easy handles. */
+    size_t pool_len;            /**< The number of idle easy handles. */
+    size_t handles;             /**< The number of easy handles created. */
+    size_t max_handles;         /**< The most easy handles, and in-flight requests. */
+    engine_request_t* active;   /**< The requests in flight. */
+    size_t running;             /**< The number of requests in flight. */
+    engine_request_t* queue;    /**< The first request waiting for a handle. */
+    engine_request_t* queue_tail;
+    size_t queued;              /**< The number of requests waiting for a handle. */
+    bool dispatching;           /**< Whether curl is running, and so may not be re-entered. */
+    curl_off_t wire_bytes;      /**< The body bytes received by completed requests, before decompression. */
+    curl_off_t decoded_bytes;   /**< The body bytes delivered by completed requests, after decompression. */
+    astring_t** buffers;        /**< The idle response buffers. */
+    size_t buffers_len;         /**< The number of idle response buffers. */
+    mpmc_t* returned;           /**< The buffers handed back by engine_recycle, possibly from other threads. */
+    engine_request_t* spare;    /**< The freed request structs kept for reuse. */
+    size_t spare_len;           /**< The number of spare request structs. */
+    engine_hint_t hints[ENGINE_HINT_SLOTS];
+    timing_t* timing;           /**< The collector request phases are recorded into, or NULL. */
+} engine_t;
+
+engine_t* engine_new(size_t max_handles);
+void engine_free(engine_t* engine);
+astring_t* engine_url(const char* endpoint, const querystring_t* qs);
+engine_request_t* engine_submitraw(engine_t* engine, astring_t* url, astring_t* post, engine_callback_t callback, void* userdata);
+engine_request_t* engine_submit(engine_t* engine, const char* endpoint, const querystring_t* qs, engine_callback_t callback, void* userdata);
+engine_request_t* engine_submitpost(engine_t* engine, const char* endpoint, const querystring_t* qs, engine_callback_t callback, void* userdata);
+void engine_setsink(engine_request_t* req, engine_sink_t sink, void* userdata);
+void engine_settiming(engine_t* engine, timing_t* timing);
+void engine_recycle(engine_t* engine, astring_t* body);
+bool engine_wake(engine_t* engine);
+int engine_poll(engine_t* engine, int timeout_ms);
+int engine_run(engine_t* engine);
+size_t engine_pending(const engine_t* engine);
+
+#endif // __ENGINE_H__
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __EXECUTOR_H__
+#define __EXECUTOR_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "engine.h"
+
+/** The number of I/O threads when none is given. */
+#define EXECUTOR_DEFAULT_LOOPS 1
+
+/** The initial number of slots in a worker's deque, a power of two. */
+#define EXECUTOR_DEQUE_MIN 256
+
+/** The rounds of stealing an idle worker tries before it sleeps. */
+#define EXECUTOR_SPINS 64
+
+/** A CPU-side task, such as building a query or parsing a response. */
+typedef void (*executor_task_t)(void* arg);
+
+/** A network task, run on an I/O thread with the engine that thread owns. */
+typedef void (*executor_iotask_t)(engine_t* engine, void* arg);
+
+typedef struct {
+    executor_task_t fn;
+    void* arg;
+} executor_job_t;
+
+typedef struct {
+    executor_iotask_t fn;
+    void* arg;
+} executor_iojob_t;
+
+/** The slots of a work-stealing deque. Outgrown rings stay alive until the executor is freed, since thieves may still read them. */
+typedef struct executor_ring {
+    int64_t cap;                    /**< The number of slots, a power of two. */
+    struct executor_ring* retired;  /**< The ring this one replaced. */
+    executor_job_t jobs[];
+} executor_ring_t;
+
+/**
+ * A worker thread. The owner pushes and pops at the bottom of its Chase-Lev
+ * deque, other workers steal from the top. Tasks submitted from outside the
+ * pool land in the inbox of the worker their affinity key maps to, and are
+ * moved to the deque by the owner or taken by an idle worker.
+ */
+typedef struct executor_worker {
+    struct executor* executor;
+    pthread_t thread;
+    size_t index;
+    int64_t top;                    /**< The next slot to steal, updated atomically. */
+    int64_t bottom;                 /**< The next slot to push, updated atomically. */
+    executor_ring_t* ring;          /**< The current slots, updated atomically. */
+    pthread_mutex_t lock;           /**< Guards the inbox. */
+    executor_job_t* inbox;
+    size_t inbox_head;              /**< The first job in the inbox not yet taken. */
+    size_t inbox_len;               /**< The end of the inbox, read without the lock as a hint. */
+    size_t inbox_cap;
+    uint64_t seed;                  /**< The state picking victims to steal from. */
+    size_t executed;                /**< The number of tasks the worker ran. */
+    size_t stolen;                  /**< The number of those taken from other workers. */
+} executor_worker_t;
+
+/** An I/O thread running one engine's event loop. */
+typedef struct executor_loop {
+    struct executor* executor;
+    pthread_t thread;
+    engine_t* engine;
+    pthread_mutex_t lock;           /**< Guards the inbox. */
+    executor_iojob_t* inbox;
+    size_t inbox_len;
+    size_t inbox_cap;
+    bool busy;                      /**< Whether the engine's requests are counted as active work. */
+} executor_loop_t;
+
+/**
+ * Runs CPU-side tasks on a pool of work-stealing workers and network tasks on
+ * dedicated I/O threads, so parse throughput scales with cores while network
+ * concurrency scales with the engines. An affinity key, such as a wiki's
+ * endpoint, sends related tasks to the same worker and I/O thread.
+ */
+typedef struct executor {
+    executor_worker_t* workers;
+    size_t worker_count;
+    executor_loop_t* loops;
+    size_t loop_count;
+    size_t next;                    /**< The round-robin cursor for tasks without affinity. */
+    size_t queued;                  /**< The tasks submitted but not yet taken, updated atomically. */
+    size_t active;                  /**< The tasks and engines with unfinished work, updated atomically. */
+    size_t sleepers;                /**< The number of idle workers waiting on wake. */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            /**< Signalled when a task is submitted. */
+    pthread_cond_t idle;            /**< Broadcast when the active work runs out. */
+    bool stopping;                  /**< Whether the threads should exit once the work runs out. */
+} executor_t;
+
+executor_t* executor_new(size_t workers, size_t loops);
+void executor_free(executor_t* executor);
+bool executor_submit(executor_t* executor, const char* affinity, executor_task_t fn, void* arg);
+bool executor_submitio(executor_t* executor, const char* affinity, executor_iotask_t fn, void* arg);
+void executor_wait(executor_t* executor);
+
+#endif // __EXECUTOR_H__
\ No newline at end of file
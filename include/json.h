@@ -0,0 +1,138 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __JSON_H__
+#define __JSON_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "astring.h"
+
+/** The deepest nesting the parser accepts. */
+#define JSON_MAX_DEPTH 64
+
+/** The most subscriptions a parser can hold, one bit each in a mask. */
+#define JSON_MAX_SUBSCRIPTIONS 64
+
+typedef enum {
+    JSON_NULL,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_OBJECT_START,
+    JSON_OBJECT_END,
+    JSON_ARRAY_START,
+    JSON_ARRAY_END
+} json_type_t;
+
+/**
+ * A value, or the start or end of a container, seen by a subscription.
+ * String values are delivered in order as one or more fragments: every
+ * fragment but the last has more set. data is only valid during the call.
+ */
+typedef struct {
+    json_type_t type;
+    const char* data;       /**< The decoded string fragment or number text, or NULL. */
+    size_t len;             /**< The length of data. */
+    bool more;              /**< Whether more fragments of this string follow. */
+    const astring_t* key;   /**< The member name if the value is in an object, or NULL. */
+    size_t index;           /**< The element index if the value is in an array. */
+    size_t depth;           /**< The nesting depth of the value, 0 for the root. */
+    size_t offset;          /**< The document offset of the value's first byte, or of the closing bracket for an end. */
+} json_event_t;
+
+typedef struct json_parser json_parser_t;
+typedef void (*json_handler_t)(json_parser_t* parser, const json_event_t* ev, void* userdata);
+
+typedef enum {
+    JSON_SEGMENT_KEY,       /**< A member name. */
+    JSON_SEGMENT_ANY,       /**< '*', any member or element. */
+    JSON_SEGMENT_ELEMENT    /**< '[]', any array element. */
+} json_segment_kind_t;
+
+typedef struct {
+    json_segment_kind_t kind;
+    astring_t* key;         /**< The member name for JSON_SEGMENT_KEY, or NULL. */
+} json_segment_t;
+
+typedef struct {
+    json_segment_t* segments;
+    size_t len;
+    json_handler_t handler;
+    void* userdata;
+} json_subscription_t;
+
+typedef struct {
+    json_type_t type;       /**< JSON_OBJECT_START or JSON_ARRAY_START. */
+    astring_t* key;         /**< The current member name, reused between members. */
+    bool has_key;           /**< Whether key holds the current member name. */
+    size_t index;           /**< The current element index. */
+    uint64_t alive;         /**< The subscriptions whose path matches so far. */
+    uint64_t inside;        /**< The subscriptions matching this value or an ancestor. */
+} json_frame_t;
+
+/**
+ * An incremental parser fed with arbitrary chunks, such as the ones handed
+ * to a curl write callback. Instead of building a tree it delivers events to
+ * the subscriptions whose path matches, so only the values a caller asked
+ * for are decoded and the document is never held whole.
+ *
+ * Paths are member names separated by '.', with '[]' for any array element
+ * and '*' for any member or element, as in query.pages[].revisions[].content.
+ * The empty path subscribes to the whole document. A subscription to a
+ * container also receives every event inside it.
+ */
+struct json_parser {
+    int state;
+    int after_string;       /**< The state to return to when a string ends. */
+    json_frame_t frames[JSON_MAX_DEPTH];
+    size_t depth;           /**< The number of open containers. */
+    json_subscription_t subs[JSON_MAX_SUBSCRIPTIONS];
+    size_t sub_count;
+    uint64_t deliver;       /**< The subscriptions receiving the current scalar. */
+    astring_t* sink;        /**< Where the current string decodes to, or NULL to skip it. */
+    astring_t* scratch;     /**< The pending string fragment or number text. */
+    const char* literal;    /**< The literal being matched. */
+    size_t literal_pos;
+    json_type_t literal_type;
+    uint32_t codepoint;     /**< The \u escape being read. */
+    uint32_t high;          /**< A pending high surrogate, or 0. */
+    int hex_len;            /**< The hex digits read of the current \u escape. */
+    size_t offset;          /**< The bytes consumed so far. */
+    size_t at;              /**< The document offset of the last value start or bracket. */
+    const char* error;      /**< The reason parsing failed, or NULL. */
+};
+
+json_parser_t* json_new(void);
+void json_free(json_parser_t* parser);
+void json_reset(json_parser_t* parser);
+bool json_subscribe(json_parser_t* parser, const char* path, json_handler_t handler, void* userdata);
+bool json_feed(json_parser_t* parser, const char* data, size_t len);
+bool json_finish(json_parser_t* parser);
+bool json_sink(void* parser, const char* data, size_t len);
+
+#endif // __JSON_H__
\ No newline at end of file
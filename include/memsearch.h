@@ -0,0 +1,43 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __MEMSEARCH_H__
+#define __MEMSEARCH_H__
+
+#include <stddef.h>
+
+/**
+ * Length-aware byte searches. None of these functions rely on a null
+ * terminator, so haystacks and needles may contain embedded NULs.
+ */
+
+const char* memsearch_chr(const char* hay, size_t hay_len, char c);
+const char* memsearch_rchr(const char* hay, size_t hay_len, char c);
+const char* memsearch_chr2(const char* hay, size_t hay_len, char a, char b);
+const char* memsearch_notspace(const char* hay, size_t hay_len);
+size_t memsearch_allchr(const char* hay, size_t hay_len, char c, size_t* indices, size_t cap);
+const char* memsearch(const char* hay, size_t hay_len, const char* needle, size_t needle_len);
+const char* memsearch_r(const char* hay, size_t hay_len, const char* needle, size_t needle_len);
+
+#endif // __MEMSEARCH_H__
@@ -0,0 +1,69 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __MPMC_H__
+#define __MPMC_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+/** The assumed cache line size, used to keep the producer and consumer cursors apart. */
+#define MPMC_CACHE_LINE 64
+
+typedef struct {
+    size_t seq;                 /**< The position the cell is ready for, updated atomically. */
+    void* data;
+} mpmc_cell_t;
+
+/**
+ * A bounded lock-free multi-producer multi-consumer queue of pointers, after
+ * Vyukov. Every cell carries a sequence number telling producers and
+ * consumers whether it is theirs, so a push or pop costs one compare and
+ * swap on a cursor and never copies what the pointer refers to. Typical
+ * payloads are response buffers going from an I/O thread to workers, and
+ * recycled buffers going back.
+ */
+typedef struct {
+    char pad0[MPMC_CACHE_LINE];
+    size_t head;                /**< The next position to pop, updated atomically. */
+    char pad1[MPMC_CACHE_LINE - sizeof(size_t)];
+    size_t tail;                /**< The next position to push, updated atomically. */
+    char pad2[MPMC_CACHE_LINE - sizeof(size_t)];
+    mpmc_cell_t* cells;
+    size_t mask;                /**< The capacity minus one, the capacity is a power of two. */
+    size_t high;                /**< The fill level at which producers should back off. */
+} mpmc_t;
+
+mpmc_t* mpmc_new(size_t capacity);
+void mpmc_free(mpmc_t* queue);
+bool mpmc_push(mpmc_t* queue, void* item);
+void* mpmc_pop(mpmc_t* queue);
+size_t mpmc_pushn(mpmc_t* queue, void* const* items, size_t count);
+size_t mpmc_popn(mpmc_t* queue, void** items, size_t count);
+void mpmc_setwatermark(mpmc_t* queue, size_t high);
+bool mpmc_pressured(const mpmc_t* queue);
+size_t mpmc_size(const mpmc_t* queue);
+size_t mpmc_capacity(const mpmc_t* queue);
+
+#endif // __MPMC_H__
\ No newline at end of file
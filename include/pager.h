@@ -0,0 +1,86 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __PAGER_H__
+#define __PAGER_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "astring.h"
+#include "engine.h"
+#include "json.h"
+#include "querystring.h"
+
+/** The number of pages fetched ahead of the consumer by default. */
+#define PAGER_DEFAULT_AHEAD 2
+
+typedef struct pager pager_t;
+
+/** One response of a continued query. */
+typedef struct pager_page {
+    astring_t* body;            /**< The response body. */
+    long status;                /**< The HTTP status code. */
+    CURLcode result;            /**< The transfer result. */
+    size_t index;               /**< The position of the page in the walk, from 0. */
+    bool done;                  /**< Whether the response is complete. */
+    bool has_continue;          /**< Whether the response carried a continue object. */
+    json_parser_t* parser;      /**< Watches the body for the continue object. */
+    querystring_t* cont;        /**< The continue parameters of this response. */
+    astring_t* cont_value;      /**< The continue value being read. */
+    pager_t* pager;
+    struct pager_page* next;    /**< The next page in issue order or in the free list. */
+} pager_page_t;
+
+/**
+ * Follows the continue object of list and generator queries. Each response
+ * is watched as it streams in, and the next request is issued as soon as its
+ * continue object has been parsed rather than when the response completes,
+ * so the following page downloads while the current one is still arriving
+ * or being consumed. At most ahead pages are outstanding at once.
+ */
+struct pager {
+    engine_t* engine;
+    astring_t* endpoint;
+    querystring_t* qs;          /**< The query, updated with each continuation. */
+    querystring_t* applied;     /**< The continue parameters currently in qs. */
+    size_t ahead;               /**< The most pages issued and not yet released. */
+    size_t outstanding;         /**< The pages issued and not yet released. */
+    size_t issued;              /**< The number of requests issued. */
+    size_t inflight;            /**< The number of requests not yet complete. */
+    pager_page_t* head;         /**< The oldest page not yet returned by pager_next. */
+    pager_page_t* tail;
+    pager_page_t* free_pages;   /**< Released pages kept for reuse. */
+    bool ready;                 /**< Whether qs holds a continuation not yet issued. */
+    bool failed;                /**< Whether a request failed, ending the walk. */
+};
+
+pager_t* pager_new(engine_t* engine, const char* endpoint, querystring_t* qs);
+void pager_free(pager_t* pager);
+void pager_setahead(pager_t* pager, size_t ahead);
+pager_page_t* pager_next(pager_t* pager);
+void pager_release(pager_t* pager, pager_page_t* page);
+bool pager_failed(const pager_t* pager);
+
+#endif // __PAGER_H__
\ No newline at end of file
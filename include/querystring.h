@@ -26,34 +26,67 @@
 #define __QUERYSTRING_H__
 
 #include <stdlib.h>
-#include <curl/curl.h>
+#include <stdint.h>
 
+#include "apikey.h"
+#include "arena.h"
 #include "astring.h"
 #include "urlencode.h"
 
+/** The number of live pairs at which a querystring starts keeping a hash index. */
+#define QUERYSTRING_INDEX_MIN 8
+
 typedef struct {
     astring_t* key;
     astring_t* value;
+    arena_t* arena;
+    uint64_t hash;      /**< The hash of key, computed when the pair is created. */
+    apikey_t keyid;     /**< The interned key, or APIKEY_NONE. key is owned unless it is apikey_str(keyid). */
 } querypair_t;
 
+/**
+ * Pairs are kept in insertion order. Removing a pair leaves a NULL hole in
+ * pairs that is compacted away later, so code walking pairs[0..len) must skip
+ * NULL entries. Once a querystring holds QUERYSTRING_INDEX_MIN pairs, lookups
+ * go through an open-addressing index of slot numbers keyed on the pair hash.
+ */
 typedef struct {
     querypair_t** pairs;
     size_t len;
     size_t cap;
+    arena_t* arena;
+    size_t count;       /**< The number of live (non-NULL) pairs. */
+    uint32_t* index;    /**< The hash index of pair slots plus one, or NULL. */
+    size_t index_cap;   /**< The number of entries in the index, a power of two. */
+    size_t index_used;  /**< The number of occupied or deleted index entries. */
 } querystring_t;
 
 querypair_t* querypair_new(astring_t* key, astring_t* value);
+querypair_t* querypair_new_in(arena_t* arena, astring_t* key, astring_t* value);
 querypair_t* querypair_from(const char* key, const char* value);
+querypair_t* querypair_from_in(arena_t* arena, const char* key, const char* value);
+querypair_t* querypair_fromk(apikey_t key, const char* value);
+querypair_t* querypair_fromk_in(arena_t* arena, apikey_t key, const char* value);
 void querypair_free(querypair_t* qp);
 void querypair_freeall(querypair_t* qs);
 
 querystring_t* querystring_new();
+querystring_t* querystring_new_in(arena_t* arena);
 void querystring_free(querystring_t* qs, bool all);
 querystring_t* querystring_add(querystring_t* qs, querypair_t* qp);
 querystring_t* querystring_addfrom(querystring_t* qs, const char* key, const char* value);
 querystring_t* querystring_remove(querystring_t* qs, const char* key, bool all);
 querystring_t* querystring_set(querystring_t* qs, const char* key, astring_t* value);
 astring_t* querystring_get(const querystring_t* qs, const char* key);
+querystring_t* querystring_addk(querystring_t* qs, apikey_t key, const char* value);
+querystring_t* querystring_removek(querystring_t* qs, apikey_t key, bool all);
+querystring_t* querystring_setk(querystring_t* qs, apikey_t key, astring_t* value);
+astring_t* querystring_getk(const querystring_t* qs, apikey_t key);
+size_t querystring_encodedlen(const querystring_t* qs);
+astring_t* querystring_tostring_into(const querystring_t* qs, astring_t* dest);
 astring_t* querystring_tostring(const querystring_t* qs);
+astring_t* querystring_canonical_into(const querystring_t* qs, astring_t* dest);
+querystring_t* querystring_parse(char* buf, size_t len);
+querystring_t* querystring_parse_in(arena_t* arena, char* buf, size_t len);
 
 #endif // __QUERYSTRING_H__
\ No newline at end of file
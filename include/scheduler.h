@@ -0,0 +1,132 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "astring.h"
+#include "engine.h"
+#include "querystring.h"
+
+/** The requests per second a host starts at and grows back to. */
+#define SCHEDULER_DEFAULT_RATE 10.0
+
+/** The number of requests a host may send back to back after idling. */
+#define SCHEDULER_DEFAULT_BURST 10.0
+
+/** The most requests in flight to one host. */
+#define SCHEDULER_DEFAULT_CONCURRENCY 8
+
+/** The maxlag value added to every query, in seconds. */
+#define SCHEDULER_DEFAULT_MAXLAG "5"
+
+/** The lowest rate throttling backs a host off to. */
+#define SCHEDULER_MIN_RATE 0.5
+
+/** The pause when a host throttles without sending Retry-After, in seconds. */
+#define SCHEDULER_DEFAULT_BACKOFF 5
+
+/** The most times a throttled request is sent again. */
+#define SCHEDULER_MAX_RETRIES 5
+
+typedef struct scheduler_host scheduler_host_t;
+
+/** A request waiting for, or holding, a slot on its host. */
+typedef struct scheduler_request {
+    astring_t* url;             /**< The full request URL, owned by the engine while in flight. */
+    astring_t* post;            /**< The form-encoded POST body, or NULL for GET. */
+    engine_callback_t callback; /**< The function called once the request is done. */
+    void* userdata;             /**< Passed through to the callback. */
+    engine_sink_t sink;         /**< Receives the body instead of buffering it, or NULL. */
+    void* sink_data;            /**< Passed through to the sink. */
+    unsigned attempts;          /**< The number of times the request was sent. */
+    int64_t dispatched;         /**< The monotonic time the current attempt was sent. */
+    uint64_t build_ns;          /**< The time spent serializing the query, if the engine is timed. */
+    struct scheduler* scheduler; /**< The scheduler the request was submitted to. */
+    scheduler_host_t* host;     /**< The host the request is queued on. */
+    struct scheduler_request* next; /**< The next request in the host's queue. */
+} scheduler_request_t;
+
+/**
+ * The throttling state of one host. Requests are sent while the token bucket
+ * holds a token, fewer than max_inflight are in flight and any Retry-After
+ * pause has passed. The rate halves when the host throttles and grows back
+ * linearly with every successful response. Throttles of requests sent
+ * before the last backoff belong to that backoff and do not halve it again.
+ */
+struct scheduler_host {
+    astring_t* name;            /**< The scheme and authority, such as https://a.fandom.com. */
+    uint64_t hash;              /**< The hash of name. */
+    double rate;                /**< The current tokens per second. */
+    double max_rate;            /**< The configured tokens per second. */
+    double burst;               /**< The most tokens the bucket holds. */
+    double tokens;              /**< The tokens available. */
+    int64_t refilled;           /**< The monotonic time of the last refill, in nanoseconds. */
+    int64_t resume;             /**< Nothing is sent before this monotonic time. */
+    int64_t backed_off;         /**< The monotonic time of the last backoff. */
+    size_t inflight;            /**< The number of requests in flight. */
+    size_t max_inflight;        /**< The most requests in flight. */
+    scheduler_request_t* queue; /**< The first request waiting to be sent. */
+    scheduler_request_t* queue_tail;
+    size_t queued;              /**< The number of requests waiting to be sent. */
+    size_t throttled;           /**< The number of throttling responses seen. */
+    curl_off_t wire_bytes;      /**< The body bytes received from the host, before decompression. */
+    curl_off_t decoded_bytes;   /**< The body bytes received from the host, after decompression. */
+};
+
+/**
+ * Sits in front of an engine and paces requests per host. Every host has its
+ * own queue, so a host that is backing off does not hold up the others.
+ * Requests are only sent from scheduler_poll and scheduler_run.
+ */
+typedef struct scheduler {
+    engine_t* engine;
+    scheduler_host_t** hosts;
+    size_t host_count;
+    size_t host_cap;
+    double rate;                /**< The rate of hosts not configured explicitly. */
+    double burst;               /**< The burst of hosts not configured explicitly. */
+    size_t concurrency;         /**< The concurrency cap of hosts not configured explicitly. */
+    astring_t* maxlag;          /**< The maxlag value added to queries, or NULL. */
+    size_t pending;             /**< The requests queued or in flight. */
+    bool closing;               /**< Whether the scheduler is being freed. */
+} scheduler_t;
+
+scheduler_t* scheduler_new(engine_t* engine);
+void scheduler_free(scheduler_t* scheduler);
+void scheduler_setdefaults(scheduler_t* scheduler, double rate, double burst, size_t concurrency);
+bool scheduler_sethost(scheduler_t* scheduler, const char* endpoint, double rate, double burst, size_t concurrency);
+bool scheduler_setmaxlag(scheduler_t* scheduler, const char* maxlag);
+scheduler_request_t* scheduler_submit(scheduler_t* scheduler, const char* endpoint, querystring_t* qs, engine_callback_t callback, void* userdata);
+scheduler_request_t* scheduler_submitpost(scheduler_t* scheduler, const char* endpoint, querystring_t* qs, engine_callback_t callback, void* userdata);
+void scheduler_setsink(scheduler_request_t* req, engine_sink_t sink, void* userdata);
+int scheduler_poll(scheduler_t* scheduler, int timeout_ms);
+int scheduler_run(scheduler_t* scheduler);
+size_t scheduler_pending(const scheduler_t* scheduler);
+
+#endif // __SCHEDULER_H__
\ No newline at end of file
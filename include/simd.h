@@ -0,0 +1,116 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __SIMD_H__
+#define __SIMD_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Internal helpers shared by the vectorized string routines.
+ *
+ * SSE2 is part of the x86-64 baseline so it is used unconditionally there.
+ * AVX2 kernels are compiled with a per-function target attribute and picked
+ * at runtime through simd_has_avx2(), so the binary still runs on older CPUs.
+ */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define CURLYBOT_SSE2 1
+#include <immintrin.h>
+#endif
+
+#if defined(CURLYBOT_SSE2) && !defined(CURLYBOT_NO_AVX2)
+#define CURLYBOT_AVX2 1
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/**
+ * @brief Checks if the running CPU supports AVX2.
+ *
+ * @internal
+ *
+ * @return True if the AVX2 kernels may be used, false otherwise.
+ */
+static inline bool simd_has_avx2(void) {
+#if defined(CURLYBOT_AVX2)
+    // relaxed atomics, since threads may race to fill the cache with the same value
+    static int cached = -1;
+    int value = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (value < 0) {
+        value = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&cached, value, __ATOMIC_RELAXED);
+    }
+    return value == 1;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Counts the trailing zero bits of a non-zero mask.
+ *
+ * @internal
+ */
+static inline unsigned simd_ctz(uint32_t mask) {
+    return (unsigned)__builtin_ctz(mask);
+}
+
+/**
+ * @brief Counts the leading zero bits of a non-zero mask.
+ *
+ * @internal
+ */
+static inline unsigned simd_clz(uint32_t mask) {
+    return (unsigned)__builtin_clz(mask);
+}
+
+/**
+ * @brief Counts the trailing zero bits of a non-zero 64-bit mask.
+ *
+ * @internal
+ */
+static inline unsigned simd_ctz64(uint64_t mask) {
+    return (unsigned)__builtin_ctzll(mask);
+}
+
+/**
+ * @brief Counts the set bits of a 64-bit mask.
+ *
+ * @internal
+ */
+static inline unsigned simd_popcount64(uint64_t mask) {
+    return (unsigned)__builtin_popcountll(mask);
+}
+
+/**
+ * @brief Counts the set bits of a mask.
+ *
+ * @internal
+ */
+static inline unsigned simd_popcount(uint32_t mask) {
+    return (unsigned)__builtin_popcount(mask);
+}
+
+#endif // __SIMD_H__
@@ -0,0 +1,117 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef __TIMING_H__
+#define __TIMING_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "astring.h"
+
+/** The sub-buckets per power of two, the histograms keep values to within 1/16. */
+#define TIMING_SUB_BITS 4
+
+/** The number of histogram buckets, covering 0 ns to about 36 minutes. */
+#define TIMING_BUCKETS 608
+
+/** The most wiki and action pairs a thread keeps histograms for. */
+#define TIMING_MAX_SERIES 64
+
+/** The longest wiki name kept, longer names are truncated. */
+#define TIMING_WIKI_MAX 96
+
+/** The longest action name kept, longer names are truncated. */
+#define TIMING_ACTION_MAX 32
+
+/** The phases of a request, in the order they happen. */
+typedef enum {
+    TIMING_BUILD,               /**< Serializing the query into the URL or POST body. */
+    TIMING_DNS,                 /**< Resolving the host name, only for new connections. */
+    TIMING_CONNECT,             /**< The TCP handshake, only for new connections. */
+    TIMING_TLS,                 /**< The TLS handshake, only for new TLS connections. */
+    TIMING_TTFB,                /**< From the request being sent to the first response byte. */
+    TIMING_TRANSFER,            /**< From the first to the last response byte. */
+    TIMING_PARSE,               /**< The sink and the completion callback, where the response is handled. */
+    TIMING_TOTAL,               /**< The whole transfer, as curl measures it. */
+    TIMING_PHASES
+} timing_phase_t;
+
+/**
+ * A log-bucketed histogram of nanosecond values, after HdrHistogram. Values
+ * below 2^(TIMING_SUB_BITS + 1) get a bucket each, above that every power of
+ * two is split into 2^TIMING_SUB_BITS buckets, so a recorded value is off by
+ * at most 1/16 and a histogram is a fixed array of counters.
+ */
+typedef struct {
+    uint64_t counts[TIMING_BUCKETS];
+    uint64_t count;             /**< The number of values recorded. */
+    uint64_t sum;               /**< The sum of the values recorded. */
+    uint64_t max;               /**< The largest value recorded. */
+} timing_hist_t;
+
+/** The histograms of one wiki and action on one thread. */
+typedef struct {
+    uint64_t hash;              /**< The hash of wiki and action. */
+    char wiki[TIMING_WIKI_MAX];
+    char action[TIMING_ACTION_MAX];
+    timing_hist_t phases[TIMING_PHASES];
+} timing_series_t;
+
+/**
+ * The series one thread records into. Only the owning thread writes, so
+ * recording is a few relaxed stores with no atomic read-modify-write, and
+ * readers merge the shards while they are being written.
+ */
+typedef struct timing_shard {
+    timing_series_t* series[TIMING_MAX_SERIES];
+    size_t used;                /**< The number of series published, updated atomically. */
+    uint64_t dropped;           /**< The values dropped because every series slot was taken. */
+    struct timing_shard* next;  /**< The next shard of the collector, immutable once published. */
+    uint64_t owner;             /**< The id of the owning thread. */
+} timing_shard_t;
+
+/**
+ * Collects request phase timings from any number of threads. Each thread
+ * records into a shard of its own, found through a thread-local cache, and
+ * the dump functions merge the shards into per wiki and action summaries.
+ */
+typedef struct {
+    uint64_t id;                /**< Tells collectors apart in the thread-local cache. */
+    timing_shard_t* shards;     /**< The shards, newest first, updated atomically. */
+} timing_t;
+
+timing_t* timing_new(void);
+void timing_free(timing_t* timing);
+uint64_t timing_now(void);
+const char* timing_phase_name(timing_phase_t phase);
+timing_series_t* timing_series(timing_t* timing, const char* wiki, size_t wiki_len, const char* action, size_t action_len);
+void timing_add(timing_series_t* series, timing_phase_t phase, uint64_t ns);
+void timing_record(timing_t* timing, const char* wiki, const char* action, timing_phase_t phase, uint64_t ns);
+uint64_t timing_percentile(const timing_hist_t* hist, double quantile);
+astring_t* timing_json(timing_t* timing);
+astring_t* timing_prometheus(timing_t* timing);
+
+#endif // __TIMING_H__
@@ -1,8 +1,17 @@
 #ifndef __URLENCODE_H__
 #define __URLENCODE_H__
 
+#include <stddef.h>
+#include <stdbool.h>
+
 #include "astring.h"
 
-astring_t* urlencode(CURL* curl, astring_t* str);
+size_t urlencode_len(const char* src, size_t len);
+size_t urlencode_raw(char* dest, const char* src, size_t len);
+astring_t* urlencode_append(astring_t* dest, const char* src, size_t len);
+astring_t* urlencode_into(astring_t* dest, const astring_t* str);
+astring_t* urlencode(const astring_t* str);
+size_t urldecode_raw(char* dest, const char* src, size_t len, bool plus);
+astring_t* urldecode(const astring_t* str);
 
 #endif // __URLENCODE_H__
\ No newline at end of file
@@ -0,0 +1,335 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "alloc.h"
+
+/**
+ * @brief Allocate with malloc.
+ * 
+ * @internal
+*/
+static void* libc_malloc(void* ctx, alloc_category_t category, size_t size) {
+    return malloc(size);
+}
+
+/**
+ * @brief Allocate zeroed memory with calloc.
+ * 
+ * @internal
+*/
+static void* libc_calloc(void* ctx, alloc_category_t category, size_t size) {
+    return calloc(size, 1);
+}
+
+/**
+ * @brief Resize with realloc.
+ * 
+ * @internal
+*/
+static void* libc_realloc(void* ctx, alloc_category_t category, void* ptr, size_t old_size, size_t new_size) {
+    return realloc(ptr, new_size);
+}
+
+/**
+ * @brief Release with free.
+ * 
+ * @internal
+*/
+static void libc_free(void* ctx, alloc_category_t category, void* ptr, size_t size) {
+    free(ptr);
+}
+
+static const alloc_hooks_t libc_hooks = { libc_malloc, libc_calloc, libc_realloc, libc_free, NULL };
+
+/** The hooks in use, the counting hooks while counting is on. */
+static alloc_hooks_t current = { libc_malloc, libc_calloc, libc_realloc, libc_free, NULL };
+
+/** The hooks the counting hooks forward to while counting is on. */
+static alloc_hooks_t counted;
+static bool counting = false;
+
+static alloc_stats_t stats[ALLOC_CATEGORIES];
+
+static const char* const category_names[ALLOC_CATEGORIES] = {
+    "astring_buffer", "astring_header", "astring_indices", "querypair", "pair_array", "querystring"
+};
+
+/**
+ * @brief Account for bytes becoming live, raising the peak if needed.
+ * 
+ * @internal
+*/
+static void count_grow(alloc_stats_t* s, size_t size) {
+    uint64_t live = __atomic_add_fetch(&s->live, size, __ATOMIC_RELAXED);
+    uint64_t peak = __atomic_load_n(&s->peak, __ATOMIC_RELAXED);
+
+    while (live > peak && !__atomic_compare_exchange_n(&s->peak, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief Forward an allocation to the counted hooks and count it.
+ * 
+ * @internal
+*/
+static void* count_malloc(void* ctx, alloc_category_t category, size_t size) {
+    void* ptr = counted.malloc(counted.ctx, category, size);
+    if (ptr == NULL) return NULL;
+
+    __atomic_add_fetch(&stats[category].allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats[category].bytes, size, __ATOMIC_RELAXED);
+    count_grow(&stats[category], size);
+    return ptr;
+}
+
+/**
+ * @brief Forward a zeroed allocation to the counted hooks and count it.
+ * 
+ * @internal
+*/
+static void* count_calloc(void* ctx, alloc_category_t category, size_t size) {
+    void* ptr = counted.calloc(counted.ctx, category, size);
+    if (ptr == NULL) return NULL;
+
+    __atomic_add_fetch(&stats[category].allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats[category].bytes, size, __ATOMIC_RELAXED);
+    count_grow(&stats[category], size);
+    return ptr;
+}
+
+/**
+ * @brief Forward a resize to the counted hooks and count it.
+ * 
+ * @internal
+*/
+static void* count_realloc(void* ctx, alloc_category_t category, void* ptr, size_t old_size, size_t new_size) {
+    void* grown = counted.realloc(counted.ctx, category, ptr, old_size, new_size);
+    if (grown == NULL) return NULL;
+
+    // growing from nothing is a first allocation, not a resize
+    if (old_size == 0) __atomic_add_fetch(&stats[category].allocs, 1, __ATOMIC_RELAXED);
+    else __atomic_add_fetch(&stats[category].reallocs, 1, __ATOMIC_RELAXED);
+    if (new_size > old_size) {
+        __atomic_add_fetch(&stats[category].bytes, new_size - old_size, __ATOMIC_RELAXED);
+        count_grow(&stats[category], new_size - old_size);
+    } else {
+        __atomic_sub_fetch(&stats[category].live, old_size - new_size, __ATOMIC_RELAXED);
+    }
+
+    return grown;
+}
+
+/**
+ * @brief Forward a release to the counted hooks and count it.
+ * 
+ * @internal
+*/
+static void count_free(void* ctx, alloc_category_t category, void* ptr, size_t size) {
+    counted.free(counted.ctx, category, ptr, size);
+
+    __atomic_add_fetch(&stats[category].frees, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&stats[category].live, size, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Set the hooks heap allocations of astrings and querystrings go through.
+ * 
+ * @note Call this before anything is allocated, or at least before anything
+ * allocated with the previous hooks is freed, and before other threads
+ * start. While counting is on, the new hooks are counted.
+ * 
+ * @public
+ * 
+ * @param hooks The hooks, or NULL to go back to malloc, realloc and free
+*/
+void alloc_sethooks(const alloc_hooks_t* hooks) {
+    const alloc_hooks_t* next = (hooks != NULL) ? hooks : &libc_hooks;
+
+    if (counting) counted = *next;
+    else current = *next;
+}
+
+/**
+ * @brief Get the hooks in use, not counting the counting hooks.
+ * 
+ * @public
+ * 
+ * @return alloc_hooks_t The hooks set with alloc_sethooks
+*/
+alloc_hooks_t alloc_gethooks(void) {
+    return counting ? counted : current;
+}
+
+/**
+ * @brief Allocate an uninitialized block through the hooks.
+ * 
+ * @public
+ * 
+ * @param category What the block is for
+ * @param size The size of the block
+ * @return void* The block, or NULL if an error occurred
+*/
+void* alloc_malloc(alloc_category_t category, size_t size) {
+    return current.malloc(current.ctx, category, size);
+}
+
+/**
+ * @brief Allocate a zeroed block through the hooks.
+ * 
+ * @public
+ * 
+ * @param category What the block is for
+ * @param size The size of the block
+ * @return void* The block, or NULL if an error occurred
+*/
+void* alloc_calloc(alloc_category_t category, size_t size) {
+    return current.calloc(current.ctx, category, size);
+}
+
+/**
+ * @brief Resize a block allocated through the hooks.
+ * 
+ * @public
+ * 
+ * @param category What the block is for
+ * @param ptr The block, or NULL to allocate a new one
+ * @param old_size The current size of the block
+ * @param new_size The size to resize the block to
+ * @return void* The resized block, or NULL if an error occurred, in which case ptr is left untouched
+*/
+void* alloc_realloc(alloc_category_t category, void* ptr, size_t old_size, size_t new_size) {
+    return current.realloc(current.ctx, category, ptr, (ptr != NULL) ? old_size : 0, new_size);
+}
+
+/**
+ * @brief Free a block allocated through the hooks.
+ * 
+ * @public
+ * 
+ * @param category What the block was allocated for
+ * @param ptr The block, or NULL to do nothing
+ * @param size The size the block was allocated or last resized with
+*/
+void alloc_free(alloc_category_t category, void* ptr, size_t size) {
+    if (ptr == NULL) return;
+
+    current.free(current.ctx, category, ptr, size);
+}
+
+/**
+ * @brief Turn the allocation counters on or off.
+ * 
+ * @note Counting wraps the current hooks, so it costs a few atomic adds per
+ * allocation while on and nothing while off. Like alloc_sethooks, switch it
+ * before other threads start allocating. Blocks allocated before counting
+ * started are counted when freed, so live may wrap below zero for a
+ * category; call alloc_resetstats at a quiet point to start afresh.
+ * 
+ * @public
+ * 
+ * @param enabled Whether to count allocations
+*/
+void alloc_setcounting(bool enabled) {
+    if (enabled == counting) return;
+
+    if (enabled) {
+        counted = current;
+        current.malloc = count_malloc;
+        current.calloc = count_calloc;
+        current.realloc = count_realloc;
+        current.free = count_free;
+        current.ctx = NULL;
+    } else {
+        current = counted;
+    }
+
+    counting = enabled;
+}
+
+/**
+ * @brief Check if the allocation counters are on.
+ * 
+ * @public
+ * 
+ * @return bool True if allocations are being counted
+*/
+bool alloc_counting(void) {
+    return counting;
+}
+
+/**
+ * @brief Read the counters of a category.
+ * 
+ * @public
+ * 
+ * @param category The category
+ * @param out Set to the counters, or zeroed if category is out of range
+*/
+void alloc_getstats(alloc_category_t category, alloc_stats_t* out) {
+    if (out == NULL) return;
+
+    memset(out, 0, sizeof(alloc_stats_t));
+    if ((int)category < 0 || category >= ALLOC_CATEGORIES) return;
+
+    out->allocs = __atomic_load_n(&stats[category].allocs, __ATOMIC_RELAXED);
+    out->reallocs = __atomic_load_n(&stats[category].reallocs, __ATOMIC_RELAXED);
+    out->frees = __atomic_load_n(&stats[category].frees, __ATOMIC_RELAXED);
+    out->bytes = __atomic_load_n(&stats[category].bytes, __ATOMIC_RELAXED);
+    out->live = __atomic_load_n(&stats[category].live, __ATOMIC_RELAXED);
+    out->peak = __atomic_load_n(&stats[category].peak, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Zero the counters of every category.
+ * 
+ * @note The peak restarts from what is live now, which is kept.
+ * 
+ * @public
+*/
+void alloc_resetstats(void) {
+    alloc_category_t category = ALLOC_ASTRING_BUFFER;
+
+    for (; category < ALLOC_CATEGORIES; category++) {
+        __atomic_store_n(&stats[category].allocs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats[category].reallocs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats[category].frees, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats[category].bytes, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats[category].peak, __atomic_load_n(&stats[category].live, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Get the name of a category, as used in reports.
+ * 
+ * @public
+ * 
+ * @param category The category
+ * @return const char* The category name, or NULL if category is out of range
+*/
+const char* alloc_category_name(alloc_category_t category) {
+    if ((int)category < 0 || category >= ALLOC_CATEGORIES) return NULL;
+
+    return category_names[category];
+}
@@ -0,0 +1,111 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "apikey.h"
+
+/*
+ * The key strings live in read-only storage. The astrings pointing at them
+ * are shared by every querystring that uses an interned key and must never be
+ * modified or freed. They carry the borrowed marker, a capacity of 0, so
+ * nothing treats the string literal as a writable buffer with spare room.
+ */
+#define APIKEY_ASTRING(name, str, len, hash) { (char*)(str), (len), 0, 0, NULL, { 0 } },
+static const astring_t keys[APIKEY_COUNT] = {
+    APIKEY_LIST(APIKEY_ASTRING)
+};
+#undef APIKEY_ASTRING
+
+#define APIKEY_HASH(name, str, len, hash) hash,
+static const uint64_t hashes[APIKEY_COUNT] = {
+    APIKEY_LIST(APIKEY_HASH)
+};
+#undef APIKEY_HASH
+
+/**
+ * @brief Get the interned astring of an API key.
+ *
+ * @public
+ *
+ * @param key The API key
+ * @return const astring_t* The interned astring, or NULL if key is not valid
+*/
+const astring_t* apikey_str(apikey_t key) {
+    if (key <= APIKEY_NONE || key >= APIKEY_COUNT) return NULL;
+
+    return &keys[key];
+}
+
+/**
+ * @brief Get the precomputed hash of an API key.
+ *
+ * @public
+ *
+ * @param key The API key
+ * @return uint64_t The hash of the key, or 0 if key is not valid
+*/
+uint64_t apikey_hash(apikey_t key) {
+    if (key <= APIKEY_NONE || key >= APIKEY_COUNT) return 0;
+
+    return hashes[key];
+}
+
+/**
+ * @brief Find the interned API key matching a string.
+ *
+ * @public
+ *
+ * @param key The key to look up
+ * @param len The length of the key
+ * @return apikey_t The matching API key, or APIKEY_NONE
+*/
+apikey_t apikey_lookup(const char* key, size_t len) {
+    if (key == NULL) return APIKEY_NONE;
+
+    return apikey_lookuph(key, len, astring_hashraw(key, len));
+}
+
+/**
+ * @brief Find the interned API key matching a string with a known hash.
+ *
+ * @public
+ *
+ * @param key The key to look up
+ * @param len The length of the key
+ * @param hash The astring_hashraw hash of the key
+ * @return apikey_t The matching API key, or APIKEY_NONE
+*/
+apikey_t apikey_lookuph(const char* key, size_t len, uint64_t hash) {
+    if (key == NULL) return APIKEY_NONE;
+
+    int i = 0;
+    for (; i < APIKEY_COUNT; i++) {
+        if (hashes[i] == hash && keys[i].len == len && memcmp(keys[i].raw, key, len) == 0) {
+            return (apikey_t)i;
+        }
+    }
+
+    return APIKEY_NONE;
+}
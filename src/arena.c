@@ -0,0 +1,212 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+
+/**
+ * @brief Rounds a size up to the arena alignment.
+ *
+ * @internal
+ */
+static size_t align_up(size_t size) {
+    return (size + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1);
+}
+
+/**
+ * @brief Allocates a new block able to hold at least size bytes.
+ *
+ * @internal
+ *
+ * @param arena The arena the block belongs to.
+ * @param size The minimum usable size of the block.
+ * @return The new block, or NULL if an error occurred.
+ */
+static arena_block_t* block_new(arena_t* arena, size_t size) {
+    size_t cap = (size > arena->block_size) ? align_up(size) : arena->block_size;
+
+    arena_block_t* block = malloc(sizeof(arena_block_t) + cap);
+    if (block == NULL) return NULL;
+
+    block->next = NULL;
+    block->cap = cap;
+    block->used = 0;
+
+    return block;
+}
+
+/**
+ * @brief Creates a new arena.
+ *
+ * @public
+ *
+ * @param block_size The size of each block, or 0 for ARENA_DEFAULT_BLOCK.
+ * @return The new arena, or NULL if an error occurred.
+ */
+arena_t* arena_new(size_t block_size) {
+    arena_t* arena = malloc(sizeof(arena_t));
+    if (arena == NULL) return NULL;
+
+    arena->block_size = align_up((block_size == 0) ? ARENA_DEFAULT_BLOCK : block_size);
+    arena->first = block_new(arena, 0);
+    if (arena->first == NULL) {
+        free(arena);
+        return NULL;
+    }
+
+    arena->current = arena->first;
+
+    return arena;
+}
+
+/**
+ * @brief Frees an arena and every allocation made from it.
+ *
+ * @public
+ *
+ * @param arena The arena to free.
+ */
+void arena_free(arena_t* arena) {
+    if (arena == NULL) return;
+
+    arena_block_t* block = arena->first;
+    while (block != NULL) {
+        arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(arena);
+}
+
+/**
+ * @brief Releases every allocation made from an arena at once.
+ *
+ * @note The blocks are kept and reused, so an arena that is reset between
+ * requests stops calling malloc once it has grown to its working size.
+ *
+ * @public
+ *
+ * @param arena The arena to reset.
+ */
+void arena_reset(arena_t* arena) {
+    if (arena == NULL) return;
+
+    arena_block_t* block = arena->first;
+    for (; block != NULL; block = block->next) block->used = 0;
+
+    arena->current = arena->first;
+}
+
+/**
+ * @brief Allocates memory from an arena.
+ *
+ * @public
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return The allocated memory, or NULL if an error occurred.
+ */
+void* arena_alloc(arena_t* arena, size_t size) {
+    if (arena == NULL || size == 0) return NULL;
+
+    size = align_up(size);
+
+    arena_block_t* block = arena->current;
+    while (block->cap - block->used < size) {
+        if (block->next == NULL) {
+            arena_block_t* tmp = block_new(arena, size);
+            if (tmp == NULL) return NULL;
+
+            block->next = tmp;
+        }
+
+        block = block->next;
+    }
+
+    arena->current = block;
+
+    void* ptr = block->data + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+/**
+ * @brief Allocates zeroed memory from an arena.
+ *
+ * @public
+ *
+ * @param arena The arena to allocate from.
+ * @param size The number of bytes to allocate.
+ * @return The allocated memory, or NULL if an error occurred.
+ */
+void* arena_calloc(arena_t* arena, size_t size) {
+    void* ptr = arena_alloc(arena, size);
+    if (ptr != NULL) memset(ptr, 0, size);
+
+    return ptr;
+}
+
+/**
+ * @brief Resizes an allocation made from an arena.
+ *
+ * @note The most recent allocation is grown or shrunk in place when the block
+ * has room, otherwise the contents are copied to a new allocation. The old
+ * memory is only reclaimed by arena_reset.
+ *
+ * @public
+ *
+ * @param arena The arena the allocation belongs to.
+ * @param ptr The allocation to resize, or NULL to allocate.
+ * @param old_size The current size of the allocation.
+ * @param new_size The requested size of the allocation.
+ * @return The resized allocation, or NULL if an error occurred.
+ */
+void* arena_realloc(arena_t* arena, void* ptr, size_t old_size, size_t new_size) {
+    if (arena == NULL || new_size == 0) return NULL;
+    if (ptr == NULL) return arena_alloc(arena, new_size);
+
+    arena_block_t* block = arena->current;
+    char* end = block->data + block->used;
+
+    if ((char*)ptr + align_up(old_size) == end) {
+        size_t start = (size_t)((char*)ptr - block->data);
+        if (block->cap - start >= align_up(new_size)) {
+            block->used = start + align_up(new_size);
+            return ptr;
+        }
+    }
+
+    if (new_size <= old_size) return ptr;
+
+    void* tmp = arena_alloc(arena, new_size);
+    if (tmp == NULL) return NULL;
+
+    memcpy(tmp, ptr, old_size);
+
+    return tmp;
+}
@@ -22,7 +22,182 @@
  * SOFTWARE.
  */
 
+#include "alloc.h"
 #include "astring.h"
+#include "memsearch.h"
+
+static astring_growth_t growth = { ASTRING_GROWTH_FACTOR, ASTRING_GROWTH_MIN };
+
+/**
+ * @brief Allocates a zeroed character buffer from an arena or the heap.
+ *
+ * @internal
+ */
+static char* buf_alloc(arena_t* arena, size_t size) {
+    if (arena != NULL) return arena_calloc(arena, size);
+
+    return alloc_calloc(ALLOC_ASTRING_BUFFER, size);
+}
+
+/**
+ * @brief Allocates an uninitialized character buffer from an arena or the heap.
+ *
+ * @internal
+ */
+static char* buf_alloc_raw(arena_t* arena, size_t size) {
+    if (arena != NULL) return arena_alloc(arena, size);
+
+    return alloc_malloc(ALLOC_ASTRING_BUFFER, size);
+}
+
+/**
+ * @brief Resizes a character buffer owned by an arena or the heap.
+ *
+ * @internal
+ */
+static char* buf_realloc(arena_t* arena, char* raw, size_t old_size, size_t new_size) {
+    if (arena != NULL) return arena_realloc(arena, raw, old_size, new_size);
+
+    return alloc_realloc(ALLOC_ASTRING_BUFFER, raw, old_size, new_size);
+}
+
+/**
+ * @brief Frees a character buffer owned by the heap.
+ *
+ * @internal
+ */
+static void buf_free(arena_t* arena, char* raw, size_t size) {
+    if (arena == NULL) alloc_free(ALLOC_ASTRING_BUFFER, raw, size);
+}
+
+/**
+ * @brief Gets the start of the allocation backing an astring.
+ *
+ * @internal
+ */
+static inline char* base_of(const astring_t* astr) {
+    return astr->raw - astr->head;
+}
+
+/**
+ * @brief Checks if an astring is using its inline buffer.
+ *
+ * @internal
+ */
+static inline bool is_inline(const astring_t* astr) {
+    return base_of(astr) == astr->small;
+}
+
+/**
+ * @brief Checks if an astring owns a separately allocated buffer.
+ *
+ * @note Borrowed astrings are marked with a capacity of 0.
+ *
+ * @internal
+ */
+static inline bool owns_buffer(const astring_t* astr) {
+    return !is_inline(astr) && astr->cap != 0;
+}
+
+/**
+ * @brief Moves an astring into a buffer with the given front headroom and capacity.
+ *
+ * @internal
+ *
+ * @param astr The astring to move.
+ * @param head The number of bytes to reserve in front of the string.
+ * @param cap The capacity after the headroom, including the null terminator.
+ * @return The astring, or NULL if an error occurred. The astring is left
+ * untouched on error.
+ */
+static astring_t* relayout(astring_t* astr, size_t head, size_t cap) {
+    size_t keep = (astr->len < cap) ? astr->len : cap - 1;
+    char* old_base = base_of(astr);
+    bool owned = owns_buffer(astr);
+    char* base;
+
+    if (head + cap <= ASTRING_SMALL_CAP) {
+        base = astr->small;
+        memmove(base + head, astr->raw, keep);
+        if (owned) buf_free(astr->arena, old_base, astr->head + astr->cap);
+        cap = ASTRING_SMALL_CAP - head;
+    } else if (!owned || astr->head != head) {
+        base = buf_alloc_raw(astr->arena, head + cap);
+        if (base == NULL) return NULL;
+
+        memcpy(base + head, astr->raw, keep);
+        if (owned) buf_free(astr->arena, old_base, astr->head + astr->cap);
+    } else {
+        base = buf_realloc(astr->arena, old_base, astr->head + astr->cap, head + cap);
+        if (base == NULL) return NULL; // if realloc returns null the initial pointer is valid
+    }
+
+    astr->raw = base + head;
+    astr->head = head;
+    astr->cap = cap;
+    astr->len = keep;
+    astr->raw[keep] = '\0';
+
+    return astr;
+}
+
+/**
+ * @brief Applies the growth policy to a required capacity.
+ *
+ * @internal
+ *
+ * @param current The current capacity.
+ * @param required The minimum capacity needed.
+ * @return The capacity to grow to.
+ */
+static size_t grow_cap(size_t current, size_t required) {
+    size_t cap = current;
+
+    if (growth.factor > 100) cap = (current / 100) * growth.factor + ((current % 100) * growth.factor) / 100;
+    if (cap < growth.min) cap = growth.min;
+    if (cap < required) cap = required;
+
+    return cap;
+}
+
+/**
+ * @brief Ensures an astring can hold at least cap bytes, growing geometrically.
+ *
+ * @internal
+ *
+ * @param astr The astring to grow.
+ * @param cap The required capacity, including the null terminator.
+ * @return The astring, or NULL if an error occurred.
+ */
+static astring_t* reserve_impl(astring_t* astr, size_t cap) {
+    if (astr->cap >= cap) return astr;
+
+    return relayout(astr, astr->head, grow_cap(astr->cap, cap));
+}
+
+/**
+ * @brief Sets the growth policy used when appends and prepends run out of room.
+ *
+ * @note A factor of 100 or less grows to exactly the required size.
+ *
+ * @public
+ *
+ * @param policy The new growth policy.
+ */
+void astring_setgrowth(astring_growth_t policy) {
+    growth = policy;
+}
+
+/**
+ * @brief Gets the growth policy used when appends and prepends run out of room.
+ *
+ * @public
+ *
+ * @return The current growth policy.
+ */
+astring_growth_t astring_getgrowth(void) {
+    return growth;
+}
 
 /**
  * @brief Creates a new astring with the given capacity.
@@ -33,20 +208,76 @@
  * @return The new astring, or NULL if an error occurred.
  */
 astring_t* astring_new(size_t cap) {
+    return astring_new_in(NULL, cap);
+}
+
+/**
+ * @brief Creates a new astring with the given capacity inside an arena.
+ *
+ * @note Astrings created in an arena are released by arena_reset or arena_free,
+ * astring_free is a no-op for them.
+ *
+ * @public
+ *
+ * @param arena The arena to allocate from, or NULL for the heap.
+ * @param cap The initial capacity of the astring.
+ * @return The new astring, or NULL if an error occurred.
+ */
+astring_t* astring_new_in(arena_t* arena, size_t cap) {
     if (cap == 0) return NULL; // avoid UB/IDB
 
-    astring_t* tmp = malloc(sizeof(astring_t));
+    astring_t* tmp = (arena != NULL) ? arena_alloc(arena, sizeof(astring_t)) : alloc_malloc(ALLOC_ASTRING_HEADER, sizeof(astring_t));
     if (tmp == NULL) return NULL;
 
-    tmp->raw = calloc(cap, sizeof(char));
-    if (tmp->raw == NULL) return NULL;
+    if (cap <= ASTRING_SMALL_CAP) {
+        memset(tmp->small, 0, ASTRING_SMALL_CAP);
+        tmp->raw = tmp->small;
+        cap = ASTRING_SMALL_CAP;
+    } else {
+        tmp->raw = buf_alloc(arena, cap);
+        if (tmp->raw == NULL) {
+            if (arena == NULL) alloc_free(ALLOC_ASTRING_HEADER, tmp, sizeof(astring_t));
+            return NULL;
+        }
+    }
 
     tmp->len = 0;
     tmp->cap = cap;
+    tmp->head = 0;
+    tmp->arena = arena;
 
     return tmp;    
 }
 
+/**
+ * @brief Creates an astring that borrows an existing buffer.
+ *
+ * @note The buffer is not copied or freed. It must outlive the astring and have
+ * a null terminator at raw[len]. Growing a borrowed astring copies it into a
+ * buffer of its own.
+ *
+ * @public
+ *
+ * @param arena The arena to allocate the header from, or NULL for the heap.
+ * @param raw The buffer to borrow.
+ * @param len The length of the string in the buffer.
+ * @return The new astring, or NULL if an error occurred.
+ */
+astring_t* astring_borrow_in(arena_t* arena, char* raw, size_t len) {
+    if (raw == NULL) return NULL;
+
+    astring_t* tmp = (arena != NULL) ? arena_alloc(arena, sizeof(astring_t)) : alloc_malloc(ALLOC_ASTRING_HEADER, sizeof(astring_t));
+    if (tmp == NULL) return NULL;
+
+    tmp->raw = raw;
+    tmp->len = len;
+    tmp->cap = 0;
+    tmp->head = 0;
+    tmp->arena = arena;
+
+    return tmp;
+}
+
 /**
  * @brief Frees the memory used by an astring.
  *
@@ -55,19 +286,23 @@ astring_t* astring_new(size_t cap) {
  * @param astr The astring to free.
  */
 void astring_free(astring_t* astr) {
-    if (astr != NULL) {
-        if (astr->raw != NULL) {
-            free(astr->raw);
+    if (astr != NULL && astr->arena == NULL) {
+        if (astr->raw != NULL && owns_buffer(astr)) {
+            alloc_free(ALLOC_ASTRING_BUFFER, base_of(astr), astr->head + astr->cap);
             astr->raw = NULL;
         }
 
-        free(astr);
+        alloc_free(ALLOC_ASTRING_HEADER, astr, sizeof(astring_t));
     }
 }
 
 /**
  * @brief Resizes the capacity of an astring.
  *
+ * @note Capacities up to ASTRING_SMALL_CAP use the inline buffer, so shrinking
+ * a spilled string below it moves the contents back inline. Headroom reserved
+ * in front of the string is kept.
+ *
  * @public
  *
  * @param astr The astring to resize.
@@ -79,32 +314,62 @@ astring_t* astring_resize(astring_t* astr, size_t cap) {
     if (astr->raw == NULL) return NULL;
     if (cap == 0) return astr; // avoid UB/IDB
 
-    char* tmp = realloc(astr->raw, cap);
-    if (tmp == NULL) return astr; // if realloc returns null the initial pointer is valid
+    relayout(astr, astr->head, cap); // on failure the initial buffer is still valid
 
-    if (cap < astr->len) {
-        astr->raw[cap - 1] = '\0';
-        astr->len = cap - 1;
-    }
+    return astr;
+}
 
-    astr->raw = tmp;
-    astr->cap = cap;
+/**
+ * @brief Ensures an astring has room for at least cap bytes.
+ *
+ * @note Unlike astring_resize this never shrinks the buffer and reports
+ * allocation failure.
+ *
+ * @public
+ *
+ * @param astr The astring to reserve space in.
+ * @param cap The required capacity, including the null terminator.
+ * @return The astring, or NULL if an error occurred.
+ */
+astring_t* astring_reserve(astring_t* astr, size_t cap) {
+    if (astr == NULL || astr->raw == NULL) return NULL;
+    if (astr->cap >= cap) return astr;
 
-    return astr;
+    return relayout(astr, astr->head, cap);
+}
+
+/**
+ * @brief Ensures an astring has room for at least n bytes in front of it.
+ *
+ * @note Prepends that fit in the reserved headroom do not move the string.
+ *
+ * @public
+ *
+ * @param astr The astring to reserve space in.
+ * @param n The number of bytes to reserve in front of the string.
+ * @return The astring, or NULL if an error occurred.
+ */
+astring_t* astring_reservefront(astring_t* astr, size_t n) {
+    if (astr == NULL || astr->raw == NULL) return NULL;
+    if (astr->head >= n) return astr;
+
+    return relayout(astr, n, astr->cap);
 }
 
 /**
  * @brief Resizes the capacity of an astring to fit its length.
  *
+ * @note Any headroom reserved in front of the string is released as well.
+ *
  * @public
  *
  * @param astr The astring to fit.
  * @return The fitted astring, or NULL if an error occurred.
  */
 astring_t* astring_fit(astring_t* astr) {
-    if (astr->cap == (astr->len + 1)) return astr;
+    if (astr->head == 0 && astr->cap == (astr->len + 1)) return astr;
 
-    astr = astring_resize(astr, astr->len + 1);
+    relayout(astr, 0, astr->len + 1);
 
     return astr;
 }
@@ -118,16 +383,28 @@ astring_t* astring_fit(astring_t* astr) {
  * @return The new astring, or NULL if an error occurred.
  */
 astring_t* astring_from(const char* str) {
+    return astring_from_in(NULL, str);
+}
+
+/**
+ * @brief Creates a new astring from a null-terminated string inside an arena.
+ *
+ * @public
+ *
+ * @param arena The arena to allocate from, or NULL for the heap.
+ * @param str The null-terminated string to create the astring from.
+ * @return The new astring, or NULL if an error occurred.
+ */
+astring_t* astring_from_in(arena_t* arena, const char* str) {
     if (str == NULL) return NULL;
 
     size_t str_len = strlen(str);
-    astring_t* tmp = astring_new(str_len + 1);
+    astring_t* tmp = astring_new_in(arena, str_len + 1);
     if (tmp == NULL) return NULL;
 
     memcpy(tmp->raw, str, str_len);
 
     tmp->len = str_len;
-    tmp->cap = str_len + 1;
 
     return tmp;
 }
@@ -173,16 +450,9 @@ astring_t* append_impl(astring_t* dest, const char* src, size_t src_len) {
         return NULL;
     }
 
-    if (dest->cap < (dest->len + src_len)) {
-        size_t new_cap = dest->len + src_len;
-        char* new_raw = realloc(dest->raw, new_cap + 1);
-
-        if (new_raw == NULL) {
-            return NULL;
-        }
-
-        dest->raw = new_raw;
-        dest->cap = new_cap;
+    dest = reserve_impl(dest, dest->len + src_len + 1);
+    if (dest == NULL) {
+        return NULL;
     }
 
     memcpy((dest->raw + dest->len), src, src_len);
@@ -208,18 +478,35 @@ astring_t* prepend_impl(astring_t* dest, const char* src, size_t src_len) {
         return NULL;
     }
 
-    if (dest->cap < (dest->len + src_len)) {
-        dest = astring_resize(dest, (dest->cap + src_len));
+    if (dest->head < src_len) {
+        size_t needed = dest->len + src_len + 1;
+
+        if (is_inline(dest) && needed <= ASTRING_SMALL_CAP) {
+            dest = relayout(dest, 0, ASTRING_SMALL_CAP);
+        } else {
+            // reserve headroom proportional to the string so repeated
+            // prepends are amortized like appends
+            size_t head = grow_cap(needed, needed) - dest->len - 1;
+            size_t cap = (dest->cap > dest->len) ? dest->cap : dest->len + 1;
+
+            dest = relayout(dest, head, cap);
+        }
+
         if (dest == NULL) {
             return NULL;
         }
     }
 
-    // shift the string to the right
-    memmove((dest->raw + src_len), dest->raw, dest->len);
-    memcpy(dest->raw, src, src_len);
-    dest->raw[dest->len + src_len] = '\0';
+    if (dest->head >= src_len) {
+        dest->raw -= src_len;
+        dest->head -= src_len;
+        dest->cap += src_len;
+    } else {
+        // shift the string to the right
+        memmove((dest->raw + src_len), dest->raw, dest->len + 1);
+    }
 
+    memcpy(dest->raw, src, src_len);
     dest->len += src_len;
 
     return dest;
@@ -239,6 +526,22 @@ astring_t* astring_append(astring_t* astr, const char* str) {
     return append_impl(astr, str, str_len);
 }
 
+/**
+ * @brief Appends a buffer of known length to an astring.
+ *
+ * @note str does not need to be null-terminated and may contain null bytes.
+ *
+ * @public
+ * 
+ * @param astr The astring to append to.
+ * @param str The bytes to append.
+ * @param len The number of bytes to append.
+ * @return The updated astring, or NULL if an error occurred.
+ */
+astring_t* astring_appendn(astring_t* astr, const char* str, size_t len) {
+    return append_impl(astr, str, len);
+}
+
 /**
  * @brief Prepends a null-terminated string to an astring.
  *
@@ -314,6 +617,8 @@ bool astring_eqs(const astring_t* astr, const char* str) {
 /**
  * @brief Creates a new astring from a slice of another astring.
  *
+ * @note The slice is allocated from the same arena as the source astring.
+ *
  * @public
  *
  * @param astr The astring to slice.
@@ -326,14 +631,13 @@ astring_t* astring_slice(const astring_t* astr, size_t start, size_t end) {
     if (start > end || end > astr->len) return NULL;
 
     size_t cap = (end - start) + 1;
-    astring_t* tmp = astring_new(cap);
+    astring_t* tmp = astring_new_in(astr->arena, cap);
     if (tmp == NULL) return NULL;
 
     memcpy(tmp->raw, (astr->raw + start), cap);
     tmp->raw[cap - 1] = '\0';
 
     tmp->len = cap - 1;
-    tmp->cap = cap;
 
     return tmp;
 }
@@ -352,7 +656,7 @@ astring_t* astring_slice(const astring_t* astr, size_t start, size_t end) {
 bool contains_impl(const char* astr, const char* src, size_t astr_len, size_t src_len) {
     if (astr_len < src_len) return false;
     
-    const char* result = strstr(astr, src);
+    const char* result = memsearch(astr, astr_len, src, src_len);
     return (result != NULL);
 }
 
@@ -383,8 +687,7 @@ bool astring_contains(const astring_t* astr, const astring_t* src) {
 bool astring_containsc(const astring_t* astr, char c) {
     if (astr == NULL) return false;
 
-    char src[2] = {c, '\0'};
-    return contains_impl(astr->raw, src, astr->len, 1);
+    return (memsearch_chr(astr->raw, astr->len, c) != NULL);
 }
 
 /**
@@ -402,36 +705,179 @@ bool astring_containss(const astring_t* astr, const char* str) {
     return contains_impl(astr->raw, str, astr->len, strlen(str));
 }
 
+/**
+ * @brief Finds the first position of a byte sequence in a string.
+ *
+ * @internal
+ * 
+ * @param astr The string to search in.
+ * @param src The bytes to search for.
+ * @param astr_len The length of the string to search in.
+ * @param src_len The number of bytes to search for.
+ * @param reverse Whether to find the last position instead of the first.
+ * @return The position of the match, or ASTRING_NPOS if there is none.
+ */
+size_t find_impl(const char* astr, const char* src, size_t astr_len, size_t src_len, bool reverse) {
+    const char* result = reverse ? memsearch_r(astr, astr_len, src, src_len)
+                                 : memsearch(astr, astr_len, src, src_len);
+    if (result == NULL) return ASTRING_NPOS;
+
+    return (size_t)(result - astr);
+}
+
+/**
+ * @brief Finds the first position of an astring in another astring.
+ *
+ * @public
+ * 
+ * @param astr The astring to search in.
+ * @param src The astring to search for.
+ * @return The position of the first match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_find(const astring_t* astr, const astring_t* src) {
+    if (astr == NULL || src == NULL) return ASTRING_NPOS;
+
+    return find_impl(astr->raw, src->raw, astr->len, src->len, false);
+}
+
+/**
+ * @brief Finds the first position of a character in an astring.
+ *
+ * @public
+ * 
+ * @param astr The astring to search in.
+ * @param c The character to search for.
+ * @return The position of the first match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_findc(const astring_t* astr, char c) {
+    if (astr == NULL) return ASTRING_NPOS;
+
+    const char* result = memsearch_chr(astr->raw, astr->len, c);
+    return (result != NULL) ? (size_t)(result - astr->raw) : ASTRING_NPOS;
+}
+
+/**
+ * @brief Finds the first position of a null-terminated string in an astring.
+ *
+ * @public
+ * 
+ * @param astr The astring to search in.
+ * @param str The null-terminated string to search for.
+ * @return The position of the first match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_finds(const astring_t* astr, const char* str) {
+    if (astr == NULL || str == NULL) return ASTRING_NPOS;
+
+    return find_impl(astr->raw, str, astr->len, strlen(str), false);
+}
+
+/**
+ * @brief Finds the last position of an astring in another astring.
+ *
+ * @public
+ * 
+ * @param astr The astring to search in.
+ * @param src The astring to search for.
+ * @return The position of the last match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_rfind(const astring_t* astr, const astring_t* src) {
+    if (astr == NULL || src == NULL) return ASTRING_NPOS;
+
+    return find_impl(astr->raw, src->raw, astr->len, src->len, true);
+}
+
+/**
+ * @brief Finds the last position of a character in an astring.
+ *
+ * @public
+ * 
+ * @param astr The astring to search in.
+ * @param c The character to search for.
+ * @return The position of the last match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_rfindc(const astring_t* astr, char c) {
+    if (astr == NULL) return ASTRING_NPOS;
+
+    const char* result = memsearch_rchr(astr->raw, astr->len, c);
+    return (result != NULL) ? (size_t)(result - astr->raw) : ASTRING_NPOS;
+}
+
+/**
+ * @brief Finds the last position of a null-terminated string in an astring.
+ *
+ * @public
+ * 
+ * @param astr The astring to search in.
+ * @param str The null-terminated string to search for.
+ * @return The position of the last match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_rfinds(const astring_t* astr, const char* str) {
+    if (astr == NULL || str == NULL) return ASTRING_NPOS;
+
+    return find_impl(astr->raw, str, astr->len, strlen(str), true);
+}
+
 /**
  * @brief Finds all instances of a character in an astring.
  *
+ * @note The array is allocated once at its exact size through the allocator
+ * hooks, and must be released with astring_findallc_free.
+ *
  * @public
  * 
  * @param astr The astring to search in.
  * @param c The character to search for.
- * @return An array of indices where the character was found, or NULL if an error occurred.
+ * @param count Set to the number of indices in the returned array.
+ * @return A contiguous array of the indices where the character was found, or
+ * NULL if there were no matches or an error occurred.
  */
-size_t** astring_findallc(const astring_t* astr, const char c) {
-    if (astr == NULL) return NULL;
+size_t* astring_findallc(const astring_t* astr, const char c, size_t* count) {
+    if (count != NULL) *count = 0;
+    if (astr == NULL || count == NULL) return NULL;
 
-    size_t** indices = malloc(sizeof(size_t*));
-    if (indices == NULL) return NULL;
+    size_t total = memsearch_allchr(astr->raw, astr->len, c, NULL, 0);
+    if (total == 0) return NULL;
 
-    size_t count = 0;
-    size_t i = 0;
-    for (; i < astr->len; i++) {
-        if (astr->raw[i] == c) {
-            indices[count] = malloc(sizeof(size_t));
-            if (indices[count] == NULL) return NULL;
+    size_t* indices = alloc_malloc(ALLOC_ASTRING_INDICES, sizeof(size_t) * total);
+    if (indices == NULL) return NULL;
 
-            *indices[count] = i;
-            count++;
-        }
-    }
+    *count = memsearch_allchr(astr->raw, astr->len, c, indices, total);
 
     return indices;
 }
 
+/**
+ * @brief Frees an index array returned by astring_findallc.
+ *
+ * @public
+ *
+ * @param indices The array to free, or NULL.
+ * @param count The number of indices in the array, as returned with it.
+ */
+void astring_findallc_free(size_t* indices, size_t count) {
+    if (indices != NULL) alloc_free(ALLOC_ASTRING_INDICES, indices, sizeof(size_t) * count);
+}
+
+/**
+ * @brief Finds all instances of a character in an astring into a caller buffer.
+ *
+ * @note At most cap indices are written. The return value is the total number
+ * of matches, so a result larger than cap means the buffer was too small.
+ *
+ * @public
+ * 
+ * @param astr The astring to search in.
+ * @param c The character to search for.
+ * @param indices The buffer to write the indices to.
+ * @param cap The number of indices the buffer can hold.
+ * @return The total number of matches.
+ */
+size_t astring_findallc_into(const astring_t* astr, const char c, size_t* indices, size_t cap) {
+    if (astr == NULL) return 0;
+
+    return memsearch_allchr(astr->raw, astr->len, c, indices, cap);
+}
+
 /**
  * @brief Replaces a character at an index in an astring.
  *
@@ -449,4 +895,70 @@ bool astring_replaceindex(astring_t* astr, size_t index, const char c) {
     astr->raw[index] = c;
 
     return true;
+}
+
+/**
+ * @brief Hashes a range of bytes.
+ *
+ * @note This is MurmurHash64A with a fixed seed. It reads eight bytes per
+ * step, does not depend on a null terminator and is stable across runs, so
+ * hashes may be stored and compared later.
+ *
+ * @public
+ * 
+ * @param raw The bytes to hash.
+ * @param len The number of bytes to hash.
+ * @return The 64-bit hash of the bytes.
+ */
+uint64_t astring_hashraw(const char* raw, size_t len) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    const unsigned char* data = (const unsigned char*)raw;
+    uint64_t h = 0x9747b28c9747b28cULL ^ (len * m);
+
+    while (len >= 8) {
+        uint64_t k;
+        memcpy(&k, data, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+
+        data += 8;
+        len -= 8;
+    }
+
+    switch (len) {
+        case 7: h ^= (uint64_t)data[6] << 48; /* fall through */
+        case 6: h ^= (uint64_t)data[5] << 40; /* fall through */
+        case 5: h ^= (uint64_t)data[4] << 32; /* fall through */
+        case 4: h ^= (uint64_t)data[3] << 24; /* fall through */
+        case 3: h ^= (uint64_t)data[2] << 16; /* fall through */
+        case 2: h ^= (uint64_t)data[1] << 8;  /* fall through */
+        case 1: h ^= (uint64_t)data[0];
+                h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+/**
+ * @brief Hashes the contents of an astring.
+ *
+ * @public
+ * 
+ * @param astr The astring to hash.
+ * @return The 64-bit hash of the astring, or 0 if astr is NULL.
+ */
+uint64_t astring_hash(const astring_t* astr) {
+    if (astr == NULL || astr->raw == NULL) return 0;
+
+    return astring_hashraw(astr->raw, astr->len);
 }
\ No newline at end of file
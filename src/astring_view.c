@@ -0,0 +1,394 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "astring_view.h"
+#include "memsearch.h"
+
+static const astring_view_t null_view = { NULL, 0 };
+
+/**
+ * @brief Creates a view of a whole astring.
+ *
+ * @public
+ *
+ * @param astr The astring to view.
+ * @return The view, or a NULL view if astr is NULL.
+ */
+astring_view_t astring_view(const astring_t* astr) {
+    if (astr == NULL || astr->raw == NULL) return null_view;
+
+    return astring_view_of(astr->raw, astr->len);
+}
+
+/**
+ * @brief Creates a view of a range of bytes.
+ *
+ * @public
+ *
+ * @param raw The first byte of the range.
+ * @param len The length of the range.
+ * @return The view.
+ */
+astring_view_t astring_view_of(const char* raw, size_t len) {
+    astring_view_t view;
+
+    view.raw = raw;
+    view.len = (raw != NULL) ? len : 0;
+
+    return view;
+}
+
+/**
+ * @brief Creates a view of a null-terminated string.
+ *
+ * @public
+ *
+ * @param str The null-terminated string to view.
+ * @return The view, or a NULL view if str is NULL.
+ */
+astring_view_t astring_view_from(const char* str) {
+    if (str == NULL) return null_view;
+
+    return astring_view_of(str, strlen(str));
+}
+
+/**
+ * @brief Creates a view of a slice of an astring without copying it.
+ *
+ * @public
+ *
+ * @param astr The astring to slice.
+ * @param start The starting index of the slice.
+ * @param end The ending index of the slice.
+ * @return The view, or a NULL view if the range is invalid.
+ */
+astring_view_t astring_sliceview(const astring_t* astr, size_t start, size_t end) {
+    return astring_view_slice(astring_view(astr), start, end);
+}
+
+/**
+ * @brief Creates a view of a slice of another view.
+ *
+ * @public
+ *
+ * @param view The view to slice.
+ * @param start The starting index of the slice.
+ * @param end The ending index of the slice.
+ * @return The view, or a NULL view if the range is invalid.
+ */
+astring_view_t astring_view_slice(astring_view_t view, size_t start, size_t end) {
+    if (view.raw == NULL) return null_view;
+    if (start > end || end > view.len) return null_view;
+
+    return astring_view_of(view.raw + start, end - start);
+}
+
+/**
+ * @brief Copies a view into a new astring.
+ *
+ * @public
+ *
+ * @param view The view to copy.
+ * @return The new astring, or NULL if an error occurred.
+ */
+astring_t* astring_view_toastring(astring_view_t view) {
+    return astring_view_toastring_in(NULL, view);
+}
+
+/**
+ * @brief Copies a view into a new astring inside an arena.
+ *
+ * @public
+ *
+ * @param arena The arena to allocate from, or NULL for the heap.
+ * @param view The view to copy.
+ * @return The new astring, or NULL if an error occurred.
+ */
+astring_t* astring_view_toastring_in(arena_t* arena, astring_view_t view) {
+    if (view.raw == NULL) return NULL;
+
+    astring_t* tmp = astring_new_in(arena, view.len + 1);
+    if (tmp == NULL) return NULL;
+
+    memcpy(tmp->raw, view.raw, view.len);
+    tmp->raw[view.len] = '\0';
+    tmp->len = view.len;
+
+    return tmp;
+}
+
+/**
+ * @brief Checks if two views are equal.
+ *
+ * @public
+ *
+ * @param view1 The first view to compare.
+ * @param view2 The second view to compare.
+ * @return True if the views hold the same bytes, false otherwise.
+ */
+bool astring_view_eq(astring_view_t view1, astring_view_t view2) {
+    if (view1.raw == NULL || view2.raw == NULL) return false;
+    if (view1.len != view2.len) return false;
+
+    return (memcmp(view1.raw, view2.raw, view1.len) == 0);
+}
+
+/**
+ * @brief Checks if a view is equal to an astring.
+ *
+ * @public
+ *
+ * @param view The view to compare.
+ * @param astr The astring to compare.
+ * @return True if the view holds the same bytes as the astring, false otherwise.
+ */
+bool astring_view_eqa(astring_view_t view, const astring_t* astr) {
+    return astring_view_eq(view, astring_view(astr));
+}
+
+/**
+ * @brief Checks if a view is equal to a null-terminated string.
+ *
+ * @public
+ *
+ * @param view The view to compare.
+ * @param str The null-terminated string to compare.
+ * @return True if the view holds the same bytes as the string, false otherwise.
+ */
+bool astring_view_eqs(astring_view_t view, const char* str) {
+    return astring_view_eq(view, astring_view_from(str));
+}
+
+/**
+ * @brief Checks if a view contains another view.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param other The view to search for.
+ * @return True if the view contains the other view, false otherwise.
+ */
+bool astring_view_contains(astring_view_t view, astring_view_t other) {
+    return (astring_view_find(view, other) != ASTRING_NPOS);
+}
+
+/**
+ * @brief Checks if a view contains a character.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param c The character to search for.
+ * @return True if the view contains the character, false otherwise.
+ */
+bool astring_view_containsc(astring_view_t view, char c) {
+    return (astring_view_findc(view, c) != ASTRING_NPOS);
+}
+
+/**
+ * @brief Checks if a view contains a null-terminated string.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param str The null-terminated string to search for.
+ * @return True if the view contains the string, false otherwise.
+ */
+bool astring_view_containss(astring_view_t view, const char* str) {
+    return (astring_view_finds(view, str) != ASTRING_NPOS);
+}
+
+/**
+ * @brief Converts a search result into a position in a view.
+ *
+ * @internal
+ */
+static size_t position(astring_view_t view, const char* result) {
+    return (result != NULL) ? (size_t)(result - view.raw) : ASTRING_NPOS;
+}
+
+/**
+ * @brief Finds the first position of a view in another view.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param other The view to search for.
+ * @return The position of the first match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_view_find(astring_view_t view, astring_view_t other) {
+    if (view.raw == NULL || other.raw == NULL) return ASTRING_NPOS;
+
+    return position(view, memsearch(view.raw, view.len, other.raw, other.len));
+}
+
+/**
+ * @brief Finds the first position of a character in a view.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param c The character to search for.
+ * @return The position of the first match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_view_findc(astring_view_t view, char c) {
+    if (view.raw == NULL) return ASTRING_NPOS;
+
+    return position(view, memsearch_chr(view.raw, view.len, c));
+}
+
+/**
+ * @brief Finds the first position of a null-terminated string in a view.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param str The null-terminated string to search for.
+ * @return The position of the first match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_view_finds(astring_view_t view, const char* str) {
+    return astring_view_find(view, astring_view_from(str));
+}
+
+/**
+ * @brief Finds the last position of a view in another view.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param other The view to search for.
+ * @return The position of the last match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_view_rfind(astring_view_t view, astring_view_t other) {
+    if (view.raw == NULL || other.raw == NULL) return ASTRING_NPOS;
+
+    return position(view, memsearch_r(view.raw, view.len, other.raw, other.len));
+}
+
+/**
+ * @brief Finds the last position of a character in a view.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param c The character to search for.
+ * @return The position of the last match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_view_rfindc(astring_view_t view, char c) {
+    if (view.raw == NULL) return ASTRING_NPOS;
+
+    return position(view, memsearch_rchr(view.raw, view.len, c));
+}
+
+/**
+ * @brief Finds the last position of a null-terminated string in a view.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param str The null-terminated string to search for.
+ * @return The position of the last match, or ASTRING_NPOS if there is none.
+ */
+size_t astring_view_rfinds(astring_view_t view, const char* str) {
+    return astring_view_rfind(view, astring_view_from(str));
+}
+
+/**
+ * @brief Finds all instances of a character in a view into a caller buffer.
+ *
+ * @public
+ *
+ * @param view The view to search in.
+ * @param c The character to search for.
+ * @param indices The buffer to write the indices to.
+ * @param cap The number of indices the buffer can hold.
+ * @return The total number of matches.
+ */
+size_t astring_view_findallc(astring_view_t view, char c, size_t* indices, size_t cap) {
+    if (view.raw == NULL) return 0;
+
+    return memsearch_allchr(view.raw, view.len, c, indices, cap);
+}
+
+/**
+ * @brief Splits the next token off a view at a delimiter.
+ *
+ * @internal
+ */
+static bool split_impl(astring_view_t* rest, const char* delim, size_t delim_len, astring_view_t* token) {
+    if (rest == NULL || token == NULL || rest->raw == NULL) return false;
+
+    const char* found = (delim_len == 1) ? memsearch_chr(rest->raw, rest->len, delim[0])
+                                         : memsearch(rest->raw, rest->len, delim, delim_len);
+
+    if (found == NULL) {
+        *token = *rest;
+        *rest = null_view;
+        return true;
+    }
+
+    size_t pos = (size_t)(found - rest->raw);
+    *token = astring_view_of(rest->raw, pos);
+    *rest = astring_view_of(found + delim_len, rest->len - pos - delim_len);
+
+    return true;
+}
+
+/**
+ * @brief Splits the next token off a view at a character.
+ *
+ * @note Call repeatedly until it returns false to walk every token. A trailing
+ * delimiter produces a final empty token.
+ *
+ * @public
+ *
+ * @param rest The view to split, advanced past the token and delimiter.
+ * @param delim The character to split at.
+ * @param token Set to the token before the delimiter.
+ * @return True if a token was produced, false once the view is exhausted.
+ */
+bool astring_view_splitc(astring_view_t* rest, char delim, astring_view_t* token) {
+    return split_impl(rest, &delim, 1, token);
+}
+
+/**
+ * @brief Splits the next token off a view at a null-terminated string.
+ *
+ * @note Call repeatedly until it returns false to walk every token. A trailing
+ * delimiter produces a final empty token.
+ *
+ * @public
+ *
+ * @param rest The view to split, advanced past the token and delimiter.
+ * @param delim The non-empty null-terminated string to split at.
+ * @param token Set to the token before the delimiter.
+ * @return True if a token was produced, false once the view is exhausted.
+ */
+bool astring_view_splits(astring_view_t* rest, const char* delim, astring_view_t* token) {
+    if (delim == NULL || delim[0] == '\0') return false;
+
+    return split_impl(rest, delim, strlen(delim), token);
+}
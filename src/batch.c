@@ -0,0 +1,492 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "json.h"
+#include "urlencode.h"
+
+/** The encoded length of the '|' separator. */
+#define SEPARATOR_LEN 3
+
+/** The maps a title is followed through, in the order the API applies them. */
+#define MAP_COUNT 3
+
+/** A from/to pair of the normalized, converted or redirects map. */
+typedef struct alias {
+    astring_t* from;
+    astring_t* to;
+    struct alias* next;
+} alias_t;
+
+/** A page of query.pages and where its entry lies in the body. */
+typedef struct entry {
+    astring_t* title;
+    astring_t* pageid;
+    size_t start;               /**< The offset of the entry's opening brace. */
+    size_t end;                 /**< The offset just past its closing brace. */
+    bool missing;               /**< Whether the entry is marked missing or invalid. */
+    struct entry* next;
+} entry_t;
+
+/** A revision id of query.pages[].revisions and the page it belongs to. */
+typedef struct revid {
+    astring_t* revid;
+    entry_t* entry;
+    struct revid* next;
+} revid_t;
+
+typedef struct demux demux_t;
+
+/** One of the maps, with the handler state its subscription needs. */
+typedef struct {
+    demux_t* demux;
+    alias_t* head;
+} map_t;
+
+/** What is collected from a response while it is parsed. */
+struct demux {
+    arena_t* arena;
+    map_t maps[MAP_COUNT];
+    entry_t* entries;
+    revid_t* revids;
+    bool failed;                /**< Whether an allocation failed. */
+};
+
+/**
+ * @brief Start a new pending group.
+ * 
+ * @internal
+*/
+static batch_group_t* group_new(apikey_t key) {
+    arena_t* arena = arena_new(0);
+    if (arena == NULL) return NULL;
+
+    batch_group_t* group = arena_calloc(arena, sizeof(batch_group_t));
+    if (group == NULL) {
+        arena_free(arena);
+        return NULL;
+    }
+
+    group->arena = arena;
+    group->key = key;
+    return group;
+}
+
+/**
+ * @brief Append a string fragment to *dest, creating it on the first one.
+ * 
+ * @internal
+*/
+static void collect(demux_t* demux, astring_t** dest, const json_event_t* ev) {
+    if (*dest == NULL) *dest = astring_new_in(demux->arena, ev->len + 1);
+    if (*dest == NULL || astring_appendn(*dest, ev->data, ev->len) == NULL) demux->failed = true;
+}
+
+/**
+ * @brief Collect the from/to pairs of query.normalized, converted or redirects.
+ * 
+ * @internal
+*/
+static void on_alias(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    map_t* map = userdata;
+    demux_t* demux = map->demux;
+    (void)parser;
+
+    // depth 3 is an element of the map, depth 4 one of its members
+    if (ev->type == JSON_OBJECT_START && ev->depth == 3) {
+        alias_t* alias = arena_calloc(demux->arena, sizeof(alias_t));
+        if (alias == NULL) {
+            demux->failed = true;
+            return;
+        }
+
+        alias->next = map->head;
+        map->head = alias;
+        return;
+    }
+
+    if (ev->type != JSON_STRING || ev->depth != 4 || map->head == NULL) return;
+
+    if (astring_eqs(ev->key, "from")) collect(demux, &map->head->from, ev);
+    else if (astring_eqs(ev->key, "to")) collect(demux, &map->head->to, ev);
+}
+
+/**
+ * @brief Collect the entries of query.pages, which is an array or an object
+ * keyed by page id depending on formatversion.
+ * 
+ * @internal
+*/
+static void on_page(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    demux_t* demux = userdata;
+    (void)parser;
+
+    if (ev->depth == 3) {
+        if (ev->type == JSON_OBJECT_START) {
+            entry_t* entry = arena_calloc(demux->arena, sizeof(entry_t));
+            if (entry == NULL) {
+                demux->failed = true;
+                return;
+            }
+
+            entry->start = ev->offset;
+            entry->next = demux->entries;
+            demux->entries = entry;
+        } else if (ev->type == JSON_OBJECT_END && demux->entries != NULL) {
+            demux->entries->end = ev->offset + 1;
+        }
+
+        return;
+    }
+
+    entry_t* entry = demux->entries;
+    if (ev->depth != 4 || ev->key == NULL || entry == NULL) return;
+
+    if (ev->type == JSON_STRING && astring_eqs(ev->key, "title")) collect(demux, &entry->title, ev);
+    else if (ev->type == JSON_NUMBER && astring_eqs(ev->key, "pageid")) collect(demux, &entry->pageid, ev);
+    else if (astring_eqs(ev->key, "missing") || astring_eqs(ev->key, "invalid")) entry->missing = true;
+}
+
+/**
+ * @brief Collect the revision ids of the current page.
+ * 
+ * @internal
+*/
+static void on_revid(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    demux_t* demux = userdata;
+    (void)parser;
+
+    if (ev->type != JSON_NUMBER || demux->entries == NULL) return;
+
+    revid_t* revid = arena_calloc(demux->arena, sizeof(revid_t));
+    if (revid == NULL) {
+        demux->failed = true;
+        return;
+    }
+
+    revid->entry = demux->entries;
+    revid->next = demux->revids;
+    demux->revids = revid;
+    collect(demux, &revid->revid, ev);
+}
+
+/**
+ * @brief Parse a response body into demux.
+ * 
+ * @internal
+*/
+static bool demux_parse(demux_t* demux, const astring_t* body) {
+    static const char* const paths[MAP_COUNT] = { "query.normalized[]", "query.converted[]", "query.redirects[]" };
+
+    json_parser_t* parser = json_new();
+    if (parser == NULL) return false;
+
+    bool ok = true;
+    size_t i = 0;
+    for (; i < MAP_COUNT; i++) {
+        demux->maps[i].demux = demux;
+        ok = ok && json_subscribe(parser, paths[i], on_alias, &demux->maps[i]);
+    }
+
+    ok = ok && json_subscribe(parser, "query.pages.*", on_page, demux);
+    ok = ok && json_subscribe(parser, "query.pages.*.revisions[].revid", on_revid, demux);
+    ok = ok && json_feed(parser, body->raw, body->len) && json_finish(parser);
+
+    json_free(parser);
+    return ok && demux->failed == false;
+}
+
+/**
+ * @brief Find the page entry of a value.
+ * 
+ * @internal
+*/
+static entry_t* demux_find(const demux_t* demux, apikey_t key, const astring_t* value) {
+    entry_t* entry = demux->entries;
+
+    if (key == APIKEY_PAGEIDS) {
+        for (; entry != NULL; entry = entry->next) {
+            if (entry->pageid != NULL && astring_eq(entry->pageid, value)) return entry;
+        }
+
+        return NULL;
+    }
+
+    if (key == APIKEY_REVIDS) {
+        const revid_t* revid = demux->revids;
+        for (; revid != NULL; revid = revid->next) {
+            if (revid->revid != NULL && astring_eq(revid->revid, value)) return revid->entry;
+        }
+
+        return NULL;
+    }
+
+    // follow the title through every map it appears in
+    const astring_t* title = value;
+    size_t i = 0;
+    for (; i < MAP_COUNT; i++) {
+        const alias_t* alias = demux->maps[i].head;
+        for (; alias != NULL; alias = alias->next) {
+            if (alias->from != NULL && alias->to != NULL && astring_eq(alias->from, title)) {
+                title = alias->to;
+                break;
+            }
+        }
+    }
+
+    for (; entry != NULL; entry = entry->next) {
+        if (entry->title != NULL && astring_eq(entry->title, title)) return entry;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Hand every value of a completed request its own page entry.
+ * 
+ * @note The body is parsed once, into the group's arena, and the entries
+ * point into it. Values without an entry, including every value of a
+ * response that failed or could not be parsed, are marked missing.
+ * 
+ * @internal
+*/
+static void group_done(engine_request_t* req, void* userdata) {
+    batch_group_t* group = userdata;
+    batch_item_t* item = group->head;
+    const astring_t* body = req->body;
+
+    bool pages = group->key == APIKEY_TITLES || group->key == APIKEY_PAGEIDS || group->key == APIKEY_REVIDS;
+    demux_t* demux = arena_calloc(group->arena, sizeof(demux_t));
+    bool parsed = false;
+
+    if (pages && demux != NULL && body != NULL && body->len > 0) {
+        demux->arena = group->arena;
+        parsed = demux_parse(demux, body);
+    }
+
+    for (; item != NULL; item = item->next) {
+        if (item->callback == NULL) continue;
+
+        batch_page_t page;
+        page.value = item->value;
+        page.data = NULL;
+        page.len = 0;
+        page.missing = true;
+
+        if (pages == false && body != NULL) {
+            page.data = body->raw;
+            page.len = body->len;
+            page.missing = false;
+        } else if (parsed) {
+            const entry_t* entry = demux_find(demux, group->key, item->value);
+            if (entry != NULL && entry->end > entry->start) {
+                page.data = body->raw + entry->start;
+                page.len = entry->end - entry->start;
+                page.missing = entry->missing;
+            }
+        }
+
+        item->callback(req, &page, item->userdata);
+    }
+
+    arena_free(group->arena);
+}
+
+/**
+ * @brief Create a new batch.
+ * 
+ * @note The batch takes ownership of qs. key is added to qs if it is missing,
+ * and its value is overwritten for every request.
+ * 
+ * @public
+ * 
+ * @param engine The engine to submit the requests to
+ * @param endpoint The API endpoint URL
+ * @param qs The parameters shared by every request
+ * @param key The multi-value key the values are joined under
+ * @return batch_t* The new batch, or NULL if an error occurred
+*/
+batch_t* batch_new(engine_t* engine, const char* endpoint, querystring_t* qs, apikey_t key) {
+    if (engine == NULL || endpoint == NULL || qs == NULL || apikey_str(key) == NULL) return NULL;
+
+    if (querystring_getk(qs, key) == NULL && querystring_addk(qs, key, "") == NULL) return NULL;
+    if (querystring_getk(qs, key) == NULL) return NULL;
+
+    batch_t* batch = malloc(sizeof(batch_t));
+    if (batch == NULL) return NULL;
+
+    batch->endpoint = astring_from(endpoint);
+    if (batch->endpoint == NULL) {
+        free(batch);
+        return NULL;
+    }
+
+    batch->engine = engine;
+    batch->qs = qs;
+    batch->key = key;
+    batch->limit = BATCH_DEFAULT_LIMIT;
+    batch->max_bytes = BATCH_DEFAULT_BYTES;
+    batch->group = NULL;
+
+    return batch;
+}
+
+/**
+ * @brief Free a batch.
+ * 
+ * @note Values that were never flushed are dropped without calling their
+ * callbacks. Requests already submitted are unaffected.
+ * 
+ * @public
+ * 
+ * @param batch The batch to free
+*/
+void batch_free(batch_t* batch) {
+    if (batch == NULL) return;
+
+    if (batch->group != NULL) arena_free(batch->group->arena);
+    querystring_free(batch->qs, true);
+    astring_free(batch->endpoint);
+    free(batch);
+}
+
+/**
+ * @brief Set how many values are packed into one request.
+ * 
+ * @public
+ * 
+ * @param batch The batch to configure
+ * @param limit The most values per request, BATCH_DEFAULT_LIMIT or BATCH_HIGH_LIMIT
+ * @param max_bytes The budget for the encoded joined values
+*/
+void batch_setlimit(batch_t* batch, size_t limit, size_t max_bytes) {
+    if (batch == NULL) return;
+
+    batch->limit = (limit > 0) ? limit : 1;
+    batch->max_bytes = max_bytes;
+}
+
+/**
+ * @brief Queue a value, sending the pending batch first if the value would
+ * not fit in it.
+ * 
+ * @note A value that exceeds the byte budget on its own is still sent, alone.
+ * 
+ * @public
+ * 
+ * @param batch The batch to add to
+ * @param value The title or page id, which may not contain '|'
+ * @param callback The function called with the response
+ * @param userdata Passed through to the callback
+ * @return bool True if the value was queued, false if an error occurred
+*/
+bool batch_add(batch_t* batch, const char* value, batch_callback_t callback, void* userdata) {
+    if (batch == NULL || value == NULL) return false;
+
+    size_t value_len = strlen(value);
+    if (memchr(value, '|', value_len) != NULL) return false;
+
+    size_t bytes = urlencode_len(value, value_len);
+    batch_group_t* group = batch->group;
+
+    if (group != NULL && (group->count >= batch->limit || group->bytes + SEPARATOR_LEN + bytes > batch->max_bytes)) {
+        if (batch_flush(batch) == false) return false;
+        group = NULL;
+    }
+
+    if (group == NULL) {
+        group = group_new(batch->key);
+        if (group == NULL) return false;
+        batch->group = group;
+    }
+
+    batch_item_t* item = arena_alloc(group->arena, sizeof(batch_item_t));
+    astring_t* value_str = astring_from_in(group->arena, value);
+    if (item == NULL || value_str == NULL) return false;
+
+    item->value = value_str;
+    item->callback = callback;
+    item->userdata = userdata;
+    item->next = NULL;
+
+    if (group->tail != NULL) group->tail->next = item;
+    else group->head = item;
+    group->tail = item;
+    group->bytes += (group->count > 0) ? SEPARATOR_LEN + bytes : bytes;
+    group->count++;
+
+    // a failed flush leaves the group pending and is retried by the next add
+    if (group->count >= batch->limit) batch_flush(batch);
+
+    return true;
+}
+
+/**
+ * @brief Send the pending values as one request.
+ * 
+ * @note On failure the values stay pending so the flush can be retried.
+ * 
+ * @public
+ * 
+ * @param batch The batch to flush
+ * @return bool True if the request was submitted or nothing was pending
+*/
+bool batch_flush(batch_t* batch) {
+    if (batch == NULL) return false;
+
+    batch_group_t* group = batch->group;
+    if (group == NULL || group->count == 0) return true;
+
+    // the joined values are rebuilt in the pair's own buffer, which is reused
+    astring_t* joined = querystring_getk(batch->qs, batch->key);
+    if (joined == NULL || astring_into(joined, "") == NULL) return false;
+
+    batch_item_t* item = group->head;
+    for (; item != NULL; item = item->next) {
+        if (item != group->head && astring_appendn(joined, "|", 1) == NULL) return false;
+        if (astring_appenda(joined, item->value) == NULL) return false;
+    }
+
+    if (engine_submit(batch->engine, batch->endpoint->raw, batch->qs, group_done, group) == NULL) return false;
+
+    batch->group = NULL;
+    return true;
+}
+
+/**
+ * @brief Get the number of values waiting to be sent.
+ * 
+ * @public
+ * 
+ * @param batch The batch to query
+ * @return size_t The number of pending values
+*/
+size_t batch_pending(const batch_t* batch) {
+    if (batch == NULL || batch->group == NULL) return 0;
+
+    return batch->group->count;
+}
\ No newline at end of file
@@ -0,0 +1,601 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "cache.h"
+
+#define CACHE_FILE_MAGIC "CBCACHE2"
+#define CACHE_FILE_MAGIC_V1 "CBCACHE1"
+#define CACHE_FILE_HEADER 8
+#define CACHE_RECORD_MAGIC 0x52424343u
+#define CACHE_TOMBSTONE_MAGIC 0x54424343u
+#define CACHE_INDEX_MIN 64
+#define CACHE_NPOS ((size_t)-1)
+
+/**
+ * @brief Round a record length up to the 8 byte alignment of the file.
+ * 
+ * @internal
+*/
+static size_t pad8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+/**
+ * @brief Get the record at an offset of the mapped file.
+ * 
+ * @internal
+*/
+static const cache_record_t* record_at(const cache_t* cache, uint64_t offset) {
+    return (const cache_record_t*)(cache->map + offset);
+}
+
+/**
+ * @brief Compute the checksum of a record from its header, key and body.
+ * 
+ * @note The key is hashed from its bytes rather than taken from the stored
+ * hash, so a record whose key and hash disagree fails the check too.
+ * 
+ * @internal
+*/
+static uint64_t record_checksum(const cache_record_t* rec, const char* key, const char* body) {
+    uint64_t fields[7];
+
+    fields[0] = ((uint64_t)rec->magic << 32) | rec->key_len;
+    fields[1] = rec->body_len;
+    fields[2] = rec->hash;
+    fields[3] = astring_hashraw(key, rec->key_len);
+    fields[4] = astring_hashraw(body, (size_t)rec->body_len);
+    fields[5] = (uint64_t)rec->expires;
+    fields[6] = rec->revid;
+
+    return astring_hashraw((const char*)fields, sizeof(fields));
+}
+
+/**
+ * @brief Check whether a record is stale for a lookup.
+ * 
+ * @internal
+*/
+static bool is_stale(int64_t expires, uint64_t revid, uint64_t min_revid) {
+    if (expires != 0 && expires <= (int64_t)time(NULL)) return true;
+
+    return min_revid != 0 && revid < min_revid;
+}
+
+/**
+ * @brief Build the key and its hash for a query into the scratch buffer.
+ * 
+ * @internal
+*/
+static bool build_key(cache_t* cache, const char* endpoint, const querystring_t* qs, uint64_t* hash) {
+    if (astring_into(cache->key, endpoint) == NULL || astring_appendn(cache->key, "?", 1) == NULL) return false;
+    if (querystring_canonical_into(qs, cache->query) == NULL || astring_appenda(cache->key, cache->query) == NULL) return false;
+
+    *hash = astring_hashraw(cache->key->raw, cache->key->len);
+    return true;
+}
+
+/**
+ * @brief Find the index entry of the newest record for a key.
+ * 
+ * @internal
+*/
+static size_t index_find(const cache_t* cache, uint64_t hash, const char* key, size_t key_len) {
+    if (cache->index == NULL) return CACHE_NPOS;
+
+    size_t mask = cache->index_cap - 1;
+    size_t i = (size_t)hash & mask;
+
+    for (; cache->index[i] != 0; i = (i + 1) & mask) {
+        const cache_record_t* rec = record_at(cache, cache->index[i] - 1);
+        if (rec->hash != hash || rec->key_len != key_len) continue;
+        if (memcmp((const char*)(rec + 1), key, key_len) == 0) return i;
+    }
+
+    return CACHE_NPOS;
+}
+
+/**
+ * @brief Grow the index and reinsert every record offset.
+ * 
+ * @internal
+*/
+static bool index_grow(cache_t* cache) {
+    size_t cap = (cache->index_cap == 0) ? CACHE_INDEX_MIN : cache->index_cap * 2;
+    uint64_t* index = calloc(cap, sizeof(uint64_t));
+    if (index == NULL) return false;
+
+    size_t i = 0;
+    for (; i < cache->index_cap; i++) {
+        if (cache->index[i] == 0) continue;
+
+        size_t j = (size_t)record_at(cache, cache->index[i] - 1)->hash & (cap - 1);
+        while (index[j] != 0) j = (j + 1) & (cap - 1);
+        index[j] = cache->index[i];
+    }
+
+    free(cache->index);
+    cache->index = index;
+    cache->index_cap = cap;
+    return true;
+}
+
+/**
+ * @brief Point the index at a record, replacing older records for its key.
+ * 
+ * @internal
+*/
+static bool index_set(cache_t* cache, uint64_t offset) {
+    const cache_record_t* rec = record_at(cache, offset);
+    size_t slot = index_find(cache, rec->hash, (const char*)(rec + 1), rec->key_len);
+
+    if (slot != CACHE_NPOS) {
+        cache->index[slot] = offset + 1;
+        return true;
+    }
+
+    if ((cache->index_used + 1) * 4 > cache->index_cap * 3 && index_grow(cache) == false) return false;
+
+    size_t mask = cache->index_cap - 1;
+    size_t i = (size_t)rec->hash & mask;
+    while (cache->index[i] != 0) i = (i + 1) & mask;
+
+    cache->index[i] = offset + 1;
+    cache->index_used++;
+    return true;
+}
+
+/**
+ * @brief Make sure the mapping covers the whole valid part of the file.
+ * 
+ * @internal
+*/
+static bool remap(cache_t* cache) {
+    if (cache->map != NULL && cache->size <= cache->map_len) return true;
+
+    size_t len = (cache->map_len > 0) ? cache->map_len : CACHE_MAP_MIN;
+    while (len < cache->size) len *= 2;
+
+    // mapping past the end of the file is fine as long as it is not touched
+    char* map = mmap(NULL, len, PROT_READ, MAP_SHARED, cache->fd, 0);
+    if (map == MAP_FAILED) return false;
+
+    if (cache->map != NULL) munmap(cache->map, cache->map_len);
+    cache->map = map;
+    cache->map_len = len;
+    return true;
+}
+
+/**
+ * @brief Load the index from the records in the file.
+ * 
+ * @note A record cut short or left corrupt by a crash fails its checksum and
+ * ends the scan, and the file is truncated back to the last good record.
+ * 
+ * @internal
+*/
+static bool scan(cache_t* cache) {
+    size_t off = CACHE_FILE_HEADER;
+
+    while (off + sizeof(cache_record_t) <= cache->size) {
+        const cache_record_t* rec = record_at(cache, off);
+        if (rec->magic != CACHE_RECORD_MAGIC && rec->magic != CACHE_TOMBSTONE_MAGIC) break;
+        if (rec->body_len > cache->size || rec->key_len > cache->size) break;
+
+        size_t total = sizeof(cache_record_t) + pad8((size_t)rec->key_len + (size_t)rec->body_len);
+        if (off + total > cache->size) break;
+
+        const char* key = (const char*)(rec + 1);
+        if (record_checksum(rec, key, key + rec->key_len) != rec->checksum) break;
+
+        if (index_set(cache, off) == false) return false;
+        off += total;
+    }
+
+    if (off < cache->size) {
+        if (ftruncate(cache->fd, (off_t)off) != 0) return false;
+        cache->size = off;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Find an entry of the in-memory front.
+ * 
+ * @internal
+*/
+static cache_entry_t* front_find(const cache_t* cache, uint64_t hash, const astring_t* key) {
+    if (cache->buckets == NULL) return NULL;
+
+    cache_entry_t* e = cache->buckets[hash & (cache->bucket_cap - 1)];
+    for (; e != NULL; e = e->chain) {
+        if (e->hash == hash && e->key->len == key->len && memcmp(e->key->raw, key->raw, key->len) == 0) return e;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Unlink an entry from the recency list.
+ * 
+ * @internal
+*/
+static void front_unlink(cache_t* cache, cache_entry_t* e) {
+    if (e->prev != NULL) e->prev->next = e->next;
+    else cache->head = e->next;
+    if (e->next != NULL) e->next->prev = e->prev;
+    else cache->tail = e->prev;
+
+    e->prev = NULL;
+    e->next = NULL;
+}
+
+/**
+ * @brief Make an entry the most recently used one.
+ * 
+ * @internal
+*/
+static void front_touch(cache_t* cache, cache_entry_t* e) {
+    if (cache->head == e) return;
+
+    front_unlink(cache, e);
+    e->next = cache->head;
+    if (cache->head != NULL) cache->head->prev = e;
+    cache->head = e;
+    if (cache->tail == NULL) cache->tail = e;
+}
+
+/**
+ * @brief Remove an entry from the front and free it.
+ * 
+ * @internal
+*/
+static void front_remove(cache_t* cache, cache_entry_t* e) {
+    cache_entry_t** link = &cache->buckets[e->hash & (cache->bucket_cap - 1)];
+    while (*link != e) link = &(*link)->chain;
+    *link = e->chain;
+
+    front_unlink(cache, e);
+    cache->memory -= sizeof(cache_entry_t) + e->key->len + e->body->len;
+    cache->count--;
+
+    astring_free(e->key);
+    astring_free(e->body);
+    free(e);
+}
+
+/**
+ * @brief Double the number of buckets of the front.
+ * 
+ * @internal
+*/
+static bool front_grow(cache_t* cache) {
+    size_t cap = (cache->bucket_cap == 0) ? CACHE_INDEX_MIN : cache->bucket_cap * 2;
+    cache_entry_t** buckets = calloc(cap, sizeof(cache_entry_t*));
+    if (buckets == NULL) return false;
+
+    cache_entry_t* e = cache->head;
+    for (; e != NULL; e = e->next) {
+        size_t b = e->hash & (cap - 1);
+        e->chain = buckets[b];
+        buckets[b] = e;
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_cap = cap;
+    return true;
+}
+
+/**
+ * @brief Store an entry in the front, evicting the least recently used ones.
+ * 
+ * @internal
+*/
+static void front_put(cache_t* cache, uint64_t hash, const astring_t* key, const char* body, size_t len, int64_t expires, uint64_t revid) {
+    cache_entry_t* old = front_find(cache, hash, key);
+    if (old != NULL) front_remove(cache, old);
+
+    size_t cost = sizeof(cache_entry_t) + key->len + len;
+    if (cost > cache->memory_limit) return;
+    if (cache->count >= cache->bucket_cap && front_grow(cache) == false) return;
+
+    cache_entry_t* e = calloc(1, sizeof(cache_entry_t));
+    if (e == NULL) return;
+
+    e->key = astring_new(key->len + 1);
+    e->body = astring_new(len + 1);
+    if (e->key == NULL || e->body == NULL || astring_appenda(e->key, key) == NULL || astring_appendn(e->body, body, len) == NULL) {
+        astring_free(e->key);
+        astring_free(e->body);
+        free(e);
+        return;
+    }
+
+    e->hash = hash;
+    e->expires = expires;
+    e->revid = revid;
+
+    size_t b = hash & (cache->bucket_cap - 1);
+    e->chain = cache->buckets[b];
+    cache->buckets[b] = e;
+
+    // a new entry is not linked yet, so it goes straight to the head
+    e->next = cache->head;
+    if (cache->head != NULL) cache->head->prev = e;
+    cache->head = e;
+    if (cache->tail == NULL) cache->tail = e;
+    cache->memory += cost;
+    cache->count++;
+
+    while (cache->memory > cache->memory_limit && cache->tail != NULL) front_remove(cache, cache->tail);
+}
+
+/**
+ * @brief Replace the contents of an astring with a buffer.
+ * 
+ * @internal
+*/
+static bool copy_into(astring_t* dest, const char* data, size_t len) {
+    if (astring_reserve(dest, len + 1) == NULL) return false;
+
+    memcpy(dest->raw, data, len);
+    dest->raw[len] = '\0';
+    dest->len = len;
+    return true;
+}
+
+/**
+ * @brief Append a record to the file and index it.
+ * 
+ * @internal
+*/
+static bool append_record(cache_t* cache, uint32_t magic, uint64_t hash, const char* body, size_t len, int64_t expires, uint64_t revid) {
+    static const char zeros[8] = { 0 };
+    cache_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+
+    rec.magic = magic;
+    rec.key_len = (uint32_t)cache->key->len;
+    rec.body_len = len;
+    rec.hash = hash;
+    rec.expires = expires;
+    rec.revid = revid;
+    rec.checksum = record_checksum(&rec, cache->key->raw, body);
+
+    size_t payload = cache->key->len + len;
+    struct iovec iov[4] = {
+        { &rec, sizeof(rec) },
+        { cache->key->raw, cache->key->len },
+        { (void*)body, len },
+        { (void*)zeros, pad8(payload) - payload }
+    };
+
+    size_t total = sizeof(rec) + pad8(payload);
+    ssize_t written = pwritev(cache->fd, iov, 4, (off_t)cache->size);
+    if (written < 0 || (size_t)written != total) {
+        // drop a partial record so the next one starts at a valid offset
+        if (ftruncate(cache->fd, (off_t)cache->size) != 0) return false;
+        return false;
+    }
+
+    size_t offset = cache->size;
+    cache->size += total;
+
+    return remap(cache) && index_set(cache, offset);
+}
+
+/**
+ * @brief Open a cache file, creating it if it does not exist.
+ * 
+ * @note The file is locked for the lifetime of the cache, so only one
+ * process can use it at a time.
+ * 
+ * @public
+ * 
+ * @param path The path of the cache file, or NULL for a memory-only cache
+ * @param memory_limit The byte budget of the in-memory front, or 0 for CACHE_DEFAULT_MEMORY
+ * @return cache_t* The cache, or NULL if the file could not be opened or is not a cache file
+*/
+cache_t* cache_open(const char* path, size_t memory_limit) {
+    cache_t* cache = calloc(1, sizeof(cache_t));
+    if (cache == NULL) return NULL;
+
+    cache->fd = -1;
+    cache->memory_limit = (memory_limit > 0) ? memory_limit : CACHE_DEFAULT_MEMORY;
+    cache->key = astring_new(ASTRING_GROWTH_MIN);
+    cache->query = astring_new(ASTRING_GROWTH_MIN);
+    if (cache->key == NULL || cache->query == NULL) goto fail;
+    if (path == NULL) return cache;
+
+    cache->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (cache->fd < 0 || flock(cache->fd, LOCK_EX | LOCK_NB) != 0) goto fail;
+
+    struct stat st;
+    if (fstat(cache->fd, &st) != 0) goto fail;
+
+    cache->size = (size_t)st.st_size;
+    if (cache->size == 0) {
+        if (write(cache->fd, CACHE_FILE_MAGIC, CACHE_FILE_HEADER) != CACHE_FILE_HEADER) goto fail;
+        cache->size = CACHE_FILE_HEADER;
+    }
+
+    // records of the first format carry no checksum, and a cache can always be refilled
+    if (cache->size >= CACHE_FILE_HEADER) {
+        char magic[CACHE_FILE_HEADER];
+        if (pread(cache->fd, magic, CACHE_FILE_HEADER, 0) != CACHE_FILE_HEADER) goto fail;
+
+        if (memcmp(magic, CACHE_FILE_MAGIC_V1, CACHE_FILE_HEADER) == 0) {
+            if (ftruncate(cache->fd, 0) != 0 || pwrite(cache->fd, CACHE_FILE_MAGIC, CACHE_FILE_HEADER, 0) != CACHE_FILE_HEADER) goto fail;
+            cache->size = CACHE_FILE_HEADER;
+        }
+    }
+
+    if (remap(cache) == false) goto fail;
+    if (cache->size < CACHE_FILE_HEADER || memcmp(cache->map, CACHE_FILE_MAGIC, CACHE_FILE_HEADER) != 0) goto fail;
+    if (scan(cache) == false) goto fail;
+
+    return cache;
+
+fail:
+    cache_close(cache);
+    return NULL;
+}
+
+/**
+ * @brief Close a cache.
+ * 
+ * @public
+ * 
+ * @param cache The cache to close
+*/
+void cache_close(cache_t* cache) {
+    if (cache == NULL) return;
+
+    while (cache->head != NULL) front_remove(cache, cache->head);
+
+    if (cache->map != NULL) munmap(cache->map, cache->map_len);
+    if (cache->fd >= 0) close(cache->fd);
+
+    free(cache->buckets);
+    free(cache->index);
+    astring_free(cache->key);
+    astring_free(cache->query);
+    free(cache);
+}
+
+/**
+ * @brief Look up the cached response to a query.
+ * 
+ * @public
+ * 
+ * @param cache The cache to look in
+ * @param endpoint The API endpoint URL
+ * @param qs The query
+ * @param min_revid The oldest acceptable revision, or 0 to accept any
+ * @param dest The astring to copy the response into
+ * @return bool True if a fresh response was found, false otherwise
+*/
+bool cache_get(cache_t* cache, const char* endpoint, const querystring_t* qs, uint64_t min_revid, astring_t* dest) {
+    if (cache == NULL || endpoint == NULL || qs == NULL || dest == NULL) return false;
+
+    uint64_t hash;
+    if (build_key(cache, endpoint, qs, &hash) == false) return false;
+
+    cache_entry_t* e = front_find(cache, hash, cache->key);
+    if (e != NULL) {
+        if (is_stale(e->expires, e->revid, min_revid)) {
+            cache->misses++;
+            return false;
+        }
+
+        front_touch(cache, e);
+        cache->hits++;
+        return copy_into(dest, e->body->raw, e->body->len);
+    }
+
+    size_t slot = index_find(cache, hash, cache->key->raw, cache->key->len);
+    if (slot == CACHE_NPOS) {
+        cache->misses++;
+        return false;
+    }
+
+    const cache_record_t* rec = record_at(cache, cache->index[slot] - 1);
+    if (rec->magic == CACHE_TOMBSTONE_MAGIC || is_stale(rec->expires, rec->revid, min_revid)) {
+        cache->misses++;
+        return false;
+    }
+
+    const char* body = (const char*)(rec + 1) + rec->key_len;
+    if (copy_into(dest, body, (size_t)rec->body_len) == false) return false;
+
+    front_put(cache, hash, cache->key, body, (size_t)rec->body_len, rec->expires, rec->revid);
+    cache->hits++;
+    return true;
+}
+
+/**
+ * @brief Store the response to a query.
+ * 
+ * @public
+ * 
+ * @param cache The cache to store in
+ * @param endpoint The API endpoint URL
+ * @param qs The query
+ * @param body The response body
+ * @param len The length of the response body
+ * @param ttl The number of seconds the response stays fresh, or 0 for no limit
+ * @param revid The revision the response reflects, or 0 if unknown
+ * @return bool True if the response was stored, false otherwise
+*/
+bool cache_put(cache_t* cache, const char* endpoint, const querystring_t* qs, const char* body, size_t len, int64_t ttl, uint64_t revid) {
+    if (cache == NULL || endpoint == NULL || qs == NULL || (body == NULL && len > 0)) return false;
+
+    uint64_t hash;
+    if (build_key(cache, endpoint, qs, &hash) == false) return false;
+
+    int64_t expires = (ttl > 0) ? (int64_t)time(NULL) + ttl : 0;
+
+    if (cache->fd >= 0 && append_record(cache, CACHE_RECORD_MAGIC, hash, body, len, expires, revid) == false) return false;
+
+    front_put(cache, hash, cache->key, body, len, expires, revid);
+    return true;
+}
+
+/**
+ * @brief Drop the cached response to a query.
+ * 
+ * @note The removal is recorded in the file, so it also holds for later runs.
+ * 
+ * @public
+ * 
+ * @param cache The cache to remove from
+ * @param endpoint The API endpoint URL
+ * @param qs The query
+ * @return bool True if the removal was recorded, false otherwise
+*/
+bool cache_remove(cache_t* cache, const char* endpoint, const querystring_t* qs) {
+    if (cache == NULL || endpoint == NULL || qs == NULL) return false;
+
+    uint64_t hash;
+    if (build_key(cache, endpoint, qs, &hash) == false) return false;
+
+    cache_entry_t* e = front_find(cache, hash, cache->key);
+    if (e != NULL) front_remove(cache, e);
+
+    if (cache->fd < 0 || index_find(cache, hash, cache->key->raw, cache->key->len) == CACHE_NPOS) return true;
+
+    return append_record(cache, CACHE_TOMBSTONE_MAGIC, hash, NULL, 0, 0, 0);
+}
\ No newline at end of file
@@ -25,21 +25,93 @@
 #include <stdio.h>
 
 #include "astring.h"
+#include "engine.h"
+#include "executor.h"
 #include "querystring.h"
 
+/** One endpoint's query, carried from the I/O thread to a worker. */
+typedef struct {
+    executor_t* executor;
+    engine_t* engine;
+    const char* endpoint;
+    const querystring_t* qs;
+    CURLcode result;
+    long status;
+    astring_t* body;
+} fetch_t;
+
+static void print_response(void* arg) {
+    fetch_t* fetch = arg;
+
+    if (fetch->result != CURLE_OK) {
+        fprintf(stderr, "%s: %s\n", fetch->endpoint, curl_easy_strerror(fetch->result));
+        return;
+    }
+
+    printf("%s: %ld %s\n", fetch->endpoint, fetch->status, fetch->body->raw);
+
+    // the buffer goes back to the I/O thread's pool for its next response
+    engine_recycle(fetch->engine, fetch->body);
+    fetch->body = NULL;
+}
+
+static void on_response(engine_request_t* req, void* userdata) {
+    fetch_t* fetch = userdata;
+
+    // keep the body and hand it to a worker, the I/O thread only moves bytes
+    fetch->result = req->result;
+    fetch->status = req->status;
+    fetch->body = req->body;
+    req->body = NULL;
+
+    executor_submit(fetch->executor, fetch->endpoint, print_response, fetch);
+}
+
+static void start_fetch(engine_t* engine, void* arg) {
+    fetch_t* fetch = arg;
+
+    fetch->engine = engine;
+    if (engine_submit(engine, fetch->endpoint, fetch->qs, on_response, fetch) == NULL) {
+        fetch->result = CURLE_OUT_OF_MEMORY;
+        executor_submit(fetch->executor, fetch->endpoint, print_response, fetch);
+    }
+}
+
 int main(int argc, char** argv) {
     querystring_t* qs = querystring_new();
     astring_t* querystring;
 
-    qs = querystring_addfrom(qs, "action", "query");
-    qs = querystring_addfrom(qs, "titles", "Main Page");
-    qs = querystring_addfrom(qs, "prop", "revisions");
-    qs = querystring_addfrom(qs, "rvprop", "content");
-    qs = querystring_addfrom(qs, "format", "json");
-    qs = querystring_addfrom(qs, "formatversion", "2");
+    qs = querystring_addk(qs, APIKEY_ACTION, "query");
+    qs = querystring_addk(qs, APIKEY_TITLES, "Main Page");
+    qs = querystring_addk(qs, APIKEY_PROP, "revisions");
+    qs = querystring_addk(qs, APIKEY_RVPROP, "content");
+    qs = querystring_addk(qs, APIKEY_FORMAT, "json");
+    qs = querystring_addk(qs, APIKEY_FORMATVERSION, "2");
     querystring = querystring_tostring(qs);
 
     printf("%s\n", querystring->raw);
+
+    // with API endpoints such as https://community.fandom.com/api.php, run the query against each
+    if (argc > 1) {
+        executor_t* executor = executor_new(0, 0);
+        fetch_t* fetches = calloc((size_t)argc - 1, sizeof(fetch_t));
+        int i = 1;
+
+        for (; executor != NULL && fetches != NULL && i < argc; i++) {
+            fetch_t* fetch = &fetches[i - 1];
+
+            fetch->executor = executor;
+            fetch->endpoint = argv[i];
+            fetch->qs = qs;
+            executor_submitio(executor, argv[i], start_fetch, fetch);
+        }
+
+        executor_free(executor);
+
+        for (i = 1; fetches != NULL && i < argc; i++) astring_free(fetches[i - 1].body);
+        free(fetches);
+    }
+
     querystring_free(qs, true);
     astring_free(querystring);
 
@@ -0,0 +1,910 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "engine.h"
+
+#define ENGINE_EVENTS 64
+
+/**
+ * @brief Find the value of a form-encoded parameter.
+ * 
+ * @internal
+*/
+static const char* param_find(const char* params, const char* key, size_t* len) {
+    size_t key_len = strlen(key);
+    const char* p = params;
+
+    while (p != NULL && *p != '\0') {
+        if (strncmp(p, key, key_len) == 0 && p[key_len] == '=') {
+            p += key_len + 1;
+            *len = strcspn(p, "&#");
+            return p;
+        }
+
+        p = strchr(p, '&');
+        if (p != NULL) p++;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Find the size hint slot of a request's endpoint and action.
+ * 
+ * @note The action is read from the query or the POST body. Keying on it
+ * keeps, say, small token requests from sharing a hint with page content.
+ * 
+ * @internal
+*/
+static engine_hint_t* hint_slot(engine_t* engine, const engine_request_t* req, uint64_t* hash) {
+    const astring_t* url = req->url;
+    size_t len = astring_findc(url, '?');
+    const char* action = NULL;
+    size_t action_len = 0;
+
+    if (len != ASTRING_NPOS) action = param_find(url->raw + len + 1, "action", &action_len);
+    else len = url->len;
+    if (action == NULL && req->post != NULL) action = param_find(req->post->raw, "action", &action_len);
+
+    *hash = astring_hashraw(url->raw, len);
+    if (action != NULL) *hash ^= astring_hashraw(action, action_len) * 0x9e3779b97f4a7c15ULL;
+
+    return &engine->hints[*hash & (ENGINE_HINT_SLOTS - 1)];
+}
+
+/**
+ * @brief Reserve the whole response body up front, so chunks are appended without reallocating.
+ * 
+ * @note Content-Length is the compressed size for compressed responses, so
+ * the endpoint's earlier responses usually give the better estimate.
+ * 
+ * @internal
+*/
+static void presize(engine_request_t* req) {
+    uint64_t hash;
+    engine_hint_t* hint = hint_slot(req->engine, req, &hash);
+    size_t expected = (hint->hash == hash) ? hint->size : 0;
+
+    // one huge response should not make every later one reserve a buffer too big to pool
+    if (expected > ENGINE_POOL_MAX_BYTES) expected = ENGINE_POOL_MAX_BYTES;
+    curl_off_t length = -1;
+
+    if (curl_easy_getinfo(req->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK && length > 0 && (size_t)length > expected) {
+        expected = (size_t)length;
+    }
+
+    // a failed reservation only means the appends grow the buffer instead
+    if (expected > 0) astring_reserve(req->body, expected + 1);
+}
+
+/**
+ * @brief Learn the size of a completed response for later requests to its endpoint and action.
+ * 
+ * @internal
+*/
+static void learn(engine_t* engine, const engine_request_t* req) {
+    if (req->body == NULL || req->sink != NULL || req->result != CURLE_OK) return;
+
+    uint64_t hash;
+    engine_hint_t* hint = hint_slot(engine, req, &hash);
+    size_t size = req->body->len;
+
+    if (hint->hash == hash) {
+        size_t decayed = hint->size - hint->size / 8;
+        hint->size = (size > decayed) ? size : decayed;
+    } else {
+        hint->hash = hash;
+        hint->size = size;
+    }
+}
+
+/**
+ * @brief Appends a received chunk to the response body.
+ * 
+ * @note curl decompresses chunk by chunk before calling this, so the
+ * compressed body is never held in full.
+ * 
+ * @internal
+*/
+static size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    engine_request_t* req = userdata;
+    size_t len = size * nmemb;
+
+    if (req->sink != NULL) {
+        req->decoded_bytes += (curl_off_t)len;
+        if (req->engine->timing == NULL) return req->sink(req->sink_data, ptr, len) ? len : 0;
+
+        // a sink parses as the body arrives, so its time counts towards parsing
+        uint64_t start = timing_now();
+        bool ok = req->sink(req->sink_data, ptr, len);
+        req->phases[TIMING_PARSE] += timing_now() - start;
+        return ok ? len : 0;
+    }
+
+    if (req->decoded_bytes == 0) presize(req);
+
+    req->decoded_bytes += (curl_off_t)len;
+    if (astring_appendn(req->body, ptr, len) == NULL) return 0;
+
+    return len;
+}
+
+/**
+ * @brief Keeps the epoll set in sync with the sockets curl wants watched.
+ * 
+ * @note socketp is only used as a marker that the socket is already registered.
+ * 
+ * @internal
+*/
+static int socket_cb(CURL* easy, curl_socket_t s, int what, void* userp, void* socketp) {
+    engine_t* engine = userp;
+
+    if (what == CURL_POLL_REMOVE) {
+        epoll_ctl(engine->epfd, EPOLL_CTL_DEL, s, NULL);
+        curl_multi_assign(engine->multi, s, NULL);
+        return 0;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.data.fd = s;
+    if (what & CURL_POLL_IN) ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT) ev.events |= EPOLLOUT;
+
+    if (socketp == NULL) {
+        if (epoll_ctl(engine->epfd, EPOLL_CTL_ADD, s, &ev) != 0) return -1;
+        curl_multi_assign(engine->multi, s, engine);
+    } else if (epoll_ctl(engine->epfd, EPOLL_CTL_MOD, s, &ev) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Arms or disarms the timerfd for curl's next timeout.
+ * 
+ * @internal
+*/
+static int timer_cb(CURLM* multi, long timeout_ms, void* userp) {
+    engine_t* engine = userp;
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+
+    if (timeout_ms == 0) {
+        // a zero it_value disarms the timer, so fire as soon as possible instead
+        its.it_value.tv_nsec = 1;
+    } else if (timeout_ms > 0) {
+        its.it_value.tv_sec = timeout_ms / 1000;
+        its.it_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+    }
+
+    return (timerfd_settime(engine->timerfd, 0, &its, NULL) == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Release a request and the buffers it still owns.
+ * 
+ * @internal
+*/
+static void request_free(engine_request_t* req) {
+    engine_t* engine = req->engine;
+
+    astring_free(req->url);
+    astring_free(req->post);
+    engine_recycle(engine, req->body);
+
+    if (engine->spare_len < ENGINE_POOL_BUFFERS) {
+        req->next = engine->spare;
+        engine->spare = req;
+        engine->spare_len++;
+        return;
+    }
+
+    free(req);
+}
+
+/**
+ * @brief Take an idle response buffer, or create one.
+ * 
+ * @internal
+*/
+static astring_t* buffer_acquire(engine_t* engine) {
+    if (engine->buffers_len == 0) {
+        engine->buffers_len = mpmc_popn(engine->returned, (void**)engine->buffers, ENGINE_POOL_BUFFERS);
+    }
+
+    if (engine->buffers_len == 0) return astring_new(1);
+
+    astring_t* body = engine->buffers[--engine->buffers_len];
+    body->len = 0;
+    body->raw[0] = '\0';
+    return body;
+}
+
+/**
+ * @brief Take an idle easy handle, creating one if the pool allows.
+ * 
+ * @internal
+*/
+static CURL* handle_acquire(engine_t* engine) {
+    if (engine->pool_len > 0) return engine->pool[--engine->pool_len];
+    if (engine->handles >= engine->max_handles) return NULL;
+
+    CURL* easy = curl_easy_init();
+    if (easy != NULL) engine->handles++;
+
+    return easy;
+}
+
+/**
+ * @brief Return an easy handle to the pool.
+ * 
+ * @note The connection stays in the multi handle's cache, only the options
+ * pointing at the finished request are cleared.
+ * 
+ * @internal
+*/
+static void handle_release(engine_t* engine, CURL* easy) {
+    curl_easy_reset(easy);
+    engine->pool[engine->pool_len++] = easy;
+}
+
+/**
+ * @brief Configure an easy handle for a request and add it to the multi handle.
+ * 
+ * @internal
+*/
+static bool request_start(engine_t* engine, engine_request_t* req, CURL* easy) {
+    curl_easy_setopt(easy, CURLOPT_URL, req->url->raw);
+    curl_easy_setopt(easy, CURLOPT_USERAGENT, ENGINE_USER_AGENT);
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, ENGINE_ACCEPT_ENCODING);
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_cb);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, req);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, req);
+
+    if (req->post != NULL) {
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)req->post->len);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, req->post->raw);
+    }
+
+    if (curl_multi_add_handle(engine->multi, easy) != CURLM_OK) return false;
+
+    req->easy = easy;
+    req->prev = NULL;
+    req->next = engine->active;
+    if (engine->active != NULL) engine->active->prev = req;
+    engine->active = req;
+    engine->running++;
+    return true;
+}
+
+/**
+ * @brief Finish a request whose transfer could not be started.
+ * 
+ * @internal
+*/
+static void request_fail(engine_request_t* req, CURLcode result) {
+    req->result = result;
+    if (req->callback != NULL) req->callback(req, req->userdata);
+    request_free(req);
+}
+
+/**
+ * @brief Start queued requests while there are handles to run them on.
+ * 
+ * @internal
+*/
+static void drain_queue(engine_t* engine) {
+    while (engine->queue != NULL) {
+        CURL* easy = handle_acquire(engine);
+        if (easy == NULL) return;
+
+        engine_request_t* req = engine->queue;
+        engine->queue = req->next;
+        if (engine->queue == NULL) engine->queue_tail = NULL;
+        engine->queued--;
+        req->next = NULL;
+
+        if (request_start(engine, req, easy) == false) {
+            handle_release(engine, easy);
+            request_fail(req, CURLE_FAILED_INIT);
+        }
+    }
+}
+
+/**
+ * @brief Find the timing series of a request's wiki and action.
+ * 
+ * @note The wiki is the scheme and authority of the URL, and the action is
+ * read from the query or the POST body.
+ * 
+ * @internal
+*/
+static timing_series_t* series_of(engine_t* engine, const engine_request_t* req) {
+    if (req->url == NULL) return NULL;
+
+    const char* url = req->url->raw;
+    const char* host = strstr(url, "://");
+    host = (host != NULL) ? host + 3 : url;
+
+    size_t wiki_len = (size_t)(host - url) + strcspn(host, "/?#");
+    const char* query = strchr(url, '?');
+    const char* action = NULL;
+    size_t action_len = 0;
+
+    if (query != NULL) action = param_find(query + 1, "action", &action_len);
+    if (action == NULL && req->post != NULL) action = param_find(req->post->raw, "action", &action_len);
+    if (action == NULL) action = "";
+
+    return timing_series(engine->timing, url, wiki_len, action, action_len);
+}
+
+/**
+ * @brief Split curl's cumulative transfer times into phases.
+ * 
+ * @note curl reports each time from the start of the transfer. The name
+ * lookup, connect and TLS times are those of the connection, so they are
+ * only counted when the transfer opened a new one.
+ * 
+ * @internal
+*/
+static void measure(engine_request_t* req, timing_series_t* series) {
+    curl_off_t dns = 0, connect = 0, tls = 0, pretransfer = 0, ttfb = 0, total = 0;
+    long connects = 0;
+
+    curl_easy_getinfo(req->easy, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(req->easy, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(req->easy, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(req->easy, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(req->easy, CURLINFO_STARTTRANSFER_TIME_T, &ttfb);
+    curl_easy_getinfo(req->easy, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(req->easy, CURLINFO_NUM_CONNECTS, &connects);
+
+    req->phases[TIMING_TOTAL] = (uint64_t)total * 1000;
+    timing_add(series, TIMING_TOTAL, req->phases[TIMING_TOTAL]);
+    if (req->phases[TIMING_BUILD] > 0) timing_add(series, TIMING_BUILD, req->phases[TIMING_BUILD]);
+
+    if (connects > 0 && connect >= dns) {
+        req->phases[TIMING_DNS] = (uint64_t)dns * 1000;
+        req->phases[TIMING_CONNECT] = (uint64_t)(connect - dns) * 1000;
+        timing_add(series, TIMING_DNS, req->phases[TIMING_DNS]);
+        timing_add(series, TIMING_CONNECT, req->phases[TIMING_CONNECT]);
+
+        if (tls >= connect && tls > 0) {
+            req->phases[TIMING_TLS] = (uint64_t)(tls - connect) * 1000;
+            timing_add(series, TIMING_TLS, req->phases[TIMING_TLS]);
+        }
+    }
+
+    // no first byte means no response, so there is nothing to split
+    if (ttfb > 0 && ttfb >= pretransfer && total >= ttfb) {
+        req->phases[TIMING_TTFB] = (uint64_t)(ttfb - pretransfer) * 1000;
+        req->phases[TIMING_TRANSFER] = (uint64_t)(total - ttfb) * 1000;
+        timing_add(series, TIMING_TTFB, req->phases[TIMING_TTFB]);
+        timing_add(series, TIMING_TRANSFER, req->phases[TIMING_TRANSFER]);
+    }
+}
+
+/**
+ * @brief Hand finished transfers to their callbacks.
+ * 
+ * @internal
+*/
+static void complete(engine_t* engine) {
+    CURLMsg* msg;
+    int left;
+
+    while ((msg = curl_multi_info_read(engine->multi, &left)) != NULL) {
+        if (msg->msg != CURLMSG_DONE) continue;
+
+        CURL* easy = msg->easy_handle;
+        CURLcode result = msg->data.result;
+        char* priv = NULL;
+
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, &priv);
+        engine_request_t* req = (engine_request_t*)priv;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &req->status);
+        curl_easy_getinfo(easy, CURLINFO_RETRY_AFTER, &req->retry_after);
+        curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &req->wire_bytes);
+        engine->wire_bytes += req->wire_bytes;
+        engine->decoded_bytes += req->decoded_bytes;
+        learn(engine, req);
+
+        // the callback may take the URL back, so the series is looked up first
+        timing_series_t* series = (engine->timing != NULL) ? series_of(engine, req) : NULL;
+        if (series != NULL) measure(req, series);
+
+        curl_multi_remove_handle(engine->multi, easy);
+        handle_release(engine, easy);
+        engine->running--;
+
+        if (req->prev != NULL) req->prev->next = req->next;
+        else engine->active = req->next;
+        if (req->next != NULL) req->next->prev = req->prev;
+
+        req->easy = NULL;
+        req->next = NULL;
+        req->prev = NULL;
+        req->result = result;
+
+        if (series != NULL) {
+            uint64_t start = timing_now();
+            if (req->callback != NULL) req->callback(req, req->userdata);
+            timing_add(series, TIMING_PARSE, req->phases[TIMING_PARSE] + timing_now() - start);
+        } else if (req->callback != NULL) {
+            req->callback(req, req->userdata);
+        }
+
+        request_free(req);
+    }
+
+    drain_queue(engine);
+}
+
+/**
+ * @brief Create a new request engine.
+ * 
+ * @public
+ * 
+ * @param max_handles The most requests in flight at once, or 0 for ENGINE_DEFAULT_HANDLES
+ * @return engine_t* The new engine, or NULL if an error occurred
+*/
+engine_t* engine_new(size_t max_handles) {
+    if (max_handles == 0) max_handles = ENGINE_DEFAULT_HANDLES;
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) return NULL;
+
+    engine_t* engine = calloc(1, sizeof(engine_t));
+    if (engine == NULL) goto fail;
+
+    engine->epfd = -1;
+    engine->timerfd = -1;
+    engine->wakefd = -1;
+    engine->max_handles = max_handles;
+    engine->pool = malloc(sizeof(CURL*) * max_handles);
+    engine->buffers = malloc(sizeof(astring_t*) * ENGINE_POOL_BUFFERS);
+    engine->returned = mpmc_new(ENGINE_POOL_BUFFERS);
+    engine->multi = curl_multi_init();
+    engine->epfd = epoll_create1(EPOLL_CLOEXEC);
+    engine->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    engine->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (engine->pool == NULL || engine->buffers == NULL || engine->returned == NULL || engine->multi == NULL || engine->epfd < 0 || engine->timerfd < 0 || engine->wakefd < 0) goto fail;
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = engine->timerfd;
+    if (epoll_ctl(engine->epfd, EPOLL_CTL_ADD, engine->timerfd, &ev) != 0) goto fail;
+
+    ev.data.fd = engine->wakefd;
+    if (epoll_ctl(engine->epfd, EPOLL_CTL_ADD, engine->wakefd, &ev) != 0) goto fail;
+
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETFUNCTION, socket_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_SOCKETDATA, engine);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERFUNCTION, timer_cb);
+    curl_multi_setopt(engine->multi, CURLMOPT_TIMERDATA, engine);
+    curl_multi_setopt(engine->multi, CURLMOPT_MAXCONNECTS, (long)max_handles);
+    curl_multi_setopt(engine->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    return engine;
+
+fail:
+    if (engine != NULL) {
+        if (engine->multi != NULL) curl_multi_cleanup(engine->multi);
+        if (engine->epfd >= 0) close(engine->epfd);
+        if (engine->timerfd >= 0) close(engine->timerfd);
+        if (engine->wakefd >= 0) close(engine->wakefd);
+        free(engine->pool);
+        free(engine->buffers);
+        mpmc_free(engine->returned);
+        free(engine);
+    }
+
+    curl_global_cleanup();
+    return NULL;
+}
+
+/**
+ * @brief Free a request engine.
+ * 
+ * @note Requests still in flight or queued are dropped without calling their
+ * callbacks.
+ * 
+ * @public
+ * 
+ * @param engine The engine to free
+*/
+void engine_free(engine_t* engine) {
+    if (engine == NULL) return;
+
+    while (engine->queue != NULL) {
+        engine_request_t* next = engine->queue->next;
+        request_free(engine->queue);
+        engine->queue = next;
+    }
+
+    while (engine->active != NULL) {
+        engine_request_t* next = engine->active->next;
+        curl_multi_remove_handle(engine->multi, engine->active->easy);
+        curl_easy_cleanup(engine->active->easy);
+        request_free(engine->active);
+        engine->active = next;
+    }
+
+    size_t i = 0;
+    for (; i < engine->pool_len; i++) curl_easy_cleanup(engine->pool[i]);
+    for (i = 0; i < engine->buffers_len; i++) astring_free(engine->buffers[i]);
+
+    astring_t* body;
+    while ((body = mpmc_pop(engine->returned)) != NULL) astring_free(body);
+
+    while (engine->spare != NULL) {
+        engine_request_t* next = engine->spare->next;
+        free(engine->spare);
+        engine->spare = next;
+    }
+
+    curl_multi_cleanup(engine->multi);
+    close(engine->epfd);
+    close(engine->timerfd);
+    close(engine->wakefd);
+    free(engine->pool);
+    free(engine->buffers);
+    mpmc_free(engine->returned);
+    free(engine);
+    curl_global_cleanup();
+}
+
+/**
+ * @brief Submit a request whose URL and body are already built.
+ * 
+ * @note The engine takes ownership of url and post, even on failure. A
+ * callback may take them back by setting the fields to NULL, for example
+ * to resubmit the request.
+ * 
+ * @public
+ * 
+ * @param engine The engine to submit to
+ * @param url The full request URL
+ * @param post The form-encoded POST body, or NULL for GET
+ * @param callback The function called when the request completes
+ * @param userdata Passed through to the callback
+ * @return engine_request_t* The request, or NULL if an error occurred
+*/
+engine_request_t* engine_submitraw(engine_t* engine, astring_t* url, astring_t* post, engine_callback_t callback, void* userdata) {
+    if (engine == NULL) {
+        astring_free(url);
+        astring_free(post);
+        return NULL;
+    }
+
+    engine_request_t* req = engine->spare;
+    if (req != NULL) {
+        engine->spare = req->next;
+        engine->spare_len--;
+        memset(req, 0, sizeof(engine_request_t));
+    } else {
+        req = calloc(1, sizeof(engine_request_t));
+    }
+
+    astring_t* body = buffer_acquire(engine);
+
+    if (req == NULL || url == NULL || body == NULL) {
+        free(req);
+        astring_free(url);
+        astring_free(post);
+        astring_free(body);
+        return NULL;
+    }
+
+    req->engine = engine;
+    req->url = url;
+    req->post = post;
+    req->body = body;
+    req->callback = callback;
+    req->userdata = userdata;
+
+    // curl rejects new handles from inside its own callbacks, such as a sink
+    CURL* easy = (engine->queue == NULL && engine->dispatching == false) ? handle_acquire(engine) : NULL;
+
+    if (easy != NULL) {
+        if (request_start(engine, req, easy) == false) {
+            handle_release(engine, easy);
+            request_free(req);
+            return NULL;
+        }
+
+        return req;
+    }
+
+    if (engine->queue_tail != NULL) engine->queue_tail->next = req;
+    else engine->queue = req;
+    engine->queue_tail = req;
+    engine->queued++;
+
+    return req;
+}
+
+/**
+ * @brief Build the GET URL of a query against an API endpoint.
+ * 
+ * @public
+ * 
+ * @param endpoint The API endpoint URL
+ * @param qs The query parameters
+ * @return astring_t* The new URL, or NULL if an error occurred
+*/
+astring_t* engine_url(const char* endpoint, const querystring_t* qs) {
+    if (endpoint == NULL || qs == NULL) return NULL;
+
+    size_t endpoint_len = strlen(endpoint);
+    astring_t* url = astring_new(querystring_encodedlen(qs) + 1);
+
+    // serialize the query first and prepend the endpoint into reserved headroom
+    if (url == NULL
+        || astring_reservefront(url, endpoint_len + 1) == NULL
+        || querystring_tostring_into(qs, url) == NULL
+        || astring_prepend(url, (memchr(endpoint, '?', endpoint_len) != NULL) ? "&" : "?") == NULL
+        || astring_prepend(url, endpoint) == NULL) {
+        astring_free(url);
+        return NULL;
+    }
+
+    return url;
+}
+
+/**
+ * @brief Submit a GET request to an API endpoint.
+ * 
+ * @note The request only makes progress while engine_poll or engine_run is
+ * called. The returned request is valid until its callback returns.
+ * 
+ * @public
+ * 
+ * @param engine The engine to submit to
+ * @param endpoint The API endpoint URL, such as https://community.fandom.com/api.php
+ * @param qs The query parameters, serialized immediately
+ * @param callback The function called when the request completes
+ * @param userdata Passed through to the callback
+ * @return engine_request_t* The request, or NULL if an error occurred
+*/
+engine_request_t* engine_submit(engine_t* engine, const char* endpoint, const querystring_t* qs, engine_callback_t callback, void* userdata) {
+    if (engine == NULL || endpoint == NULL || qs == NULL) return NULL;
+
+    uint64_t start = (engine->timing != NULL) ? timing_now() : 0;
+    astring_t* url = engine_url(endpoint, qs);
+    if (url == NULL) return NULL;
+
+    uint64_t built = (engine->timing != NULL) ? timing_now() - start : 0;
+    engine_request_t* req = engine_submitraw(engine, url, NULL, callback, userdata);
+    if (req != NULL) req->phases[TIMING_BUILD] = built;
+
+    return req;
+}
+
+/**
+ * @brief Submit a POST request to an API endpoint.
+ * 
+ * @note The parameters are sent as an application/x-www-form-urlencoded body,
+ * as the API requires for write actions such as action=edit.
+ * 
+ * @public
+ * 
+ * @param engine The engine to submit to
+ * @param endpoint The API endpoint URL
+ * @param qs The form parameters, serialized immediately
+ * @param callback The function called when the request completes
+ * @param userdata Passed through to the callback
+ * @return engine_request_t* The request, or NULL if an error occurred
+*/
+engine_request_t* engine_submitpost(engine_t* engine, const char* endpoint, const querystring_t* qs, engine_callback_t callback, void* userdata) {
+    if (engine == NULL || endpoint == NULL || qs == NULL) return NULL;
+
+    uint64_t start = (engine->timing != NULL) ? timing_now() : 0;
+    astring_t* url = astring_from(endpoint);
+    astring_t* post = querystring_tostring(qs);
+    if (post == NULL) {
+        astring_free(url);
+        return NULL;
+    }
+
+    uint64_t built = (engine->timing != NULL) ? timing_now() - start : 0;
+    engine_request_t* req = engine_submitraw(engine, url, post, callback, userdata);
+    if (req != NULL) req->phases[TIMING_BUILD] = built;
+
+    return req;
+}
+
+/**
+ * @brief Stream a request's response body to a sink instead of buffering it.
+ * 
+ * @note Call this right after submitting, before the engine is polled again.
+ * 
+ * @public
+ * 
+ * @param req The request to redirect
+ * @param sink The function receiving each chunk, or NULL to buffer into body
+ * @param userdata Passed through to the sink
+*/
+void engine_setsink(engine_request_t* req, engine_sink_t sink, void* userdata) {
+    if (req == NULL) return;
+
+    req->sink = sink;
+    req->sink_data = userdata;
+}
+
+/**
+ * @brief Record the phases of the engine's requests into a timing collector.
+ * 
+ * @note Call this from the thread running the engine. Without a collector
+ * nothing is measured, which costs one branch per request.
+ * 
+ * @public
+ * 
+ * @param engine The engine to instrument
+ * @param timing The collector, or NULL to stop measuring
+*/
+void engine_settiming(engine_t* engine, timing_t* timing) {
+    if (engine == NULL) return;
+
+    engine->timing = timing;
+}
+
+/**
+ * @brief Wait for socket activity once and process it.
+ * 
+ * @public
+ * 
+ * @param engine The engine to poll
+ * @param timeout_ms The most time to wait in milliseconds, or -1 to wait for activity
+ * @return int The number of requests still pending, or -1 if an error occurred
+*/
+int engine_poll(engine_t* engine, int timeout_ms) {
+    if (engine == NULL) return -1;
+
+    struct epoll_event events[ENGINE_EVENTS];
+    int running = 0;
+    int n = epoll_wait(engine->epfd, events, ENGINE_EVENTS, timeout_ms);
+
+    if (n < 0 && errno != EINTR) return -1;
+
+    engine->dispatching = true;
+
+    int i = 0;
+    for (; i < n; i++) {
+        if (events[i].data.fd == engine->timerfd) {
+            uint64_t expirations;
+            if (read(engine->timerfd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+                engine->dispatching = false;
+                return -1;
+            }
+
+            curl_multi_socket_action(engine->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+            continue;
+        }
+
+        if (events[i].data.fd == engine->wakefd) {
+            uint64_t wakeups;
+            if (read(engine->wakefd, &wakeups, sizeof(wakeups)) < 0 && errno != EAGAIN) {
+                engine->dispatching = false;
+                return -1;
+            }
+
+            continue;
+        }
+
+        int flags = 0;
+        if (events[i].events & EPOLLIN) flags |= CURL_CSELECT_IN;
+        if (events[i].events & EPOLLOUT) flags |= CURL_CSELECT_OUT;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) flags |= CURL_CSELECT_ERR;
+
+        curl_multi_socket_action(engine->multi, events[i].data.fd, flags, &running);
+    }
+
+    engine->dispatching = false;
+
+    complete(engine);
+
+    return (int)engine_pending(engine);
+}
+
+/**
+ * @brief Run the event loop until every submitted request has completed.
+ * 
+ * @public
+ * 
+ * @param engine The engine to run
+ * @return int 0 on success, or -1 if an error occurred
+*/
+int engine_run(engine_t* engine) {
+    if (engine == NULL) return -1;
+
+    while (engine_pending(engine) > 0) {
+        if (engine_poll(engine, -1) < 0) return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Hand a response buffer back to the engine for a later request.
+ * 
+ * @note Like engine_wake, this may be called from any thread, so a worker
+ * can return a body it took from a callback once it has parsed it. The
+ * buffer is freed instead if the pool is full or the buffer is too large.
+ * 
+ * @public
+ * 
+ * @param engine The engine the buffer came from
+ * @param body The buffer to recycle
+*/
+void engine_recycle(engine_t* engine, astring_t* body) {
+    if (body == NULL) return;
+
+    if (engine == NULL || body->arena != NULL || body->cap == 0 || body->cap > ENGINE_POOL_MAX_BYTES || mpmc_push(engine->returned, body) == false) {
+        astring_free(body);
+    }
+}
+
+/**
+ * @brief Make a blocked engine_poll return early.
+ * 
+ * @note This and engine_recycle are the only engine functions that may be
+ * called from a thread other than the one polling the engine.
+ * 
+ * @public
+ * 
+ * @param engine The engine to wake
+ * @return bool True if the engine was woken, false otherwise
+*/
+bool engine_wake(engine_t* engine) {
+    if (engine == NULL) return false;
+
+    uint64_t one = 1;
+    return write(engine->wakefd, &one, sizeof(one)) == sizeof(one) || errno == EAGAIN;
+}
+
+/**
+ * @brief Get the number of requests in flight or waiting for a handle.
+ * 
+ * @public
+ * 
+ * @param engine The engine to query
+ * @return size_t The number of pending requests
+*/
+size_t engine_pending(const engine_t* engine) {
+    if (engine == NULL) return 0;
+
+    return engine->running + engine->queued;
+}
\ No newline at end of file
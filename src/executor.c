@@ -0,0 +1,647 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "astring.h"
+#include "executor.h"
+
+/** The worker running on this thread, or NULL outside any pool. */
+static __thread executor_worker_t* current = NULL;
+
+/**
+ * @brief Map an affinity key to one of count slots.
+ * 
+ * @internal
+*/
+static size_t affinity_index(const char* affinity, size_t count) {
+    return (size_t)(astring_hashraw(affinity, strlen(affinity)) % count);
+}
+
+/**
+ * @brief Allocate a ring of cap slots.
+ * 
+ * @internal
+*/
+static executor_ring_t* ring_new(int64_t cap) {
+    executor_ring_t* ring = malloc(sizeof(executor_ring_t) + sizeof(executor_job_t) * (size_t)cap);
+    if (ring == NULL) return NULL;
+
+    ring->cap = cap;
+    ring->retired = NULL;
+    return ring;
+}
+
+/**
+ * @brief Write a job to a ring slot.
+ * 
+ * @note The fields are stored atomically because a thief may be reading a
+ * slot the owner has already reused, in which case its steal fails anyway.
+ * 
+ * @internal
+*/
+static void ring_put(executor_ring_t* ring, int64_t i, executor_job_t job) {
+    executor_job_t* slot = &ring->jobs[i & (ring->cap - 1)];
+
+    __atomic_store_n(&slot->fn, job.fn, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->arg, job.arg, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Read a job from a ring slot.
+ * 
+ * @internal
+*/
+static executor_job_t ring_get(executor_ring_t* ring, int64_t i) {
+    executor_job_t* slot = &ring->jobs[i & (ring->cap - 1)];
+    executor_job_t job;
+
+    job.fn = __atomic_load_n(&slot->fn, __ATOMIC_RELAXED);
+    job.arg = __atomic_load_n(&slot->arg, __ATOMIC_RELAXED);
+    return job;
+}
+
+/**
+ * @brief Push a job to the bottom of the worker's own deque.
+ * 
+ * @internal
+*/
+static bool deque_push(executor_worker_t* worker, executor_job_t job) {
+    int64_t bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&worker->top, __ATOMIC_ACQUIRE);
+    executor_ring_t* ring = worker->ring;
+
+    if (bottom - top >= ring->cap) {
+        executor_ring_t* grown = ring_new(ring->cap * 2);
+        if (grown == NULL) return false;
+
+        int64_t i = top;
+        for (; i < bottom; i++) ring_put(grown, i, ring_get(ring, i));
+
+        grown->retired = ring;
+        __atomic_store_n(&worker->ring, grown, __ATOMIC_RELEASE);
+        ring = grown;
+    }
+
+    ring_put(ring, bottom, job);
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Pop a job from the bottom of the worker's own deque.
+ * 
+ * @internal
+*/
+static bool deque_pop(executor_worker_t* worker, executor_job_t* job) {
+    int64_t bottom = __atomic_load_n(&worker->bottom, __ATOMIC_RELAXED) - 1;
+    executor_ring_t* ring = worker->ring;
+
+    // sequentially consistent rather than fenced, which ThreadSanitizer does not model
+    __atomic_store_n(&worker->bottom, bottom, __ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&worker->top, __ATOMIC_SEQ_CST);
+
+    if (top > bottom) {
+        __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *job = ring_get(ring, bottom);
+    if (top < bottom) return true;
+
+    // the last job, race the thieves for it
+    bool won = __atomic_compare_exchange_n(&worker->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&worker->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return won;
+}
+
+/**
+ * @brief Steal a job from the top of another worker's deque.
+ * 
+ * @internal
+*/
+static bool deque_steal(executor_worker_t* victim, executor_job_t* job) {
+    int64_t top = __atomic_load_n(&victim->top, __ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&victim->bottom, __ATOMIC_SEQ_CST);
+
+    if (top >= bottom) return false;
+
+    executor_ring_t* ring = __atomic_load_n(&victim->ring, __ATOMIC_ACQUIRE);
+    *job = ring_get(ring, top);
+
+    return __atomic_compare_exchange_n(&victim->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Append a job to a worker's inbox.
+ * 
+ * @internal
+*/
+static bool inbox_push(executor_worker_t* worker, executor_job_t job) {
+    pthread_mutex_lock(&worker->lock);
+
+    if (worker->inbox_len == worker->inbox_cap) {
+        size_t cap = (worker->inbox_cap == 0) ? 16 : worker->inbox_cap * 2;
+        executor_job_t* tmp = realloc(worker->inbox, sizeof(executor_job_t) * cap);
+        if (tmp == NULL) {
+            pthread_mutex_unlock(&worker->lock);
+            return false;
+        }
+
+        worker->inbox = tmp;
+        worker->inbox_cap = cap;
+    }
+
+    worker->inbox[worker->inbox_len] = job;
+    __atomic_store_n(&worker->inbox_len, worker->inbox_len + 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&worker->lock);
+    return true;
+}
+
+/**
+ * @brief Take the oldest job from a worker's inbox.
+ * 
+ * @internal
+*/
+static bool inbox_take(executor_worker_t* worker, executor_job_t* job) {
+    if (__atomic_load_n(&worker->inbox_len, __ATOMIC_RELAXED) == 0) return false;
+
+    pthread_mutex_lock(&worker->lock);
+
+    bool found = worker->inbox_head < worker->inbox_len;
+    if (found) *job = worker->inbox[worker->inbox_head++];
+    if (worker->inbox_head == worker->inbox_len) {
+        worker->inbox_head = 0;
+        __atomic_store_n(&worker->inbox_len, 0, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+/**
+ * @brief Move the worker's inbox into its deque, where other workers can steal from it.
+ * 
+ * @internal
+*/
+static void inbox_drain(executor_worker_t* worker) {
+    if (__atomic_load_n(&worker->inbox_len, __ATOMIC_RELAXED) == 0) return;
+
+    pthread_mutex_lock(&worker->lock);
+
+    for (; worker->inbox_head < worker->inbox_len; worker->inbox_head++) {
+        if (deque_push(worker, worker->inbox[worker->inbox_head]) == false) break;
+    }
+
+    if (worker->inbox_head == worker->inbox_len) {
+        worker->inbox_head = 0;
+        __atomic_store_n(&worker->inbox_len, 0, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&worker->lock);
+}
+
+/**
+ * @brief Find a job for a worker, first its own, then other workers'.
+ * 
+ * @internal
+*/
+static bool take(executor_worker_t* worker, executor_job_t* job) {
+    executor_t* executor = worker->executor;
+
+    if (deque_pop(worker, job)) goto found;
+
+    inbox_drain(worker);
+    if (deque_pop(worker, job)) goto found;
+
+    // xorshift, so thieves do not all line up on the same victim
+    worker->seed ^= worker->seed << 13;
+    worker->seed ^= worker->seed >> 7;
+    worker->seed ^= worker->seed << 17;
+
+    size_t start = (size_t)(worker->seed % executor->worker_count);
+    size_t i = 0;
+
+    for (; i < executor->worker_count; i++) {
+        executor_worker_t* victim = &executor->workers[(start + i) % executor->worker_count];
+        if (victim == worker) continue;
+
+        if (deque_steal(victim, job) || inbox_take(victim, job)) {
+            worker->stolen++;
+            goto found;
+        }
+    }
+
+    return false;
+
+found:
+    __atomic_sub_fetch(&executor->queued, 1, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+/**
+ * @brief Count down one unit of active work, waking executor_wait at zero.
+ * 
+ * @internal
+*/
+static void finish(executor_t* executor) {
+    if (__atomic_sub_fetch(&executor->active, 1, __ATOMIC_SEQ_CST) != 0) return;
+
+    pthread_mutex_lock(&executor->lock);
+    pthread_cond_broadcast(&executor->idle);
+    pthread_mutex_unlock(&executor->lock);
+}
+
+/**
+ * @brief Wake one idle worker if any is sleeping.
+ * 
+ * @internal
+*/
+static void notify(executor_t* executor) {
+    if (__atomic_load_n(&executor->sleepers, __ATOMIC_SEQ_CST) == 0) return;
+
+    pthread_mutex_lock(&executor->lock);
+    pthread_cond_signal(&executor->wake);
+    pthread_mutex_unlock(&executor->lock);
+}
+
+/**
+ * @brief The body of a worker thread.
+ * 
+ * @internal
+*/
+static void* worker_main(void* arg) {
+    executor_worker_t* worker = arg;
+    executor_t* executor = worker->executor;
+    executor_job_t job;
+
+    current = worker;
+
+    for (;;) {
+        int spins = 0;
+        bool found = false;
+
+        for (; spins < EXECUTOR_SPINS && found == false; spins++) found = take(worker, &job);
+
+        if (found) {
+            job.fn(job.arg);
+            worker->executed++;
+            finish(executor);
+            continue;
+        }
+
+        // a submitter bumps queued before checking sleepers, so one of the two sides sees the other
+        pthread_mutex_lock(&executor->lock);
+        __atomic_add_fetch(&executor->sleepers, 1, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&executor->queued, __ATOMIC_SEQ_CST) == 0 && executor->stopping == false) {
+            pthread_cond_wait(&executor->wake, &executor->lock);
+        }
+
+        __atomic_sub_fetch(&executor->sleepers, 1, __ATOMIC_SEQ_CST);
+        bool stop = executor->stopping && __atomic_load_n(&executor->queued, __ATOMIC_SEQ_CST) == 0;
+        pthread_mutex_unlock(&executor->lock);
+
+        if (stop) break;
+    }
+
+    current = NULL;
+    return NULL;
+}
+
+/**
+ * @brief Count the loop's engine as active work while it has requests pending.
+ * 
+ * @internal
+*/
+static void loop_track(executor_loop_t* loop) {
+    bool pending = engine_pending(loop->engine) > 0;
+
+    if (pending && loop->busy == false) {
+        __atomic_add_fetch(&loop->executor->active, 1, __ATOMIC_SEQ_CST);
+        loop->busy = true;
+    } else if (pending == false && loop->busy) {
+        loop->busy = false;
+        finish(loop->executor);
+    }
+}
+
+/**
+ * @brief The body of an I/O thread.
+ * 
+ * @internal
+*/
+static void* loop_main(void* arg) {
+    executor_loop_t* loop = arg;
+    executor_t* executor = loop->executor;
+    executor_iojob_t* jobs = NULL;
+    size_t jobs_cap = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&loop->lock);
+
+        // swap the inbox out so submitters are not held up while the jobs run
+        executor_iojob_t* tmp = jobs;
+        size_t len = loop->inbox_len;
+        size_t cap = jobs_cap;
+        jobs = loop->inbox;
+        jobs_cap = loop->inbox_cap;
+        loop->inbox = tmp;
+        loop->inbox_cap = cap;
+        loop->inbox_len = 0;
+
+        bool stopping = __atomic_load_n(&executor->stopping, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&loop->lock);
+
+        size_t i = 0;
+        for (; i < len; i++) jobs[i].fn(loop->engine, jobs[i].arg);
+
+        // track the requests the jobs submitted before the jobs themselves stop counting
+        loop_track(loop);
+        for (i = 0; i < len; i++) finish(executor);
+
+        if (stopping && len == 0 && engine_pending(loop->engine) == 0) break;
+
+        if (engine_poll(loop->engine, -1) < 0) break;
+        loop_track(loop);
+    }
+
+    free(jobs);
+    return NULL;
+}
+
+/**
+ * @brief Stop and join the threads started so far, then free the executor.
+ * 
+ * @internal
+*/
+static void teardown(executor_t* executor, size_t workers, size_t loops) {
+    size_t i = 0;
+
+    pthread_mutex_lock(&executor->lock);
+    __atomic_store_n(&executor->stopping, true, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&executor->wake);
+    pthread_mutex_unlock(&executor->lock);
+
+    for (i = 0; i < loops; i++) {
+        engine_wake(executor->loops[i].engine);
+        pthread_join(executor->loops[i].thread, NULL);
+    }
+
+    for (i = 0; i < workers; i++) pthread_join(executor->workers[i].thread, NULL);
+
+    for (i = 0; i < executor->loop_count; i++) {
+        engine_free(executor->loops[i].engine);
+        pthread_mutex_destroy(&executor->loops[i].lock);
+        free(executor->loops[i].inbox);
+    }
+
+    for (i = 0; i < executor->worker_count; i++) {
+        executor_ring_t* ring = executor->workers[i].ring;
+
+        while (ring != NULL) {
+            executor_ring_t* retired = ring->retired;
+            free(ring);
+            ring = retired;
+        }
+
+        pthread_mutex_destroy(&executor->workers[i].lock);
+        free(executor->workers[i].inbox);
+    }
+
+    pthread_mutex_destroy(&executor->lock);
+    pthread_cond_destroy(&executor->wake);
+    pthread_cond_destroy(&executor->idle);
+    free(executor->workers);
+    free(executor->loops);
+    free(executor);
+}
+
+/**
+ * @brief Create a new executor and start its threads.
+ * 
+ * @public
+ * 
+ * @param workers The number of worker threads, or 0 for one per online CPU
+ * @param loops The number of I/O threads, or 0 for EXECUTOR_DEFAULT_LOOPS
+ * @return executor_t* The new executor, or NULL if an error occurred
+*/
+executor_t* executor_new(size_t workers, size_t loops) {
+    if (workers == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (cpus > 0) ? (size_t)cpus : 1;
+    }
+
+    if (loops == 0) loops = EXECUTOR_DEFAULT_LOOPS;
+
+    executor_t* executor = calloc(1, sizeof(executor_t));
+    if (executor == NULL) return NULL;
+
+    executor->workers = calloc(workers, sizeof(executor_worker_t));
+    executor->loops = calloc(loops, sizeof(executor_loop_t));
+    if (executor->workers == NULL || executor->loops == NULL) {
+        free(executor->workers);
+        free(executor->loops);
+        free(executor);
+        return NULL;
+    }
+
+    pthread_mutex_init(&executor->lock, NULL);
+    pthread_cond_init(&executor->wake, NULL);
+    pthread_cond_init(&executor->idle, NULL);
+
+    size_t i = 0;
+
+    // set every worker up before any thread starts, since thieves look at all of them
+    for (; i < workers; i++) {
+        executor_worker_t* worker = &executor->workers[i];
+
+        worker->executor = executor;
+        worker->index = i;
+        worker->seed = 0x9E3779B97F4A7C15ULL * (i + 1);
+        pthread_mutex_init(&worker->lock, NULL);
+        executor->worker_count++;
+
+        if ((worker->ring = ring_new(EXECUTOR_DEQUE_MIN)) == NULL) {
+            teardown(executor, 0, 0);
+            return NULL;
+        }
+    }
+
+    // engines are created here, since curl's global setup is not thread safe everywhere
+    for (i = 0; i < loops; i++) {
+        executor_loop_t* loop = &executor->loops[i];
+
+        loop->executor = executor;
+        pthread_mutex_init(&loop->lock, NULL);
+        executor->loop_count++;
+
+        if ((loop->engine = engine_new(0)) == NULL) {
+            teardown(executor, 0, 0);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < workers; i++) {
+        if (pthread_create(&executor->workers[i].thread, NULL, worker_main, &executor->workers[i]) != 0) {
+            teardown(executor, i, 0);
+            return NULL;
+        }
+    }
+
+    for (i = 0; i < loops; i++) {
+        if (pthread_create(&executor->loops[i].thread, NULL, loop_main, &executor->loops[i]) != 0) {
+            teardown(executor, workers, i);
+            return NULL;
+        }
+    }
+
+    return executor;
+}
+
+/**
+ * @brief Free an executor.
+ * 
+ * @note Waits for every submitted task and request to finish first, so it
+ * must not be called from one of the executor's own threads.
+ * 
+ * @public
+ * 
+ * @param executor The executor to free
+*/
+void executor_free(executor_t* executor) {
+    if (executor == NULL) return;
+
+    executor_wait(executor);
+    teardown(executor, executor->worker_count, executor->loop_count);
+}
+
+/**
+ * @brief Submit a CPU-side task.
+ * 
+ * @note Tasks with the same affinity key go to the same worker, unless it is
+ * busy and another worker is idle, in which case the idle one steals them.
+ * Without a key, a task submitted from a worker stays on that worker and
+ * other tasks are spread round robin.
+ * 
+ * @public
+ * 
+ * @param executor The executor to run the task on
+ * @param affinity The affinity key, such as a wiki's endpoint, or NULL
+ * @param fn The task
+ * @param arg Passed through to the task
+ * @return bool True if the task was submitted, false otherwise
+*/
+bool executor_submit(executor_t* executor, const char* affinity, executor_task_t fn, void* arg) {
+    if (executor == NULL || fn == NULL) return false;
+
+    executor_worker_t* worker;
+    executor_job_t job = { fn, arg };
+
+    if (affinity != NULL) worker = &executor->workers[affinity_index(affinity, executor->worker_count)];
+    else if (current != NULL && current->executor == executor) worker = current;
+    else worker = &executor->workers[__atomic_fetch_add(&executor->next, 1, __ATOMIC_RELAXED) % executor->worker_count];
+
+    __atomic_add_fetch(&executor->active, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&executor->queued, 1, __ATOMIC_SEQ_CST);
+
+    // only the owner may push to a deque, everyone else goes through the inbox
+    bool pushed = (worker == current) ? deque_push(worker, job) : inbox_push(worker, job);
+
+    if (pushed == false) {
+        __atomic_sub_fetch(&executor->queued, 1, __ATOMIC_SEQ_CST);
+        finish(executor);
+        return false;
+    }
+
+    notify(executor);
+    return true;
+}
+
+/**
+ * @brief Submit a network task to an I/O thread.
+ * 
+ * @note The task runs on the I/O thread with that thread's engine, and so
+ * may submit requests to it directly. Request callbacks also run on the I/O
+ * thread and should hand heavy work back with executor_submit.
+ * 
+ * @public
+ * 
+ * @param executor The executor to run the task on
+ * @param affinity The affinity key, such as a wiki's endpoint, or NULL for the first I/O thread
+ * @param fn The task
+ * @param arg Passed through to the task
+ * @return bool True if the task was submitted, false otherwise
+*/
+bool executor_submitio(executor_t* executor, const char* affinity, executor_iotask_t fn, void* arg) {
+    if (executor == NULL || fn == NULL) return false;
+
+    executor_loop_t* loop = &executor->loops[(affinity != NULL) ? affinity_index(affinity, executor->loop_count) : 0];
+
+    pthread_mutex_lock(&loop->lock);
+
+    if (loop->inbox_len == loop->inbox_cap) {
+        size_t cap = (loop->inbox_cap == 0) ? 16 : loop->inbox_cap * 2;
+        executor_iojob_t* tmp = realloc(loop->inbox, sizeof(executor_iojob_t) * cap);
+        if (tmp == NULL) {
+            pthread_mutex_unlock(&loop->lock);
+            return false;
+        }
+
+        loop->inbox = tmp;
+        loop->inbox_cap = cap;
+    }
+
+    loop->inbox[loop->inbox_len].fn = fn;
+    loop->inbox[loop->inbox_len].arg = arg;
+    loop->inbox_len++;
+    __atomic_add_fetch(&executor->active, 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_unlock(&loop->lock);
+
+    engine_wake(loop->engine);
+    return true;
+}
+
+/**
+ * @brief Wait until every submitted task, and every request they started, has finished.
+ * 
+ * @note Must not be called from one of the executor's own threads.
+ * 
+ * @public
+ * 
+ * @param executor The executor to wait for
+*/
+void executor_wait(executor_t* executor) {
+    if (executor == NULL) return;
+
+    pthread_mutex_lock(&executor->lock);
+
+    while (__atomic_load_n(&executor->active, __ATOMIC_SEQ_CST) > 0) {
+        pthread_cond_wait(&executor->idle, &executor->lock);
+    }
+
+    pthread_mutex_unlock(&executor->lock);
+}
\ No newline at end of file
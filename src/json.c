@@ -0,0 +1,738 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+#include "memsearch.h"
+#include "simd.h"
+
+enum {
+    ST_VALUE,           /**< Expecting a value. */
+    ST_VALUE_OR_END,    /**< Expecting the first element or ']'. */
+    ST_KEY_OR_END,      /**< Expecting the first member name or '}'. */
+    ST_KEY,             /**< Expecting a member name. */
+    ST_COLON,           /**< Expecting ':' after a member name. */
+    ST_AFTER,           /**< Expecting ',' or the end of the container. */
+    ST_STRING,          /**< Inside a string. */
+    ST_ESCAPE,          /**< After a backslash in a string. */
+    ST_UNICODE,         /**< Reading the hex digits of a \u escape. */
+    ST_NUMBER,          /**< Inside a number. */
+    ST_LITERAL,         /**< Inside true, false or null. */
+    ST_DONE,            /**< The root value is complete. */
+    ST_ERROR            /**< Parsing failed. */
+};
+
+/**
+ * @brief Stop parsing with an error.
+ * 
+ * @internal
+*/
+static bool fail(json_parser_t* p, const char* msg) {
+    p->state = ST_ERROR;
+    p->error = msg;
+    return false;
+}
+
+/**
+ * @brief Deliver an event to every subscription in mask.
+ * 
+ * @note The event describes a value at the current depth, so container ends
+ * are emitted after their frame is popped and starts before it is pushed.
+ * 
+ * @internal
+*/
+static void emit(json_parser_t* p, uint64_t mask, json_type_t type, const char* data, size_t len, bool more) {
+    json_event_t ev;
+    ev.type = type;
+    ev.data = data;
+    ev.len = len;
+    ev.more = more;
+    ev.key = NULL;
+    ev.index = 0;
+    ev.depth = p->depth;
+    ev.offset = p->at;
+
+    if (p->depth > 0) {
+        const json_frame_t* parent = &p->frames[p->depth - 1];
+        if (parent->type == JSON_OBJECT_START && parent->has_key) ev.key = parent->key;
+        ev.index = parent->index;
+    }
+
+    while (mask != 0) {
+        const json_subscription_t* sub = &p->subs[simd_ctz64(mask)];
+        mask &= mask - 1;
+        sub->handler(p, &ev, sub->userdata);
+    }
+}
+
+/**
+ * @brief Check whether a path segment matches the current child of a container.
+ * 
+ * @internal
+*/
+static bool segment_matches(const json_segment_t* seg, const json_frame_t* f) {
+    switch (seg->kind) {
+        case JSON_SEGMENT_ANY:
+            return true;
+        case JSON_SEGMENT_ELEMENT:
+            return f->type == JSON_ARRAY_START;
+        case JSON_SEGMENT_KEY:
+            return f->type == JSON_OBJECT_START && f->has_key
+                && f->key->len == seg->key->len && memcmp(f->key->raw, seg->key->raw, seg->key->len) == 0;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Work out which subscriptions a value starting at the current depth
+ * is on the path of, and which ones it or an ancestor fully matches.
+ * 
+ * @internal
+*/
+static void value_masks(const json_parser_t* p, uint64_t* alive, uint64_t* inside) {
+    uint64_t a = 0;
+    uint64_t in = 0;
+    size_t s = 0;
+
+    if (p->depth == 0) {
+        for (; s < p->sub_count; s++) {
+            a |= (uint64_t)1 << s;
+            if (p->subs[s].len == 0) in |= (uint64_t)1 << s;
+        }
+
+        *alive = a;
+        *inside = in;
+        return;
+    }
+
+    const json_frame_t* f = &p->frames[p->depth - 1];
+    size_t seg = p->depth - 1;
+    uint64_t m = f->alive;
+    in = f->inside;
+
+    while (m != 0) {
+        s = simd_ctz64(m);
+        m &= m - 1;
+
+        const json_subscription_t* sub = &p->subs[s];
+        if (sub->len <= seg || segment_matches(&sub->segments[seg], f) == false) continue;
+
+        a |= (uint64_t)1 << s;
+        if (sub->len == seg + 1) in |= (uint64_t)1 << s;
+    }
+
+    *alive = a;
+    *inside = in;
+}
+
+/**
+ * @brief Move past a completed value.
+ * 
+ * @internal
+*/
+static void value_end(json_parser_t* p) {
+    if (p->depth == 0) {
+        p->state = ST_DONE;
+        return;
+    }
+
+    json_frame_t* f = &p->frames[p->depth - 1];
+    if (f->type == JSON_ARRAY_START) f->index++;
+    else f->has_key = false;
+
+    p->state = ST_AFTER;
+}
+
+/**
+ * @brief Open an object or array.
+ * 
+ * @internal
+*/
+static bool container_start(json_parser_t* p, json_type_t type) {
+    if (p->depth == JSON_MAX_DEPTH) return fail(p, "nesting too deep");
+
+    uint64_t alive;
+    uint64_t inside;
+    value_masks(p, &alive, &inside);
+    emit(p, inside, type, NULL, 0, false);
+
+    json_frame_t* f = &p->frames[p->depth++];
+    f->type = type;
+    f->has_key = false;
+    f->index = 0;
+    f->alive = alive;
+    f->inside = inside;
+
+    p->state = (type == JSON_OBJECT_START) ? ST_KEY_OR_END : ST_VALUE_OR_END;
+    return true;
+}
+
+/**
+ * @brief Close the innermost object or array.
+ * 
+ * @internal
+*/
+static bool container_end(json_parser_t* p, json_type_t type) {
+    if (p->depth == 0 || p->frames[p->depth - 1].type != type) return fail(p, "mismatched bracket");
+
+    uint64_t inside = p->frames[--p->depth].inside;
+    emit(p, inside, (type == JSON_OBJECT_START) ? JSON_OBJECT_END : JSON_ARRAY_END, NULL, 0, false);
+
+    value_end(p);
+    return true;
+}
+
+/**
+ * @brief Begin a scalar value, deciding whether it needs to be decoded.
+ * 
+ * @internal
+*/
+static void scalar_start(json_parser_t* p) {
+    uint64_t alive;
+    value_masks(p, &alive, &p->deliver);
+
+    p->scratch->len = 0;
+    p->scratch->raw[0] = '\0';
+}
+
+/**
+ * @brief Begin a member name, decoding it only if a subscription needs it.
+ * 
+ * @internal
+*/
+static bool key_start(json_parser_t* p) {
+    json_frame_t* f = &p->frames[p->depth - 1];
+    p->sink = NULL;
+
+    if ((f->alive | f->inside) != 0) {
+        if (f->key == NULL) f->key = astring_new(ASTRING_SMALL_CAP);
+        if (f->key == NULL) return fail(p, "out of memory");
+
+        f->key->len = 0;
+        p->sink = f->key;
+    }
+
+    p->after_string = ST_COLON;
+    p->state = ST_STRING;
+    return true;
+}
+
+/**
+ * @brief Finish the current string.
+ * 
+ * @internal
+*/
+static void string_end(json_parser_t* p) {
+    if (p->after_string == ST_COLON) {
+        json_frame_t* f = &p->frames[p->depth - 1];
+        f->has_key = (p->sink != NULL);
+        if (f->has_key) f->key->raw[f->key->len] = '\0';
+        p->state = ST_COLON;
+        return;
+    }
+
+    if (p->deliver != 0) emit(p, p->deliver, JSON_STRING, p->scratch->raw, p->scratch->len, false);
+    p->scratch->len = 0;
+    value_end(p);
+}
+
+/**
+ * @brief Append a code point to the current string as UTF-8.
+ * 
+ * @internal
+*/
+static bool put_codepoint(json_parser_t* p, uint32_t cp) {
+    char buf[4];
+    size_t n;
+
+    if (p->sink == NULL) return true;
+
+    if (cp < 0x80) {
+        buf[0] = (char)cp;
+        n = 1;
+    } else if (cp < 0x800) {
+        buf[0] = (char)(0xC0 | (cp >> 6));
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
+    } else {
+        buf[0] = (char)(0xF0 | (cp >> 18));
+        buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
+    }
+
+    if (astring_appendn(p->sink, buf, n) == NULL) return fail(p, "out of memory");
+    return true;
+}
+
+/**
+ * @brief Replace a high surrogate that was not followed by a low one.
+ * 
+ * @internal
+*/
+static bool flush_high(json_parser_t* p) {
+    if (p->high == 0) return true;
+
+    p->high = 0;
+    return put_codepoint(p, 0xFFFD);
+}
+
+/**
+ * @brief Decode a complete \u escape, pairing surrogates.
+ * 
+ * @internal
+*/
+static bool put_escape(json_parser_t* p, uint32_t cp) {
+    if (p->high != 0) {
+        if (cp >= 0xDC00 && cp <= 0xDFFF) {
+            cp = 0x10000 + ((p->high - 0xD800) << 10) + (cp - 0xDC00);
+            p->high = 0;
+            return put_codepoint(p, cp);
+        }
+
+        if (flush_high(p) == false) return false;
+    }
+
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        p->high = cp;
+        return true;
+    }
+
+    return put_codepoint(p, (cp >= 0xDC00 && cp <= 0xDFFF) ? 0xFFFD : cp);
+}
+
+/**
+ * @brief Get the value of a hex digit.
+ * 
+ * @internal
+ * 
+ * @return int The value of the digit, or -1 if c is not a hex digit
+*/
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+
+    return -1;
+}
+
+/**
+ * @brief Check whether a byte can continue a number.
+ * 
+ * @internal
+*/
+static bool is_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/**
+ * @brief Finish the current number.
+ * 
+ * @internal
+*/
+static void number_end(json_parser_t* p) {
+    if (p->deliver != 0) emit(p, p->deliver, JSON_NUMBER, p->scratch->raw, p->scratch->len, false);
+    p->scratch->len = 0;
+    value_end(p);
+}
+
+/**
+ * @brief Start whichever value c begins.
+ * 
+ * @internal
+*/
+static bool value_start(json_parser_t* p, char c) {
+    switch (c) {
+        case '{':
+            return container_start(p, JSON_OBJECT_START);
+        case '[':
+            return container_start(p, JSON_ARRAY_START);
+        case '"':
+            scalar_start(p);
+            p->sink = (p->deliver != 0) ? p->scratch : NULL;
+            p->after_string = ST_VALUE;
+            p->state = ST_STRING;
+            return true;
+        case 't':
+        case 'f':
+        case 'n':
+            scalar_start(p);
+            p->literal = (c == 't') ? "true" : (c == 'f') ? "false" : "null";
+            p->literal_type = (c == 't') ? JSON_TRUE : (c == 'f') ? JSON_FALSE : JSON_NULL;
+            p->literal_pos = 1;
+            p->state = ST_LITERAL;
+            return true;
+        default:
+            if (c != '-' && (c < '0' || c > '9')) return fail(p, "unexpected character");
+
+            scalar_start(p);
+            if (p->deliver != 0 && astring_appendn(p->scratch, &c, 1) == NULL) return fail(p, "out of memory");
+            p->state = ST_NUMBER;
+            return true;
+    }
+}
+
+/**
+ * @brief Create a new JSON parser.
+ * 
+ * @public
+ * 
+ * @return json_parser_t* The new parser, or NULL if an error occurred
+*/
+json_parser_t* json_new(void) {
+    json_parser_t* p = calloc(1, sizeof(json_parser_t));
+    if (p == NULL) return NULL;
+
+    p->scratch = astring_new(ASTRING_SMALL_CAP);
+    if (p->scratch == NULL) {
+        free(p);
+        return NULL;
+    }
+
+    json_reset(p);
+    return p;
+}
+
+/**
+ * @brief Free a JSON parser and its subscriptions.
+ * 
+ * @public
+ * 
+ * @param parser The parser to free
+*/
+void json_free(json_parser_t* parser) {
+    if (parser == NULL) return;
+
+    size_t i = 0;
+    for (; i < parser->sub_count; i++) {
+        size_t j = 0;
+        for (; j < parser->subs[i].len; j++) astring_free(parser->subs[i].segments[j].key);
+        free(parser->subs[i].segments);
+    }
+
+    for (i = 0; i < JSON_MAX_DEPTH; i++) astring_free(parser->frames[i].key);
+
+    astring_free(parser->scratch);
+    free(parser);
+}
+
+/**
+ * @brief Prepare a parser for a new document.
+ * 
+ * @note Subscriptions and buffers are kept, so one parser can be reused for
+ * every response without allocating.
+ * 
+ * @public
+ * 
+ * @param parser The parser to reset
+*/
+void json_reset(json_parser_t* parser) {
+    if (parser == NULL) return;
+
+    parser->state = ST_VALUE;
+    parser->depth = 0;
+    parser->deliver = 0;
+    parser->sink = NULL;
+    parser->high = 0;
+    parser->offset = 0;
+    parser->at = 0;
+    parser->error = NULL;
+    parser->scratch->len = 0;
+}
+
+/**
+ * @brief Subscribe to the values at a path.
+ * 
+ * @public
+ * 
+ * @param parser The parser to subscribe to
+ * @param path The path to match, such as query.pages[].title
+ * @param handler The function called with each matching event
+ * @param userdata Passed through to the handler
+ * @return bool True if the subscription was added, false if an error occurred
+*/
+bool json_subscribe(json_parser_t* parser, const char* path, json_handler_t handler, void* userdata) {
+    if (parser == NULL || path == NULL || handler == NULL) return false;
+    if (parser->sub_count == JSON_MAX_SUBSCRIPTIONS) return false;
+
+    // every segment starts after a '.' or at a '[', so this bounds the count
+    size_t max = 1;
+    const char* s = path;
+    for (; *s != '\0'; s++) {
+        if (*s == '.' || *s == '[') max++;
+    }
+
+    json_subscription_t* sub = &parser->subs[parser->sub_count];
+    sub->segments = malloc(sizeof(json_segment_t) * max);
+    sub->len = 0;
+    sub->handler = handler;
+    sub->userdata = userdata;
+    if (sub->segments == NULL) return false;
+
+    for (s = path; *s != '\0';) {
+        json_segment_t* seg = &sub->segments[sub->len];
+
+        if (*s == '.') {
+            s++;
+            continue;
+        }
+
+        if (s[0] == '[') {
+            if (s[1] != ']') goto fail;
+
+            seg->kind = JSON_SEGMENT_ELEMENT;
+            seg->key = NULL;
+            sub->len++;
+            s += 2;
+            continue;
+        }
+
+        const char* end = s;
+        while (*end != '\0' && *end != '.' && *end != '[') end++;
+
+        if (end - s == 1 && *s == '*') {
+            seg->kind = JSON_SEGMENT_ANY;
+            seg->key = NULL;
+        } else {
+            seg->kind = JSON_SEGMENT_KEY;
+            seg->key = astring_new((size_t)(end - s) + 1);
+            if (seg->key == NULL || astring_appendn(seg->key, s, (size_t)(end - s)) == NULL) {
+                astring_free(seg->key);
+                goto fail;
+            }
+        }
+
+        sub->len++;
+        s = end;
+    }
+
+    parser->sub_count++;
+    return true;
+
+fail:
+    while (sub->len > 0) astring_free(sub->segments[--sub->len].key);
+    free(sub->segments);
+    sub->segments = NULL;
+    return false;
+}
+
+/**
+ * @brief Feed the next chunk of a document to a parser.
+ * 
+ * @note Chunks may split the document anywhere, including inside strings and
+ * escapes. A string still open at the end of a chunk is delivered up to that
+ * point, so large values are never held whole.
+ * 
+ * @public
+ * 
+ * @param parser The parser to feed
+ * @param data The next bytes of the document
+ * @param len The number of bytes
+ * @return bool True if the chunk was valid so far, false if parsing failed
+*/
+bool json_feed(json_parser_t* parser, const char* data, size_t len) {
+    if (parser == NULL || (data == NULL && len > 0)) return false;
+
+    json_parser_t* p = parser;
+    size_t i = 0;
+
+    while (i < len && p->state != ST_ERROR) {
+        char c = data[i];
+
+        switch (p->state) {
+            case ST_STRING: {
+                // skip straight to the next quote or escape
+                const char* stop = memsearch_chr2(data + i, len - i, '"', '\\');
+                size_t run = (stop != NULL) ? (size_t)(stop - (data + i)) : len - i;
+
+                // a high surrogate must be followed directly by its low half
+                if (p->high != 0 && (run > 0 || (stop != NULL && *stop == '"'))) flush_high(p);
+                if (p->sink != NULL && run > 0 && astring_appendn(p->sink, data + i, run) == NULL) {
+                    fail(p, "out of memory");
+                    break;
+                }
+
+                i += run;
+                if (stop == NULL) break;
+
+                i++;
+                if (*stop == '"') string_end(p);
+                else p->state = ST_ESCAPE;
+                break;
+            }
+            case ST_ESCAPE: {
+                i++;
+                if (c == 'u') {
+                    p->codepoint = 0;
+                    p->hex_len = 0;
+                    p->state = ST_UNICODE;
+                    break;
+                }
+
+                char out;
+                switch (c) {
+                    case '"': case '\\': case '/': out = c; break;
+                    case 'b': out = '\b'; break;
+                    case 'f': out = '\f'; break;
+                    case 'n': out = '\n'; break;
+                    case 'r': out = '\r'; break;
+                    case 't': out = '\t'; break;
+                    default: fail(p, "invalid escape"); continue;
+                }
+
+                if (flush_high(p) && put_codepoint(p, (uint32_t)(unsigned char)out)) p->state = ST_STRING;
+                break;
+            }
+            case ST_UNICODE: {
+                int v = hex_value(c);
+                if (v < 0) {
+                    fail(p, "invalid unicode escape");
+                    break;
+                }
+
+                i++;
+                p->codepoint = (p->codepoint << 4) | (uint32_t)v;
+                if (++p->hex_len == 4 && put_escape(p, p->codepoint)) p->state = ST_STRING;
+                break;
+            }
+            case ST_NUMBER:
+                if (is_number_char(c) == false) {
+                    number_end(p);
+                    break;
+                }
+
+                if (p->deliver != 0 && astring_appendn(p->scratch, &c, 1) == NULL) fail(p, "out of memory");
+                i++;
+                break;
+            case ST_LITERAL:
+                if (c != p->literal[p->literal_pos]) {
+                    fail(p, "invalid literal");
+                    break;
+                }
+
+                i++;
+                if (p->literal[++p->literal_pos] == '\0') {
+                    emit(p, p->deliver, p->literal_type, NULL, 0, false);
+                    value_end(p);
+                }
+                break;
+            default:
+                p->at = p->offset + i++;
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                    // a run, such as indentation, is skipped in one go
+                    if (i < len && (data[i] == ' ' || data[i] == '\n' || data[i] == '\r' || data[i] == '\t')) {
+                        const char* stop = memsearch_notspace(data + i, len - i);
+                        i = (stop != NULL) ? (size_t)(stop - data) : len;
+                    }
+                    break;
+                }
+
+                switch (p->state) {
+                    case ST_VALUE_OR_END:
+                        if (c == ']') container_end(p, JSON_ARRAY_START);
+                        else value_start(p, c);
+                        break;
+                    case ST_VALUE:
+                        value_start(p, c);
+                        break;
+                    case ST_KEY_OR_END:
+                        if (c == '}') container_end(p, JSON_OBJECT_START);
+                        else if (c == '"') key_start(p);
+                        else fail(p, "expected member name");
+                        break;
+                    case ST_KEY:
+                        if (c == '"') key_start(p);
+                        else fail(p, "expected member name");
+                        break;
+                    case ST_COLON:
+                        if (c == ':') p->state = ST_VALUE;
+                        else fail(p, "expected ':'");
+                        break;
+                    case ST_AFTER:
+                        if (c == ',') p->state = (p->frames[p->depth - 1].type == JSON_OBJECT_START) ? ST_KEY : ST_VALUE;
+                        else if (c == '}') container_end(p, JSON_OBJECT_START);
+                        else if (c == ']') container_end(p, JSON_ARRAY_START);
+                        else fail(p, "expected ',' or end of container");
+                        break;
+                    default:
+                        fail(p, "trailing data after document");
+                        break;
+                }
+                break;
+        }
+    }
+
+    p->offset += i;
+    if (p->state == ST_ERROR) return false;
+
+    // hand over what has been decoded of a string that continues in the next chunk
+    bool in_string = p->state == ST_STRING || p->state == ST_ESCAPE || p->state == ST_UNICODE;
+    if (in_string && p->after_string == ST_VALUE && p->deliver != 0 && p->scratch->len > 0) {
+        emit(p, p->deliver, JSON_STRING, p->scratch->raw, p->scratch->len, true);
+        p->scratch->len = 0;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Signal the end of the document.
+ * 
+ * @public
+ * 
+ * @param parser The parser to finish
+ * @return bool True if a complete document was parsed, false otherwise
+*/
+bool json_finish(json_parser_t* parser) {
+    if (parser == NULL) return false;
+
+    if (parser->state == ST_NUMBER) number_end(parser);
+    if (parser->state == ST_ERROR) return false;
+    if (parser->state != ST_DONE) return fail(parser, "unexpected end of document");
+
+    return true;
+}
+
+/**
+ * @brief Feed a chunk to a parser, with a signature suited to write callbacks.
+ * 
+ * @public
+ * 
+ * @param parser The json_parser_t to feed
+ * @param data The next bytes of the document
+ * @param len The number of bytes
+ * @return bool True if the chunk was valid so far, false if parsing failed
+*/
+bool json_sink(void* parser, const char* data, size_t len) {
+    return json_feed(parser, data, len);
+}
\ No newline at end of file
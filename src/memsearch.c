@@ -0,0 +1,764 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * search_twoway is adapted from the Two-Way implementation in musl libc
+ * (twoway_strstr in src/string/strstr.c and twoway_memmem in
+ * src/string/memmem.c), which carries the following notice:
+ *
+ * Copyright © 2005-2020 Rich Felker, et al.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "memsearch.h"
+#include "simd.h"
+
+/**
+ * Needles longer than this are searched with the Two-Way algorithm, which is
+ * linear in the haystack length regardless of the input. Shorter needles use
+ * a vector filter on their first and last byte followed by a memcmp.
+ */
+#define MEMSEARCH_TWOWAY_MIN 64
+
+/**
+ * @brief Finds the first candidate of a needle with a first/last byte filter.
+ *
+ * @internal
+ */
+static const char* filter_scalar(const char* hay, size_t from, size_t last, const char* needle, size_t needle_len) {
+    size_t i = from;
+
+    for (; i <= last; i++) {
+        if (hay[i] == needle[0] && hay[i + needle_len - 1] == needle[needle_len - 1] &&
+            memcmp(hay + i + 1, needle + 1, needle_len - 2) == 0) {
+            return hay + i;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Finds the last candidate of a needle with a first/last byte filter.
+ *
+ * @internal
+ */
+static const char* rfilter_scalar(const char* hay, size_t end, const char* needle, size_t needle_len) {
+    size_t i = end;
+
+    while (i > 0) {
+        i--;
+        if (hay[i] == needle[0] && hay[i + needle_len - 1] == needle[needle_len - 1] &&
+            memcmp(hay + i + 1, needle + 1, needle_len - 2) == 0) {
+            return hay + i;
+        }
+    }
+
+    return NULL;
+}
+
+#if defined(CURLYBOT_SSE2)
+
+/**
+ * @brief Finds the first occurrence of a short needle 16 positions at a time.
+ *
+ * @internal
+ */
+static const char* search_sse2(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    size_t max_pos = hay_len - needle_len;
+    size_t i = 0;
+
+    for (; i + 16 <= max_pos + 1; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(hay + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(hay + i + needle_len - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                                  _mm_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            unsigned bit = simd_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0) return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    return filter_scalar(hay, i, max_pos, needle, needle_len);
+}
+
+/**
+ * @brief Finds the last occurrence of a short needle 16 positions at a time.
+ *
+ * @internal
+ */
+static const char* rsearch_sse2(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    size_t end = hay_len - needle_len + 1;
+
+    while (end >= 16) {
+        size_t i = end - 16;
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(hay + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(hay + i + needle_len - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                                  _mm_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            unsigned bit = 31 - simd_clz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0) return hay + i + bit;
+            mask &= ~(1u << bit);
+        }
+
+        end = i;
+    }
+
+    return rfilter_scalar(hay, end, needle, needle_len);
+}
+
+/**
+ * @brief Finds the last occurrence of a byte 16 bytes at a time.
+ *
+ * @internal
+ */
+static const char* rchr_sse2(const char* hay, size_t hay_len, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t end = hay_len;
+
+    while (end >= 16) {
+        size_t i = end - 16;
+        __m128i block = _mm_loadu_si128((const __m128i*)(hay + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+
+        if (mask != 0) return hay + i + (31 - simd_clz(mask));
+
+        end = i;
+    }
+
+    while (end > 0) {
+        end--;
+        if (hay[end] == c) return hay + end;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Scans for the first of two bytes 16 bytes at a time.
+ *
+ * @internal
+ */
+static const char* chr2_sse2(const char* hay, size_t hay_len, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    size_t i = 0;
+
+    for (; i + 16 <= hay_len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(hay + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb)));
+
+        if (mask != 0) return hay + i + simd_ctz(mask);
+    }
+
+    for (; i < hay_len; i++) {
+        if (hay[i] == a || hay[i] == b) return hay + i;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Scans for the first byte that is not a space, tab, newline or
+ * carriage return 16 bytes at a time.
+ *
+ * @internal
+ */
+static const char* notspace_sse2(const char* hay, size_t hay_len) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    size_t i = 0;
+
+    for (; i + 16 <= hay_len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(hay + i));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(block, nl), _mm_cmpeq_epi8(block, cr)));
+        uint32_t mask = ~(uint32_t)_mm_movemask_epi8(ws) & 0xffffu;
+
+        if (mask != 0) return hay + i + simd_ctz(mask);
+    }
+
+    for (; i < hay_len; i++) {
+        if (hay[i] != ' ' && hay[i] != '\t' && hay[i] != '\n' && hay[i] != '\r') return hay + i;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Computes a bitmask of the bytes equal to c in a 64 byte block.
+ *
+ * @internal
+ */
+static inline uint64_t eqmask64_sse2(const char* block, __m128i c) {
+    uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(block)), c));
+    uint64_t m1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(block + 16)), c));
+    uint64_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(block + 32)), c));
+    uint64_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(block + 48)), c));
+
+    return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+}
+
+/**
+ * @brief Collects every position of a byte 64 bytes at a time.
+ *
+ * @internal
+ */
+static size_t allchr_sse2(const char* hay, size_t hay_len, char c, size_t* indices, size_t cap, size_t* done) {
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 64 <= hay_len; i += 64) {
+        uint64_t mask = eqmask64_sse2(hay + i, needle);
+
+        if (count + simd_popcount64(mask) <= cap) {
+            while (mask != 0) {
+                indices[count++] = i + simd_ctz64(mask);
+                mask &= mask - 1;
+            }
+        } else {
+            while (mask != 0) {
+                if (count < cap) indices[count] = i + simd_ctz64(mask);
+                count++;
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    *done = i;
+    return count;
+}
+
+#endif /* CURLYBOT_SSE2 */
+
+#if defined(CURLYBOT_AVX2)
+
+/**
+ * @brief Finds the first occurrence of a short needle 32 positions at a time.
+ *
+ * @internal
+ */
+SIMD_TARGET_AVX2
+static const char* search_avx2(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+    size_t max_pos = hay_len - needle_len;
+    size_t i = 0;
+
+    for (; i + 32 <= max_pos + 1; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(hay + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(hay + i + needle_len - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                                        _mm256_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            unsigned bit = simd_ctz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0) return hay + i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    if (i > max_pos) return NULL;
+
+    return search_sse2(hay + i, hay_len - i, needle, needle_len);
+}
+
+/**
+ * @brief Finds the last occurrence of a short needle 32 positions at a time.
+ *
+ * @internal
+ */
+SIMD_TARGET_AVX2
+static const char* rsearch_avx2(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+    size_t end = hay_len - needle_len + 1;
+
+    while (end >= 32) {
+        size_t i = end - 32;
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(hay + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(hay + i + needle_len - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                                        _mm256_cmpeq_epi8(last, block_last)));
+
+        while (mask != 0) {
+            unsigned bit = 31 - simd_clz(mask);
+            if (memcmp(hay + i + bit + 1, needle + 1, needle_len - 2) == 0) return hay + i + bit;
+            mask &= ~(1u << bit);
+        }
+
+        end = i;
+    }
+
+    if (end == 0) return NULL;
+
+    return rsearch_sse2(hay, end + needle_len - 1, needle, needle_len);
+}
+
+/**
+ * @brief Finds the last occurrence of a byte 32 bytes at a time.
+ *
+ * @internal
+ */
+SIMD_TARGET_AVX2
+static const char* rchr_avx2(const char* hay, size_t hay_len, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t end = hay_len;
+
+    while (end >= 32) {
+        size_t i = end - 32;
+        __m256i block = _mm256_loadu_si256((const __m256i*)(hay + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle));
+
+        if (mask != 0) return hay + i + (31 - simd_clz(mask));
+
+        end = i;
+    }
+
+    return rchr_sse2(hay, end, c);
+}
+
+/**
+ * @brief Scans for the first of two bytes 32 bytes at a time.
+ *
+ * @internal
+ */
+SIMD_TARGET_AVX2
+static const char* chr2_avx2(const char* hay, size_t hay_len, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    size_t i = 0;
+
+    for (; i + 32 <= hay_len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(hay + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, va), _mm256_cmpeq_epi8(block, vb)));
+
+        if (mask != 0) return hay + i + simd_ctz(mask);
+    }
+
+    return chr2_sse2(hay + i, hay_len - i, a, b);
+}
+
+/**
+ * @brief Scans for the first byte that is not a space, tab, newline or
+ * carriage return 32 bytes at a time.
+ *
+ * @internal
+ */
+SIMD_TARGET_AVX2
+static const char* notspace_avx2(const char* hay, size_t hay_len) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    size_t i = 0;
+
+    for (; i + 32 <= hay_len; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(hay + i));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(block, nl), _mm256_cmpeq_epi8(block, cr)));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ws);
+
+        if (mask != 0) return hay + i + simd_ctz(mask);
+    }
+
+    return notspace_sse2(hay + i, hay_len - i);
+}
+
+/**
+ * @brief Collects every position of a byte 64 bytes at a time.
+ *
+ * @internal
+ */
+SIMD_TARGET_AVX2
+static size_t allchr_avx2(const char* hay, size_t hay_len, char c, size_t* indices, size_t cap, size_t* done) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t count = 0;
+    size_t i = 0;
+
+    for (; i + 64 <= hay_len; i += 64) {
+        uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(hay + i)), needle));
+        uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(hay + i + 32)), needle));
+        uint64_t mask = lo | (hi << 32);
+
+        if (count + simd_popcount64(mask) <= cap) {
+            while (mask != 0) {
+                indices[count++] = i + simd_ctz64(mask);
+                mask &= mask - 1;
+            }
+        } else {
+            while (mask != 0) {
+                if (count < cap) indices[count] = i + simd_ctz64(mask);
+                count++;
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    *done = i;
+    return count;
+}
+
+#endif /* CURLYBOT_AVX2 */
+
+/* The Two-Way search below follows musl's twoway_strstr and twoway_memmem, see the notice at the top of the file. */
+#define BITOP(a, b, op) ((a)[(size_t)(b) / (8 * sizeof *(a))] op (size_t)1 << ((size_t)(b) % (8 * sizeof *(a))))
+
+/**
+ * @brief Finds the first occurrence of a needle with the Two-Way algorithm.
+ *
+ * @internal
+ */
+static const char* search_twoway(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    const unsigned char* h = (const unsigned char*)hay;
+    const unsigned char* n = (const unsigned char*)needle;
+    const unsigned char* z = h + hay_len;
+    size_t l = needle_len;
+    size_t ip, jp, k, p, ms, p0, mem, mem0;
+    size_t byteset[32 / sizeof(size_t)] = { 0 };
+    size_t shift[256];
+
+    // bad character table for the last byte of the window
+    for (ip = 0; ip < l; ip++) {
+        BITOP(byteset, n[ip], |=);
+        shift[n[ip]] = ip + 1;
+    }
+
+    // maximal suffix
+    ip = (size_t)-1; jp = 0; k = p = 1;
+    while (jp + k < l) {
+        if (n[ip + k] == n[jp + k]) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if (n[ip + k] > n[jp + k]) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    ms = ip;
+    p0 = p;
+
+    // and with the opposite comparison
+    ip = (size_t)-1; jp = 0; k = p = 1;
+    while (jp + k < l) {
+        if (n[ip + k] == n[jp + k]) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if (n[ip + k] < n[jp + k]) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    if (ip + 1 > ms + 1) ms = ip;
+    else p = p0;
+
+    // periodic needle?
+    if (memcmp(n, n + p, ms + 1) != 0) {
+        mem0 = 0;
+        p = ((ms > l - ms - 1) ? ms : l - ms - 1) + 1;
+    } else {
+        mem0 = l - p;
+    }
+    mem = 0;
+
+    while ((size_t)(z - h) >= l) {
+        if (BITOP(byteset, h[l - 1], &)) {
+            k = l - shift[h[l - 1]];
+            if (k != 0) {
+                if (k < mem) k = mem;
+                h += k;
+                mem = 0;
+                continue;
+            }
+        } else {
+            h += l;
+            mem = 0;
+            continue;
+        }
+
+        // compare the right half
+        for (k = (ms + 1 > mem) ? ms + 1 : mem; k < l && n[k] == h[k]; k++);
+        if (k < l) {
+            h += k - ms;
+            mem = 0;
+            continue;
+        }
+
+        // compare the left half
+        for (k = ms + 1; k > mem && n[k - 1] == h[k - 1]; k--);
+        if (k <= mem) return (const char*)h;
+
+        h += p;
+        mem = mem0;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Finds the first occurrence of a byte.
+ *
+ * @public
+ *
+ * @param hay The bytes to search in.
+ * @param hay_len The number of bytes to search in.
+ * @param c The byte to search for.
+ * @return A pointer to the first match, or NULL if there is none.
+ */
+const char* memsearch_chr(const char* hay, size_t hay_len, char c) {
+    if (hay == NULL || hay_len == 0) return NULL;
+
+    // glibc's memchr is already vectorized and tuned per CPU
+    return memchr(hay, c, hay_len);
+}
+
+/**
+ * @brief Finds the last occurrence of a byte.
+ *
+ * @public
+ *
+ * @param hay The bytes to search in.
+ * @param hay_len The number of bytes to search in.
+ * @param c The byte to search for.
+ * @return A pointer to the last match, or NULL if there is none.
+ */
+const char* memsearch_rchr(const char* hay, size_t hay_len, char c) {
+    if (hay == NULL || hay_len == 0) return NULL;
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) return rchr_avx2(hay, hay_len, c);
+    return rchr_sse2(hay, hay_len, c);
+#elif defined(CURLYBOT_SSE2)
+    return rchr_sse2(hay, hay_len, c);
+#else
+    while (hay_len > 0) {
+        hay_len--;
+        if (hay[hay_len] == c) return hay + hay_len;
+    }
+
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Finds the first occurrence of either of two bytes.
+ *
+ * @public
+ *
+ * @param hay The bytes to search in.
+ * @param hay_len The number of bytes to search in.
+ * @param a The first byte to search for.
+ * @param b The second byte to search for.
+ * @return A pointer to the first match, or NULL if there is none.
+ */
+const char* memsearch_chr2(const char* hay, size_t hay_len, char a, char b) {
+    if (hay == NULL || hay_len == 0) return NULL;
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) return chr2_avx2(hay, hay_len, a, b);
+    return chr2_sse2(hay, hay_len, a, b);
+#elif defined(CURLYBOT_SSE2)
+    return chr2_sse2(hay, hay_len, a, b);
+#else
+    size_t i = 0;
+    for (; i < hay_len; i++) {
+        if (hay[i] == a || hay[i] == b) return hay + i;
+    }
+
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Finds the first byte that is not a space, tab, newline or carriage
+ * return, skipping a run of whitespace such as the indentation of a document.
+ *
+ * @public
+ *
+ * @param hay The bytes to search in.
+ * @param hay_len The number of bytes to search in.
+ * @return A pointer to the first other byte, or NULL if every byte is whitespace.
+ */
+const char* memsearch_notspace(const char* hay, size_t hay_len) {
+    if (hay == NULL || hay_len == 0) return NULL;
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) return notspace_avx2(hay, hay_len);
+    return notspace_sse2(hay, hay_len);
+#elif defined(CURLYBOT_SSE2)
+    return notspace_sse2(hay, hay_len);
+#else
+    size_t i = 0;
+    for (; i < hay_len; i++) {
+        if (hay[i] != ' ' && hay[i] != '\t' && hay[i] != '\n' && hay[i] != '\r') return hay + i;
+    }
+
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Collects the positions of every occurrence of a byte.
+ *
+ * @note Only the first cap positions are written, but the total number of
+ * matches is always returned. Passing a NULL indices array with a cap of 0
+ * counts the matches, which lets callers size the array exactly.
+ *
+ * @public
+ *
+ * @param hay The bytes to search in.
+ * @param hay_len The number of bytes to search in.
+ * @param c The byte to search for.
+ * @param indices The array to write the positions to, or NULL.
+ * @param cap The number of positions indices can hold.
+ * @return The total number of matches.
+ */
+size_t memsearch_allchr(const char* hay, size_t hay_len, char c, size_t* indices, size_t cap) {
+    if (hay == NULL) return 0;
+    if (indices == NULL) cap = 0;
+
+    size_t count = 0;
+    size_t i = 0;
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) count = allchr_avx2(hay, hay_len, c, indices, cap, &i);
+    else count = allchr_sse2(hay, hay_len, c, indices, cap, &i);
+#elif defined(CURLYBOT_SSE2)
+    count = allchr_sse2(hay, hay_len, c, indices, cap, &i);
+#endif
+
+    for (; i < hay_len; i++) {
+        if (hay[i] == c) {
+            if (count < cap) indices[count] = i;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * @brief Finds the first occurrence of a needle.
+ *
+ * @public
+ *
+ * @param hay The bytes to search in.
+ * @param hay_len The number of bytes to search in.
+ * @param needle The bytes to search for.
+ * @param needle_len The number of bytes to search for.
+ * @return A pointer to the first match, or NULL if there is none. An empty
+ * needle matches at the start of the haystack.
+ */
+const char* memsearch(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    if (hay == NULL || needle == NULL) return NULL;
+    if (needle_len == 0) return hay;
+    if (hay_len < needle_len) return NULL;
+    if (needle_len == 1) return memsearch_chr(hay, hay_len, needle[0]);
+    if (needle_len > MEMSEARCH_TWOWAY_MIN) return search_twoway(hay, hay_len, needle, needle_len);
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) return search_avx2(hay, hay_len, needle, needle_len);
+    return search_sse2(hay, hay_len, needle, needle_len);
+#elif defined(CURLYBOT_SSE2)
+    return search_sse2(hay, hay_len, needle, needle_len);
+#else
+    return filter_scalar(hay, 0, hay_len - needle_len, needle, needle_len);
+#endif
+}
+
+/**
+ * @brief Finds the last occurrence of a needle.
+ *
+ * @public
+ *
+ * @param hay The bytes to search in.
+ * @param hay_len The number of bytes to search in.
+ * @param needle The bytes to search for.
+ * @param needle_len The number of bytes to search for.
+ * @return A pointer to the last match, or NULL if there is none. An empty
+ * needle matches at the end of the haystack.
+ */
+const char* memsearch_r(const char* hay, size_t hay_len, const char* needle, size_t needle_len) {
+    if (hay == NULL || needle == NULL) return NULL;
+    if (needle_len == 0) return hay + hay_len;
+    if (hay_len < needle_len) return NULL;
+    if (needle_len == 1) return memsearch_rchr(hay, hay_len, needle[0]);
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) return rsearch_avx2(hay, hay_len, needle, needle_len);
+    return rsearch_sse2(hay, hay_len, needle, needle_len);
+#elif defined(CURLYBOT_SSE2)
+    return rsearch_sse2(hay, hay_len, needle, needle_len);
+#else
+    return rfilter_scalar(hay, hay_len - needle_len + 1, needle, needle_len);
+#endif
+}
@@ -0,0 +1,265 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+
+#include "mpmc.h"
+
+/**
+ * @brief Create a new queue.
+ * 
+ * @note The capacity is rounded up to a power of two. Producers should back
+ * off once three quarters of it are in use, see mpmc_pressured.
+ * 
+ * @public
+ * 
+ * @param capacity The least number of items the queue holds, at least 2
+ * @return mpmc_t* The new queue, or NULL if an error occurred
+*/
+mpmc_t* mpmc_new(size_t capacity) {
+    if (capacity < 2 || capacity > ((size_t)-1 >> 2)) return NULL;
+
+    size_t cap = 2;
+    while (cap < capacity) cap <<= 1;
+
+    mpmc_t* queue = calloc(1, sizeof(mpmc_t));
+    if (queue == NULL) return NULL;
+
+    queue->cells = malloc(sizeof(mpmc_cell_t) * cap);
+    if (queue->cells == NULL) {
+        free(queue);
+        return NULL;
+    }
+
+    size_t i = 0;
+    for (; i < cap; i++) {
+        queue->cells[i].seq = i;
+        queue->cells[i].data = NULL;
+    }
+
+    queue->mask = cap - 1;
+    queue->high = cap - cap / 4;
+    return queue;
+}
+
+/**
+ * @brief Free a queue.
+ * 
+ * @note Items still in the queue are not freed.
+ * 
+ * @public
+ * 
+ * @param queue The queue to free
+*/
+void mpmc_free(mpmc_t* queue) {
+    if (queue == NULL) return;
+
+    free(queue->cells);
+    free(queue);
+}
+
+/**
+ * @brief Push an item.
+ * 
+ * @public
+ * 
+ * @param queue The queue to push to
+ * @param item The item
+ * @return bool True if the item was pushed, false if the queue is full
+*/
+bool mpmc_push(mpmc_t* queue, void* item) {
+    return mpmc_pushn(queue, &item, 1) == 1;
+}
+
+/**
+ * @brief Pop an item.
+ * 
+ * @public
+ * 
+ * @param queue The queue to pop from
+ * @return void* The oldest item, or NULL if the queue is empty
+*/
+void* mpmc_pop(mpmc_t* queue) {
+    void* item = NULL;
+
+    mpmc_popn(queue, &item, 1);
+    return item;
+}
+
+/**
+ * @brief Push up to count items with one claim on the queue.
+ * 
+ * @note The pushed items are consecutive in the queue, so a consumer
+ * popping in batches sees them together.
+ * 
+ * @public
+ * 
+ * @param queue The queue to push to
+ * @param items The items
+ * @param count The number of items
+ * @return size_t The number of leading items pushed, 0 if the queue is full
+*/
+size_t mpmc_pushn(mpmc_t* queue, void* const* items, size_t count) {
+    if (queue == NULL || items == NULL || count == 0) return 0;
+
+    size_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    size_t n;
+
+    for (;;) {
+        // count the free cells from pos, a cell is free for position p when its seq is p
+        for (n = 0; n < count; n++) {
+            size_t seq = __atomic_load_n(&queue->cells[(pos + n) & queue->mask].seq, __ATOMIC_ACQUIRE);
+            if (seq != pos + n) break;
+        }
+
+        if (n == 0) {
+            size_t seq = __atomic_load_n(&queue->cells[pos & queue->mask].seq, __ATOMIC_ACQUIRE);
+
+            // the cell still holds the item from one lap ago
+            if ((ptrdiff_t)(seq - pos) < 0) return 0;
+
+            pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+
+    size_t i = 0;
+    for (; i < n; i++) {
+        mpmc_cell_t* cell = &queue->cells[(pos + i) & queue->mask];
+        cell->data = items[i];
+        __atomic_store_n(&cell->seq, pos + i + 1, __ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+/**
+ * @brief Pop up to count items with one claim on the queue.
+ * 
+ * @public
+ * 
+ * @param queue The queue to pop from
+ * @param items Receives the items, oldest first
+ * @param count The most items to pop
+ * @return size_t The number of items popped, 0 if the queue is empty
+*/
+size_t mpmc_popn(mpmc_t* queue, void** items, size_t count) {
+    if (queue == NULL || items == NULL || count == 0) return 0;
+
+    size_t pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    size_t n;
+
+    for (;;) {
+        // a cell is ready for position p once its producer set seq to p + 1
+        for (n = 0; n < count; n++) {
+            size_t seq = __atomic_load_n(&queue->cells[(pos + n) & queue->mask].seq, __ATOMIC_ACQUIRE);
+            if (seq != pos + n + 1) break;
+        }
+
+        if (n == 0) {
+            size_t seq = __atomic_load_n(&queue->cells[pos & queue->mask].seq, __ATOMIC_ACQUIRE);
+
+            // the cell has not been filled for this lap yet
+            if ((ptrdiff_t)(seq - (pos + 1)) < 0) return 0;
+
+            pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n(&queue->head, &pos, pos + n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+
+    size_t i = 0;
+    for (; i < n; i++) {
+        mpmc_cell_t* cell = &queue->cells[(pos + i) & queue->mask];
+        items[i] = cell->data;
+        __atomic_store_n(&cell->seq, pos + i + queue->mask + 1, __ATOMIC_RELEASE);
+    }
+
+    return n;
+}
+
+/**
+ * @brief Set the fill level at which producers should back off.
+ * 
+ * @public
+ * 
+ * @param queue The queue to configure
+ * @param high The number of items, clamped to the capacity
+*/
+void mpmc_setwatermark(mpmc_t* queue, size_t high) {
+    if (queue == NULL) return;
+
+    queue->high = (high > queue->mask + 1) ? queue->mask + 1 : high;
+}
+
+/**
+ * @brief Check whether the queue is filling faster than it drains.
+ * 
+ * @note Producers such as an I/O thread should stop taking on new work,
+ * for instance by pausing transfers, while this holds, rather than wait
+ * for pushes to fail.
+ * 
+ * @public
+ * 
+ * @param queue The queue to check
+ * @return bool True if the queue is at or above its watermark, false otherwise
+*/
+bool mpmc_pressured(const mpmc_t* queue) {
+    return queue != NULL && mpmc_size(queue) >= queue->high;
+}
+
+/**
+ * @brief Get the number of items in the queue.
+ * 
+ * @note The result is only a snapshot while other threads use the queue.
+ * 
+ * @public
+ * 
+ * @param queue The queue to measure
+ * @return size_t The number of items
+*/
+size_t mpmc_size(const mpmc_t* queue) {
+    if (queue == NULL) return 0;
+
+    size_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    size_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+    // the cursors are read apart, so head may have overtaken the tail we saw
+    return ((ptrdiff_t)(tail - head) > 0) ? tail - head : 0;
+}
+
+/**
+ * @brief Get the number of items the queue holds when full.
+ * 
+ * @public
+ * 
+ * @param queue The queue to measure
+ * @return size_t The capacity
+*/
+size_t mpmc_capacity(const mpmc_t* queue) {
+    return (queue != NULL) ? queue->mask + 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,390 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pager.h"
+
+static void issue(pager_t* pager);
+
+/**
+ * @brief Free a page and everything it owns.
+ * 
+ * @internal
+*/
+static void page_free(pager_page_t* page) {
+    astring_free(page->body);
+    astring_free(page->cont_value);
+    querystring_free(page->cont, true);
+    json_free(page->parser);
+    free(page);
+}
+
+/**
+ * @brief Replace the querystring parameters of the previous continuation
+ * with the ones from a response.
+ * 
+ * @note On success the page's parameters become the applied set, and the
+ * previous set is handed to the page to be freed with it.
+ * 
+ * @internal
+*/
+static bool apply_continue(pager_t* pager, pager_page_t* page) {
+    querystring_t* cont = page->cont;
+    size_t i = 0;
+
+    for (; i < pager->applied->len; i++) {
+        const querypair_t* qp = pager->applied->pairs[i];
+        if (qp == NULL || querystring_get(cont, qp->key->raw) != NULL) continue;
+
+        querystring_remove(pager->qs, qp->key->raw, true);
+    }
+
+    for (i = 0; i < cont->len; i++) {
+        const querypair_t* qp = cont->pairs[i];
+        if (qp == NULL) continue;
+
+        // an existing value is overwritten in place, reusing its buffer
+        astring_t* value = querystring_get(pager->qs, qp->key->raw);
+        if (value != NULL) {
+            if (astring_into(value, qp->value->raw) == NULL) return false;
+        } else if (querystring_addfrom(pager->qs, qp->key->raw, qp->value->raw) == NULL) {
+            return false;
+        }
+    }
+
+    page->cont = pager->applied;
+    pager->applied = cont;
+    return true;
+}
+
+/**
+ * @brief Collect the members of the top-level continue object and issue the
+ * next request once it closes.
+ * 
+ * @internal
+*/
+static void on_continue(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    pager_page_t* page = userdata;
+
+    switch (ev->type) {
+        case JSON_STRING:
+        case JSON_NUMBER:
+            if (ev->depth != 2 || ev->key == NULL) return;
+
+            astring_appendn(page->cont_value, ev->data, ev->len);
+            if (ev->more) return;
+
+            querystring_addfrom(page->cont, ev->key->raw, page->cont_value->raw);
+            page->cont_value->len = 0;
+            page->cont_value->raw[0] = '\0';
+            return;
+        case JSON_OBJECT_END:
+            if (ev->depth != 1) return;
+
+            page->has_continue = true;
+            if (page->pager->failed) return;
+
+            if (apply_continue(page->pager, page) == false) {
+                page->pager->failed = true;
+                return;
+            }
+
+            page->pager->ready = true;
+            issue(page->pager);
+            return;
+        default:
+            return;
+    }
+}
+
+/**
+ * @brief Take a page from the free list or create one.
+ * 
+ * @internal
+*/
+static pager_page_t* page_get(pager_t* pager) {
+    pager_page_t* page = pager->free_pages;
+
+    if (page != NULL) {
+        pager->free_pages = page->next;
+        querystring_free(page->cont, true);
+        page->cont = querystring_new();
+        if (page->cont == NULL) {
+            page_free(page);
+            return NULL;
+        }
+    } else {
+        page = calloc(1, sizeof(pager_page_t));
+        if (page == NULL) return NULL;
+
+        page->body = astring_new(ASTRING_SMALL_CAP);
+        page->cont_value = astring_new(ASTRING_SMALL_CAP);
+        page->cont = querystring_new();
+        page->parser = json_new();
+        if (page->body == NULL || page->cont_value == NULL || page->cont == NULL || page->parser == NULL
+            || json_subscribe(page->parser, "continue", on_continue, page) == false) {
+            page_free(page);
+            return NULL;
+        }
+    }
+
+    page->pager = pager;
+    page->next = NULL;
+    page->done = false;
+    page->has_continue = false;
+    page->status = 0;
+    page->result = CURLE_OK;
+    page->body->len = 0;
+    page->body->raw[0] = '\0';
+    page->cont_value->len = 0;
+    json_reset(page->parser);
+
+    return page;
+}
+
+/**
+ * @brief Buffer a chunk of a page and watch it for the continue object.
+ * 
+ * @internal
+*/
+static bool page_sink(void* userdata, const char* data, size_t len) {
+    pager_page_t* page = userdata;
+
+    if (astring_appendn(page->body, data, len) == NULL) return false;
+
+    // a body that is not JSON still completes and is handed to the consumer
+    json_feed(page->parser, data, len);
+    return true;
+}
+
+/**
+ * @brief Record a completed page.
+ * 
+ * @internal
+*/
+static void page_done(engine_request_t* req, void* userdata) {
+    pager_page_t* page = userdata;
+    pager_t* pager = page->pager;
+
+    page->status = req->status;
+    page->result = req->result;
+    page->done = true;
+    pager->inflight--;
+
+    if (req->result != CURLE_OK || req->status != 200 || json_finish(page->parser) == false) pager->failed = true;
+}
+
+/**
+ * @brief Issue the pending continuation if the prefetch window allows it.
+ * 
+ * @internal
+*/
+static void issue(pager_t* pager) {
+    if (pager->ready == false || pager->failed || pager->outstanding >= pager->ahead) return;
+
+    pager_page_t* page = page_get(pager);
+    if (page == NULL) {
+        pager->failed = true;
+        return;
+    }
+
+    engine_request_t* req = engine_submit(pager->engine, pager->endpoint->raw, pager->qs, page_done, page);
+    if (req == NULL) {
+        page->next = pager->free_pages;
+        pager->free_pages = page;
+        pager->failed = true;
+        return;
+    }
+
+    engine_setsink(req, page_sink, page);
+
+    page->index = pager->issued++;
+    if (pager->tail != NULL) pager->tail->next = page;
+    else pager->head = page;
+    pager->tail = page;
+
+    pager->ready = false;
+    pager->outstanding++;
+    pager->inflight++;
+}
+
+/**
+ * @brief Create a new pager.
+ * 
+ * @note The pager takes ownership of qs. Add continue= to it for the
+ * continuation format the pager follows.
+ * 
+ * @public
+ * 
+ * @param engine The engine to submit the requests to
+ * @param endpoint The API endpoint URL
+ * @param qs The query of the first page
+ * @return pager_t* The new pager, or NULL if an error occurred
+*/
+pager_t* pager_new(engine_t* engine, const char* endpoint, querystring_t* qs) {
+    if (engine == NULL || endpoint == NULL || qs == NULL) return NULL;
+
+    pager_t* pager = calloc(1, sizeof(pager_t));
+    if (pager == NULL) return NULL;
+
+    pager->endpoint = astring_from(endpoint);
+    pager->applied = querystring_new();
+    if (pager->endpoint == NULL || pager->applied == NULL) {
+        astring_free(pager->endpoint);
+        querystring_free(pager->applied, true);
+        free(pager);
+        return NULL;
+    }
+
+    pager->engine = engine;
+    pager->qs = qs;
+    pager->ahead = PAGER_DEFAULT_AHEAD;
+    pager->ready = true;
+
+    return pager;
+}
+
+/**
+ * @brief Free a pager.
+ * 
+ * @note Requests still in flight are run to completion and discarded first,
+ * pages returned by pager_next must not be used afterwards.
+ * 
+ * @public
+ * 
+ * @param pager The pager to free
+*/
+void pager_free(pager_t* pager) {
+    if (pager == NULL) return;
+
+    pager->failed = true;
+    while (pager->inflight > 0) {
+        if (engine_poll(pager->engine, -1) < 0) break;
+    }
+
+    while (pager->head != NULL) {
+        pager_page_t* next = pager->head->next;
+        page_free(pager->head);
+        pager->head = next;
+    }
+
+    while (pager->free_pages != NULL) {
+        pager_page_t* next = pager->free_pages->next;
+        page_free(pager->free_pages);
+        pager->free_pages = next;
+    }
+
+    querystring_free(pager->qs, true);
+    querystring_free(pager->applied, true);
+    astring_free(pager->endpoint);
+    free(pager);
+}
+
+/**
+ * @brief Set how many pages may be outstanding at once.
+ * 
+ * @note This counts the page the consumer holds, so 1 turns prefetching off.
+ * 
+ * @public
+ * 
+ * @param pager The pager to configure
+ * @param ahead The most pages issued and not yet released
+*/
+void pager_setahead(pager_t* pager, size_t ahead) {
+    if (pager == NULL) return;
+
+    pager->ahead = (ahead > 0) ? ahead : 1;
+    issue(pager);
+}
+
+/**
+ * @brief Wait for the next page of the walk.
+ * 
+ * @note The engine is polled until the page is complete, so other requests
+ * on the same engine make progress meanwhile. The page must be handed back
+ * with pager_release.
+ * 
+ * @public
+ * 
+ * @param pager The pager to advance
+ * @return pager_page_t* The next page, or NULL once the walk is complete or failed
+*/
+pager_page_t* pager_next(pager_t* pager) {
+    if (pager == NULL) return NULL;
+
+    issue(pager);
+
+    while (pager->head != NULL && pager->head->done == false) {
+        if (engine_poll(pager->engine, -1) < 0) {
+            pager->failed = true;
+            return NULL;
+        }
+    }
+
+    pager_page_t* page = pager->head;
+    if (page == NULL) return NULL;
+
+    if (page->result != CURLE_OK || page->status != 200) {
+        pager->failed = true;
+        return NULL;
+    }
+
+    pager->head = page->next;
+    if (pager->head == NULL) pager->tail = NULL;
+    page->next = NULL;
+
+    return page;
+}
+
+/**
+ * @brief Hand a page back, letting the pager fetch further ahead.
+ * 
+ * @public
+ * 
+ * @param pager The pager the page came from
+ * @param page The page to release
+*/
+void pager_release(pager_t* pager, pager_page_t* page) {
+    if (pager == NULL || page == NULL) return;
+
+    page->next = pager->free_pages;
+    pager->free_pages = page;
+    pager->outstanding--;
+
+    issue(pager);
+}
+
+/**
+ * @brief Check whether the walk ended because of an error.
+ * 
+ * @public
+ * 
+ * @param pager The pager to check
+ * @return bool True if a request failed, false otherwise
+*/
+bool pager_failed(const pager_t* pager) {
+    return pager == NULL || pager->failed;
+}
\ No newline at end of file
@@ -23,9 +23,148 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
+#include "alloc.h"
 #include "querystring.h"
 
+#define INDEX_EMPTY 0
+#define INDEX_DELETED UINT32_MAX
+#define INDEX_NPOS ((size_t)-1)
+
+/**
+ * @brief Allocate memory from an arena or the heap.
+ * 
+ * @internal
+*/
+static void* qs_alloc(arena_t* arena, alloc_category_t category, size_t size) {
+    if (arena != NULL) return arena_alloc(arena, size);
+
+    return alloc_malloc(category, size);
+}
+
+/**
+ * @brief Check if a pair has the given key.
+ * 
+ * @internal
+*/
+static bool pair_matches(const querypair_t* qp, const char* key, size_t key_len, uint64_t hash, apikey_t keyid) {
+    if (qp == NULL || qp->hash != hash) return false;
+    if (keyid != APIKEY_NONE && qp->keyid == keyid) return true;
+
+    return qp->key->len == key_len && memcmp(qp->key->raw, key, key_len) == 0;
+}
+
+/**
+ * @brief Insert a pair slot into the hash index.
+ * 
+ * @internal
+*/
+static void index_insert(querystring_t* qs, size_t slot) {
+    size_t mask = qs->index_cap - 1;
+    size_t i = (size_t)qs->pairs[slot]->hash & mask;
+
+    while (qs->index[i] != INDEX_EMPTY && qs->index[i] != INDEX_DELETED) i = (i + 1) & mask;
+
+    if (qs->index[i] == INDEX_EMPTY) qs->index_used++;
+    qs->index[i] = (uint32_t)(slot + 1);
+}
+
+/**
+ * @brief Rebuild the hash index so it can hold every pair slot.
+ * 
+ * @note On allocation failure the index is dropped and lookups fall back to a
+ * linear scan.
+ * 
+ * @internal
+*/
+static void index_rebuild(querystring_t* qs) {
+    size_t cap = 16;
+    while (cap < qs->cap * 2) cap *= 2;
+
+    if (qs->index != NULL && qs->index_cap != cap) {
+        if (qs->arena == NULL) alloc_free(ALLOC_PAIR_ARRAY, qs->index, sizeof(uint32_t) * qs->index_cap);
+        qs->index = NULL;
+    }
+
+    if (qs->index == NULL) {
+        qs->index = qs_alloc(qs->arena, ALLOC_PAIR_ARRAY, sizeof(uint32_t) * cap);
+        if (qs->index == NULL) {
+            qs->index_cap = 0;
+            qs->index_used = 0;
+            return;
+        }
+    }
+
+    memset(qs->index, 0, sizeof(uint32_t) * cap);
+    qs->index_cap = cap;
+    qs->index_used = 0;
+
+    size_t i = 0;
+    for (; i < qs->len; i++) {
+        if (qs->pairs[i] != NULL) index_insert(qs, i);
+    }
+}
+
+/**
+ * @brief Find the first slot holding a key.
+ * 
+ * @internal
+ * 
+ * @param qs The querystring_t object to search
+ * @param key The key to search for
+ * @param key_len The length of the key
+ * @param hash The hash of the key
+ * @param keyid The interned key, or APIKEY_NONE
+ * @param entry Set to the index entry of the slot, if the index is in use
+ * @return size_t The slot of the first matching pair, or INDEX_NPOS
+*/
+static size_t find_slot(const querystring_t* qs, const char* key, size_t key_len, uint64_t hash, apikey_t keyid, size_t* entry) {
+    size_t found = INDEX_NPOS;
+
+    if (qs->index == NULL) {
+        size_t i = 0;
+        for (; i < qs->len; i++) {
+            if (pair_matches(qs->pairs[i], key, key_len, hash, keyid)) return i;
+        }
+
+        return INDEX_NPOS;
+    }
+
+    // duplicate keys share a probe run, keep the earliest slot
+    size_t mask = qs->index_cap - 1;
+    size_t i = (size_t)hash & mask;
+
+    for (; qs->index[i] != INDEX_EMPTY; i = (i + 1) & mask) {
+        if (qs->index[i] == INDEX_DELETED) continue;
+
+        size_t slot = qs->index[i] - 1;
+        if (slot < found && pair_matches(qs->pairs[slot], key, key_len, hash, keyid)) {
+            found = slot;
+            if (entry != NULL) *entry = i;
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief Close the holes left by removed pairs, keeping insertion order.
+ * 
+ * @internal
+*/
+static void compact(querystring_t* qs) {
+    size_t out = 0;
+    size_t i = 0;
+
+    for (; i < qs->len; i++) {
+        if (qs->pairs[i] != NULL) qs->pairs[out++] = qs->pairs[i];
+    }
+
+    qs->len = out;
+    if (qs->index != NULL) index_rebuild(qs);
+}
+
 /**
  * @brief Create a new querypair_t object.
  * 
@@ -36,11 +175,32 @@
  * @return querypair_t* The new querypair_t object
 */
 querypair_t* querypair_new(astring_t* key, astring_t* value) {
+    return querypair_new_in(NULL, key, value);
+}
+
+/**
+ * @brief Create a new querypair_t object inside an arena.
+ * 
+ * @public
+ * 
+ * @param arena The arena to allocate from, or NULL for the heap
+ * @param key The key of the querypair_t object
+ * @param value The value of the querypair_t object
+ * @return querypair_t* The new querypair_t object
+*/
+querypair_t* querypair_new_in(arena_t* arena, astring_t* key, astring_t* value) {
     if (key == NULL || value == NULL) return NULL;
 
-    querypair_t* qp = malloc(sizeof(querypair_t));
+    querypair_t* qp = qs_alloc(arena, ALLOC_QUERYPAIR, sizeof(querypair_t));
+    if (qp == NULL) return NULL;
+
     qp->key = key;
     qp->value = value;
+    qp->arena = arena;
+    qp->hash = astring_hash(key);
+
+    // a known key gets its id even though the pair keeps the caller's astring
+    qp->keyid = apikey_lookuph(key->raw, key->len, qp->hash);
     return qp;
 }
 
@@ -54,11 +214,79 @@ querypair_t* querypair_new(astring_t* key, astring_t* value) {
  * @return querypair_t* The new querypair_t object
 */
 querypair_t* querypair_from(const char* key, const char* value) {
+    return querypair_from_in(NULL, key, value);
+}
+
+/**
+ * @brief Create a new querypair_t object inside an arena.
+ * 
+ * @note The key and value astrings are allocated from the same arena.
+ * 
+ * @public
+ * 
+ * @param arena The arena to allocate from, or NULL for the heap
+ * @param key The key of the querypair_t object
+ * @param value The value of the querypair_t object
+ * @return querypair_t* The new querypair_t object
+*/
+querypair_t* querypair_from_in(arena_t* arena, const char* key, const char* value) {
     if (key == NULL || value == NULL) return NULL;
 
-    querypair_t* qp = malloc(sizeof(querypair_t));
-    qp->key = astring_from(key);
-    qp->value = astring_from(value);
+    astring_t* key_str = astring_from_in(arena, key);
+    astring_t* value_str = astring_from_in(arena, value);
+
+    querypair_t* qp = querypair_new_in(arena, key_str, value_str);
+    if (qp == NULL) {
+        astring_free(key_str);
+        astring_free(value_str);
+    }
+
+    return qp;
+}
+
+/**
+ * @brief Create a new querypair_t object with an interned key.
+ * 
+ * @public
+ * 
+ * @param key The interned key of the querypair_t object
+ * @param value The value of the querypair_t object
+ * @return querypair_t* The new querypair_t object
+*/
+querypair_t* querypair_fromk(apikey_t key, const char* value) {
+    return querypair_fromk_in(NULL, key, value);
+}
+
+/**
+ * @brief Create a new querypair_t object with an interned key inside an arena.
+ * 
+ * @note The key is shared and never copied, only the value is allocated.
+ * 
+ * @public
+ * 
+ * @param arena The arena to allocate from, or NULL for the heap
+ * @param key The interned key of the querypair_t object
+ * @param value The value of the querypair_t object
+ * @return querypair_t* The new querypair_t object
+*/
+querypair_t* querypair_fromk_in(arena_t* arena, apikey_t key, const char* value) {
+    const astring_t* key_str = apikey_str(key);
+    if (key_str == NULL || value == NULL) return NULL;
+
+    astring_t* value_str = astring_from_in(arena, value);
+    if (value_str == NULL) return NULL;
+
+    querypair_t* qp = qs_alloc(arena, ALLOC_QUERYPAIR, sizeof(querypair_t));
+    if (qp == NULL) {
+        astring_free(value_str);
+        return NULL;
+    }
+
+    qp->key = (astring_t*)key_str;
+    qp->value = value_str;
+    qp->arena = arena;
+    qp->hash = apikey_hash(key);
+    qp->keyid = key;
     return qp;
 }
 
@@ -74,8 +302,9 @@ querypair_t* querypair_from(const char* key, const char* value) {
 void querypair_free(querypair_t* qp) {
     if (qp == NULL) return;
     if (qp->key == NULL || qp->value == NULL) return;
+    if (qp->arena != NULL) return;
 
-    free(qp);
+    alloc_free(ALLOC_QUERYPAIR, qp, sizeof(querypair_t));
 }
 
 /**
@@ -89,9 +318,9 @@ void querypair_freeall(querypair_t* qp) {
     if (qp == NULL) return;
     if (qp->key == NULL || qp->value == NULL) return;
 
-    astring_free(qp->key);
+    if (qp->key != apikey_str(qp->keyid)) astring_free(qp->key);
     astring_free(qp->value);
-    free(qp);
+    if (qp->arena == NULL) alloc_free(ALLOC_QUERYPAIR, qp, sizeof(querypair_t));
 }
 
 /**
@@ -102,10 +331,38 @@ void querypair_freeall(querypair_t* qp) {
  * @return querystring_t* The new querystring_t object
 */
 querystring_t* querystring_new() {
-    querystring_t* qs = malloc(sizeof(querystring_t));
+    return querystring_new_in(NULL);
+}
+
+/**
+ * @brief Create a new querystring_t object inside an arena.
+ * 
+ * @note Pairs added with querystring_addfrom are allocated from the same arena,
+ * so the whole querystring is released by a single arena_reset and
+ * querystring_free does not need to be called.
+ * 
+ * @public
+ * 
+ * @param arena The arena to allocate from, or NULL for the heap
+ * @return querystring_t* The new querystring_t object
+*/
+querystring_t* querystring_new_in(arena_t* arena) {
+    querystring_t* qs = qs_alloc(arena, ALLOC_QUERYSTRING, sizeof(querystring_t));
+    if (qs == NULL) return NULL;
+
     qs->len = 0;
     qs->cap = 8;
-    qs->pairs = malloc(sizeof(querypair_t*) * qs->cap);
+    qs->arena = arena;
+    qs->count = 0;
+    qs->index = NULL;
+    qs->index_cap = 0;
+    qs->index_used = 0;
+    qs->pairs = qs_alloc(arena, ALLOC_PAIR_ARRAY, sizeof(querypair_t*) * qs->cap);
+    if (qs->pairs == NULL) {
+        if (arena == NULL) alloc_free(ALLOC_QUERYSTRING, qs, sizeof(querystring_t));
+        return NULL;
+    }
+
     return qs;
 }
 
@@ -128,8 +385,11 @@ void querystring_free(querystring_t* qs, bool all) {
         else querypair_free(qs->pairs[i]);
     }
 
-    free(qs->pairs);
-    free(qs);
+    if (qs->arena != NULL) return;
+
+    alloc_free(ALLOC_PAIR_ARRAY, qs->index, sizeof(uint32_t) * qs->index_cap);
+    alloc_free(ALLOC_PAIR_ARRAY, qs->pairs, sizeof(querypair_t*) * qs->cap);
+    alloc_free(ALLOC_QUERYSTRING, qs, sizeof(querystring_t));
 }
 
 /**
@@ -144,14 +404,30 @@ void querystring_free(querystring_t* qs, bool all) {
 querystring_t* querystring_add(querystring_t* qs, querypair_t* qp) {
     if (qs == NULL || qp == NULL) return NULL;
 
+    if (qs->len == qs->cap && qs->len > qs->count * 2) compact(qs);
+
     if (qs->len == qs->cap) {
-        qs->cap *= 2;
-        querypair_t* tmp = realloc(qs->pairs, sizeof(querypair_t*) * qs->cap);
+        size_t old_size = sizeof(querypair_t*) * qs->cap;
+        querypair_t** tmp = (qs->arena != NULL)
+            ? arena_realloc(qs->arena, qs->pairs, old_size, old_size * 2)
+            : alloc_realloc(ALLOC_PAIR_ARRAY, qs->pairs, old_size, old_size * 2);
         if (tmp == NULL) return qs;
+
+        qs->pairs = tmp;
+        qs->cap *= 2;
+        if (qs->index != NULL) index_rebuild(qs);
     }
 
     qs->pairs[qs->len] = qp;
     qs->len++;
+    qs->count++;
+
+    if (qs->index != NULL) {
+        if ((qs->index_used + 1) * 4 > qs->index_cap * 3) index_rebuild(qs);
+        else index_insert(qs, qs->len - 1);
+    } else if (qs->count >= QUERYSTRING_INDEX_MIN) {
+        index_rebuild(qs);
+    }
 
     return qs;
 }
@@ -169,10 +445,33 @@ querystring_t* querystring_add(querystring_t* qs, querypair_t* qp) {
 querystring_t* querystring_addfrom(querystring_t* qs, const char* key, const char* value) {
     if (qs == NULL || key == NULL || value == NULL) return NULL;
 
-    querypair_t* qp = querypair_from(key, value);
+    // known API keys reference the interned table instead of being copied
+    apikey_t keyid = apikey_lookup(key, strlen(key));
+    querypair_t* qp = (keyid != APIKEY_NONE) ? querypair_fromk_in(qs->arena, keyid, value)
+                                             : querypair_from_in(qs->arena, key, value);
     return querystring_add(qs, qp);
 }
 
+/**
+ * @brief Remove the pair in a slot, leaving a hole.
+ * 
+ * @internal
+*/
+static querystring_t* remove_slot(querystring_t* qs, size_t slot, size_t entry, bool all) {
+    if (all == true) querypair_freeall(qs->pairs[slot]);
+    else querypair_free(qs->pairs[slot]);
+
+    // leave a hole instead of shifting, it is compacted once holes dominate
+    qs->pairs[slot] = NULL;
+    qs->count--;
+    if (qs->index != NULL) qs->index[entry] = INDEX_DELETED;
+
+    if (slot == qs->len - 1) qs->len--;
+    else if (qs->len > 16 && qs->len > qs->count * 2) compact(qs);
+
+    return qs;
+}
+
 /**
  * @brief Remove a querypair_t object from a querystring_t object.
  * 
@@ -187,30 +486,12 @@ querystring_t* querystring_addfrom(querystring_t* qs, const char* key, const cha
 querystring_t* querystring_remove(querystring_t* qs, const char* key, bool all) {
     if (qs == NULL || key == NULL) return NULL;
 
-    size_t i = 0;
-    size_t index = 0;
-
-    for (; i < qs->len; i++) {
-        if (astring_eqs(qs->pairs[i]->key, key) == true) {
-            index = i;
-
-            if (all == true) querypair_freeall(qs->pairs[i]);
-            else querypair_free(qs->pairs[i]);
-
-            qs->pairs[i] = NULL;
+    size_t key_len = strlen(key);
+    size_t entry = 0;
+    size_t slot = find_slot(qs, key, key_len, astring_hashraw(key, key_len), APIKEY_NONE, &entry);
+    if (slot == INDEX_NPOS) return qs;
 
-            break;
-        }
-    }
-
-    // shift from index to end
-    for (i = index; i < qs->len - 1; i++) {
-        qs->pairs[i] = qs->pairs[i + 1];
-    }
-
-    qs->len--;
-
-    return qs;
+    return remove_slot(qs, slot, entry, all);
 }
 
 /**
@@ -226,15 +507,12 @@ querystring_t* querystring_remove(querystring_t* qs, const char* key, bool all)
 querystring_t* querystring_set(querystring_t* qs, const char* key, astring_t* value) {
     if (qs == NULL || key == NULL || value == NULL) return NULL;
 
-    size_t i = 0;
+    size_t key_len = strlen(key);
+    size_t slot = find_slot(qs, key, key_len, astring_hashraw(key, key_len), APIKEY_NONE, NULL);
+    if (slot == INDEX_NPOS) return qs;
 
-    for (; i < qs->len; i++) {
-        if (astring_eqs(qs->pairs[i]->key, key) == true) {
-            astring_free(qs->pairs[i]->value);
-            qs->pairs[i]->value = value;
-            return qs;
-        }
-    }
+    astring_free(qs->pairs[slot]->value);
+    qs->pairs[slot]->value = value;
 
     return qs;
 }
@@ -251,15 +529,179 @@ querystring_t* querystring_set(querystring_t* qs, const char* key, astring_t* va
 astring_t* querystring_get(const querystring_t* qs, const char* key) {
     if (qs == NULL || key == NULL) return NULL;
 
+    size_t key_len = strlen(key);
+    size_t slot = find_slot(qs, key, key_len, astring_hashraw(key, key_len), APIKEY_NONE, NULL);
+    if (slot == INDEX_NPOS) return NULL;
+
+    return qs->pairs[slot]->value;
+}
+
+/**
+ * @brief Add a value under an interned key to a querystring_t object.
+ * 
+ * @public
+ * 
+ * @param qs The querystring_t object to add to
+ * @param key The interned key of the querypair_t object to add
+ * @param value The value of the querypair_t object to add
+ * @return querystring_t* The querystring_t object
+*/
+querystring_t* querystring_addk(querystring_t* qs, apikey_t key, const char* value) {
+    if (qs == NULL || value == NULL) return NULL;
+
+    querypair_t* qp = querypair_fromk_in(qs->arena, key, value);
+    return querystring_add(qs, qp);
+}
+
+/**
+ * @brief Find the first slot holding an interned key.
+ * 
+ * @internal
+*/
+static size_t find_slotk(const querystring_t* qs, apikey_t key, size_t* entry) {
+    const astring_t* key_str = apikey_str(key);
+    if (key_str == NULL) return INDEX_NPOS;
+
+    return find_slot(qs, key_str->raw, key_str->len, apikey_hash(key), key, entry);
+}
+
+/**
+ * @brief Remove the querypair_t object with an interned key.
+ * 
+ * @public
+ * 
+ * @param qs The querystring_t object to remove from
+ * @param key The interned key of the querypair_t object to remove
+ * @param all Whether or not to free the value astring_t object
+ * @return querystring_t* The querystring_t object
+*/
+querystring_t* querystring_removek(querystring_t* qs, apikey_t key, bool all) {
+    if (qs == NULL) return NULL;
+
+    size_t entry = 0;
+    size_t slot = find_slotk(qs, key, &entry);
+    if (slot == INDEX_NPOS) return qs;
+
+    return remove_slot(qs, slot, entry, all);
+}
+
+/**
+ * @brief Set the value of the querypair_t object with an interned key.
+ * 
+ * @public
+ * 
+ * @param qs The querystring_t object to set the value in
+ * @param key The interned key of the querypair_t object to set the value of
+ * @param value The new value of the querypair_t object
+ * @return querystring_t* The querystring_t object
+*/
+querystring_t* querystring_setk(querystring_t* qs, apikey_t key, astring_t* value) {
+    if (qs == NULL || value == NULL) return NULL;
+
+    size_t slot = find_slotk(qs, key, NULL);
+    if (slot == INDEX_NPOS) return qs;
+
+    astring_free(qs->pairs[slot]->value);
+    qs->pairs[slot]->value = value;
+
+    return qs;
+}
+
+/**
+ * @brief Get the value of the querypair_t object with an interned key.
+ * 
+ * @public
+ * 
+ * @param qs The querystring_t object to get the value from
+ * @param key The interned key of the querypair_t object to get the value of
+ * @return astring_t* The value of the querypair_t object or NULL if not found
+*/
+astring_t* querystring_getk(const querystring_t* qs, apikey_t key) {
+    if (qs == NULL) return NULL;
+
+    size_t slot = find_slotk(qs, key, NULL);
+    if (slot == INDEX_NPOS) return NULL;
+
+    return qs->pairs[slot]->value;
+}
+
+/**
+ * @brief Get the exact length of the serialized form of a querystring_t object.
+ * 
+ * @public
+ * 
+ * @param qs The querystring_t object to measure
+ * @return size_t The length of the serialized string, excluding the null terminator
+*/
+size_t querystring_encodedlen(const querystring_t* qs) {
+    if (qs == NULL) return 0;
+
+    size_t len = 0;
+    size_t count = 0;
     size_t i = 0;
 
     for (; i < qs->len; i++) {
-        if (astring_eqs(qs->pairs[i]->key, key) == true) {
-            return qs->pairs[i]->value;
+        const querypair_t* qp = qs->pairs[i];
+        if (qp == NULL || qp->key == NULL || qp->value == NULL) continue;
+
+        // interned keys are stored pre-encoded
+        if (qp->keyid != APIKEY_NONE) len += qp->key->len;
+        else len += urlencode_len(qp->key->raw, qp->key->len);
+        len += urlencode_len(qp->value->raw, qp->value->len);
+        len += 1; // '='
+        count++;
+    }
+
+    if (count > 1) len += count - 1; // '&' separators
+
+    return len;
+}
+
+/**
+ * @brief Serialize a querystring_t object into an existing astring.
+ * 
+ * @note The contents of dest are replaced. dest is only reallocated when its
+ * capacity is too small, so reusing one buffer across requests does not allocate
+ * in steady state.
+ * 
+ * @public
+ * 
+ * @param qs The querystring_t object to convert
+ * @param dest The astring to write the serialized string to
+ * @return astring_t* The updated astring or NULL if an error occurred
+*/
+astring_t* querystring_tostring_into(const querystring_t* qs, astring_t* dest) {
+    if (qs == NULL || dest == NULL) return NULL;
+
+    size_t needed = querystring_encodedlen(qs) + 1;
+
+    if (astring_reserve(dest, needed) == NULL) return NULL;
+
+    char* out = dest->raw;
+    bool first = true;
+    size_t i = 0;
+
+    for (; i < qs->len; i++) {
+        const querypair_t* qp = qs->pairs[i];
+        if (qp == NULL || qp->key == NULL || qp->value == NULL) continue;
+
+        if (first == false) *out++ = '&';
+        first = false;
+
+        if (qp->keyid != APIKEY_NONE) {
+            memcpy(out, qp->key->raw, qp->key->len);
+            out += qp->key->len;
+        } else {
+            out += urlencode_raw(out, qp->key->raw, qp->key->len);
         }
+        *out++ = '=';
+        out += urlencode_raw(out, qp->value->raw, qp->value->len);
     }
 
-    return NULL;
+    *out = '\0';
+    dest->len = (size_t)(out - dest->raw);
+
+    return dest;
 }
 
 /**
@@ -273,37 +715,189 @@ astring_t* querystring_get(const querystring_t* qs, const char* key) {
 astring_t* querystring_tostring(const querystring_t* qs) {
     if (qs == NULL) return NULL;
 
-    CURL* curl = curl_easy_init();
-    astring_t* str = astring_new(32);
-    size_t i = 0;
-
+    astring_t* str = astring_new(querystring_encodedlen(qs) + 1);
     if (str == NULL) return NULL;
-    if (curl == NULL) {
+
+    if (querystring_tostring_into(qs, str) == NULL) {
         astring_free(str);
         return NULL;
     }
 
+    return str;
+}
+
+/**
+ * @brief Order pairs by key, then by value.
+ * 
+ * @internal
+*/
+static int pair_cmp(const void* a, const void* b) {
+    const querypair_t* qa = *(const querypair_t* const*)a;
+    const querypair_t* qb = *(const querypair_t* const*)b;
+    size_t len = (qa->key->len < qb->key->len) ? qa->key->len : qb->key->len;
+    int cmp = memcmp(qa->key->raw, qb->key->raw, len);
+
+    if (cmp != 0) return cmp;
+    if (qa->key->len != qb->key->len) return (qa->key->len < qb->key->len) ? -1 : 1;
+
+    len = (qa->value->len < qb->value->len) ? qa->value->len : qb->value->len;
+    cmp = memcmp(qa->value->raw, qb->value->raw, len);
+
+    if (cmp != 0) return cmp;
+    if (qa->value->len != qb->value->len) return (qa->value->len < qb->value->len) ? -1 : 1;
+
+    return 0;
+}
+
+/**
+ * @brief Serialize a querystring_t object in canonical form.
+ * 
+ * @note Pairs are sorted by key and value and percent-encoded the same way
+ * as querystring_tostring, so queries that only differ in parameter order or
+ * escaping produce the same string. maxlag is left out because it does not
+ * change the response. The contents of dest are replaced.
+ * 
+ * @public
+ * 
+ * @param qs The querystring_t object to convert
+ * @param dest The astring to write the canonical string to
+ * @return astring_t* The updated astring or NULL if an error occurred
+*/
+astring_t* querystring_canonical_into(const querystring_t* qs, astring_t* dest) {
+    if (qs == NULL || dest == NULL) return NULL;
+
+    querypair_t* stack[32];
+    querypair_t** sorted = (qs->count <= 32) ? stack : alloc_malloc(ALLOC_PAIR_ARRAY, sizeof(querypair_t*) * qs->count);
+    if (sorted == NULL) return NULL;
+
+    size_t count = 0;
+    size_t i = 0;
+
     for (; i < qs->len; i++) {
-        astring_t* encoded_key = urlencode(curl, qs->pairs[i]->key);
-        astring_t* encoded_value = urlencode(curl, qs->pairs[i]->value);
+        querypair_t* qp = qs->pairs[i];
+        if (qp == NULL || qp->key == NULL || qp->value == NULL || qp->keyid == APIKEY_MAXLAG) continue;
 
-        if (encoded_key == NULL || encoded_value == NULL) {
-            astring_free(encoded_key);
-            astring_free(encoded_value);
-            continue;
-        }
+        sorted[count++] = qp;
+    }
+
+    qsort(sorted, count, sizeof(querypair_t*), pair_cmp);
+
+    size_t needed = 1;
+    for (i = 0; i < count; i++) {
+        needed += urlencode_len(sorted[i]->key->raw, sorted[i]->key->len) + urlencode_len(sorted[i]->value->raw, sorted[i]->value->len) + 2;
+    }
 
-        str = astring_append(str, encoded_key->raw);
-        str = astring_append(str, "=");
-        str = astring_append(str, encoded_value->raw);
+    if (astring_reserve(dest, needed) == NULL) {
+        if (sorted != stack) alloc_free(ALLOC_PAIR_ARRAY, sorted, sizeof(querypair_t*) * qs->count);
+        return NULL;
+    }
+
+    char* out = dest->raw;
+    for (i = 0; i < count; i++) {
+        if (i > 0) *out++ = '&';
+        out += urlencode_raw(out, sorted[i]->key->raw, sorted[i]->key->len);
+        *out++ = '=';
+        out += urlencode_raw(out, sorted[i]->value->raw, sorted[i]->value->len);
+    }
+
+    *out = '\0';
+    dest->len = (size_t)(out - dest->raw);
 
-        astring_free(encoded_key);
-        astring_free(encoded_value);
+    if (sorted != stack) alloc_free(ALLOC_PAIR_ARRAY, sorted, sizeof(querypair_t*) * qs->count);
+    return dest;
+}
 
-        if (i < qs->len - 1) astring_append(str, "&");
+/**
+ * @brief Add a pair that borrows its key and value from a parse buffer.
+ * 
+ * @internal
+*/
+static querystring_t* parse_pair(querystring_t* qs, char* key, size_t key_len, char* value, size_t value_len) {
+    apikey_t keyid = apikey_lookup(key, key_len);
+    astring_t* key_str = (keyid != APIKEY_NONE) ? (astring_t*)apikey_str(keyid) : astring_borrow_in(qs->arena, key, key_len);
+    astring_t* value_str = astring_borrow_in(qs->arena, value, value_len);
+    querypair_t* qp = qs_alloc(qs->arena, ALLOC_QUERYPAIR, sizeof(querypair_t));
+
+    if (key_str == NULL || value_str == NULL || qp == NULL) {
+        if (keyid == APIKEY_NONE) astring_free(key_str);
+        astring_free(value_str);
+        if (qs->arena == NULL) alloc_free(ALLOC_QUERYPAIR, qp, sizeof(querypair_t));
+        return NULL;
     }
 
-    curl_easy_cleanup(curl);
+    qp->key = key_str;
+    qp->value = value_str;
+    qp->arena = qs->arena;
+    qp->hash = (keyid != APIKEY_NONE) ? apikey_hash(keyid) : astring_hashraw(key, key_len);
+    qp->keyid = keyid;
+    return querystring_add(qs, qp);
+}
+
+/**
+ * @brief Parse a query string into a new querystring_t object.
+ * 
+ * @public
+ * 
+ * @param buf The query string to parse, decoded in place
+ * @param len The length of the query string
+ * @return querystring_t* The parsed querystring_t object
+*/
+querystring_t* querystring_parse(char* buf, size_t len) {
+    return querystring_parse_in(NULL, buf, len);
+}
 
-    return astring_fit(str);
+/**
+ * @brief Parse a query string into a new querystring_t object inside an arena.
+ * 
+ * @note Parsing is zero-copy: keys and values are percent-decoded in place
+ * and the pairs borrow them from buf, so buf must outlive the querystring.
+ * buf must have room for a null terminator at buf[len]. Known API keys are
+ * interned, a leading '?' and empty segments are skipped, and a key without
+ * '=' gets an empty value.
+ * 
+ * @public
+ * 
+ * @param arena The arena to allocate from, or NULL for the heap
+ * @param buf The query string to parse, decoded in place
+ * @param len The length of the query string
+ * @return querystring_t* The parsed querystring_t object
+*/
+querystring_t* querystring_parse_in(arena_t* arena, char* buf, size_t len) {
+    if (buf == NULL) return NULL;
+
+    querystring_t* qs = querystring_new_in(arena);
+    if (qs == NULL) return NULL;
+
+    size_t pos = (len > 0 && buf[0] == '?') ? 1 : 0;
+
+    while (pos < len) {
+        char* seg = buf + pos;
+        char* amp = memchr(seg, '&', len - pos);
+        size_t seg_len = (amp != NULL) ? (size_t)(amp - seg) : len - pos;
+
+        pos += seg_len + 1;
+        if (seg_len == 0) continue;
+
+        char* eq = memchr(seg, '=', seg_len);
+        size_t key_len = (eq != NULL) ? (size_t)(eq - seg) : seg_len;
+
+        // decoding never grows, so each terminator lands on or before the separator
+        key_len = urldecode_raw(seg, seg, key_len, true);
+        seg[key_len] = '\0';
+
+        char* value = seg + key_len;
+        size_t value_len = 0;
+        if (eq != NULL) {
+            value = eq + 1;
+            value_len = urldecode_raw(value, value, seg_len - (size_t)(value - seg), true);
+            value[value_len] = '\0';
+        }
+
+        if (parse_pair(qs, seg, key_len, value, value_len) == NULL) {
+            querystring_free(qs, true);
+            return NULL;
+        }
+    }
+
+    return qs;
 }
\ No newline at end of file
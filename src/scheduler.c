@@ -0,0 +1,586 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "scheduler.h"
+
+/**
+ * @brief Get the monotonic time in nanoseconds.
+ * 
+ * @internal
+*/
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Get the length of the scheme and authority part of an endpoint.
+ * 
+ * @internal
+*/
+static size_t host_len(const char* endpoint) {
+    const char* start = strstr(endpoint, "://");
+    start = (start != NULL) ? start + 3 : endpoint;
+
+    size_t len = strcspn(start, "/?#");
+    return (size_t)(start - endpoint) + len;
+}
+
+/**
+ * @brief Find the state of an endpoint's host, creating it if needed.
+ * 
+ * @internal
+*/
+static scheduler_host_t* host_get(scheduler_t* scheduler, const char* endpoint) {
+    size_t len = host_len(endpoint);
+    uint64_t hash = astring_hashraw(endpoint, len);
+    size_t i = 0;
+
+    for (; i < scheduler->host_count; i++) {
+        scheduler_host_t* host = scheduler->hosts[i];
+        if (host->hash == hash && host->name->len == len && memcmp(host->name->raw, endpoint, len) == 0) return host;
+    }
+
+    if (scheduler->host_count == scheduler->host_cap) {
+        size_t cap = (scheduler->host_cap == 0) ? 8 : scheduler->host_cap * 2;
+        scheduler_host_t** tmp = realloc(scheduler->hosts, sizeof(scheduler_host_t*) * cap);
+        if (tmp == NULL) return NULL;
+
+        scheduler->hosts = tmp;
+        scheduler->host_cap = cap;
+    }
+
+    scheduler_host_t* host = calloc(1, sizeof(scheduler_host_t));
+    if (host == NULL) return NULL;
+
+    host->name = astring_new(len + 1);
+    if (host->name == NULL || astring_appendn(host->name, endpoint, len) == NULL) {
+        astring_free(host->name);
+        free(host);
+        return NULL;
+    }
+
+    host->hash = hash;
+    host->rate = scheduler->rate;
+    host->max_rate = scheduler->rate;
+    host->burst = scheduler->burst;
+    host->tokens = scheduler->burst;
+    host->refilled = now_ns();
+    host->max_inflight = scheduler->concurrency;
+
+    scheduler->hosts[scheduler->host_count++] = host;
+    return host;
+}
+
+/**
+ * @brief Free a scheduled request and the buffers it still owns.
+ * 
+ * @internal
+*/
+static void request_free(scheduler_request_t* req) {
+    astring_free(req->url);
+    astring_free(req->post);
+    free(req);
+}
+
+/**
+ * @brief Put a request at the back, or for a retry the front, of its host's queue.
+ * 
+ * @internal
+*/
+static void enqueue(scheduler_request_t* req, bool front) {
+    scheduler_host_t* host = req->host;
+
+    if (front) {
+        req->next = host->queue;
+        host->queue = req;
+        if (host->queue_tail == NULL) host->queue_tail = req;
+    } else {
+        req->next = NULL;
+        if (host->queue_tail != NULL) host->queue_tail->next = req;
+        else host->queue = req;
+        host->queue_tail = req;
+    }
+
+    host->queued++;
+}
+
+/**
+ * @brief Slow a host down after it throttled a request.
+ * 
+ * @note Requests already in flight when the host backed off were sent at the
+ * old rate, so their throttles are the same signal and only get retried.
+ * 
+ * @internal
+*/
+static void backoff(scheduler_host_t* host, const scheduler_request_t* req, int64_t seconds) {
+    host->throttled++;
+    if (req->dispatched < host->backed_off) return;
+
+    int64_t now = now_ns();
+    int64_t resume = now + seconds * 1000000000;
+
+    if (resume > host->resume) host->resume = resume;
+    host->rate = (host->rate / 2 > SCHEDULER_MIN_RATE) ? host->rate / 2 : SCHEDULER_MIN_RATE;
+    host->tokens = 0;
+    host->backed_off = now;
+}
+
+/**
+ * @brief Check whether a response asks the client to slow down.
+ * 
+ * @note MediaWiki answers maxlag errors with a 200 and a Retry-After header,
+ * the body is only checked as a fallback when it was buffered.
+ * 
+ * @internal
+*/
+static bool is_throttled(const engine_request_t* req, const scheduler_request_t* sreq) {
+    if (req->status == 429 || req->status == 503 || req->retry_after > 0) return true;
+
+    return sreq->sink == NULL && req->body != NULL && astring_containss(req->body, "\"code\":\"maxlag\"");
+}
+
+static void dispatch(scheduler_t* scheduler, scheduler_request_t* req, int64_t now);
+
+/**
+ * @brief Handle a completed attempt, retrying it if the host throttled it.
+ * 
+ * @internal
+*/
+static void on_done(engine_request_t* req, void* userdata) {
+    scheduler_request_t* sreq = userdata;
+    scheduler_t* scheduler = sreq->scheduler;
+    scheduler_host_t* host = sreq->host;
+
+    host->inflight--;
+    host->wire_bytes += req->wire_bytes;
+    host->decoded_bytes += req->decoded_bytes;
+
+    if (req->result == CURLE_OK && is_throttled(req, sreq)) {
+        backoff(host, sreq, (req->retry_after > 0) ? (int64_t)req->retry_after : SCHEDULER_DEFAULT_BACKOFF);
+
+        // a sink has already consumed the error body, so only buffered requests are retried
+        if (scheduler->closing == false && sreq->sink == NULL && sreq->attempts < SCHEDULER_MAX_RETRIES) {
+            sreq->url = req->url;
+            sreq->post = req->post;
+            req->url = NULL;
+            req->post = NULL;
+            enqueue(sreq, true);
+            return;
+        }
+    } else if (req->result == CURLE_OK) {
+        double rate = host->rate + host->max_rate / 20;
+        host->rate = (rate < host->max_rate) ? rate : host->max_rate;
+    }
+
+    scheduler->pending--;
+    if (scheduler->closing == false && sreq->callback != NULL) sreq->callback(req, sreq->userdata);
+    free(sreq);
+}
+
+/**
+ * @brief Hand a request to the engine.
+ * 
+ * @internal
+*/
+static void dispatch(scheduler_t* scheduler, scheduler_request_t* req, int64_t now) {
+    astring_t* url = req->url;
+    astring_t* post = req->post;
+
+    req->url = NULL;
+    req->post = NULL;
+    req->attempts++;
+    req->dispatched = now;
+    req->host->inflight++;
+
+    engine_request_t* ereq = engine_submitraw(scheduler->engine, url, post, on_done, req);
+    if (ereq == NULL) {
+        req->host->inflight--;
+        scheduler->pending--;
+
+        engine_request_t failed;
+        memset(&failed, 0, sizeof(failed));
+        failed.result = CURLE_OUT_OF_MEMORY;
+        if (req->callback != NULL) req->callback(&failed, req->userdata);
+        free(req);
+        return;
+    }
+
+    // the query is only serialized once, so retries have no build time of their own
+    if (req->attempts == 1) ereq->phases[TIMING_BUILD] = req->build_ns;
+    engine_setsink(ereq, req->sink, req->sink_data);
+}
+
+/**
+ * @brief Send every request the hosts' buckets allow.
+ * 
+ * @internal
+ * 
+ * @return int64_t The monotonic time a waiting request can next be sent, or -1 if none is waiting on time
+*/
+static int64_t pump(scheduler_t* scheduler) {
+    int64_t now = now_ns();
+    int64_t wake = -1;
+    size_t i = 0;
+
+    for (; i < scheduler->host_count; i++) {
+        scheduler_host_t* host = scheduler->hosts[i];
+
+        double tokens = host->tokens + host->rate * (double)(now - host->refilled) / 1e9;
+        host->tokens = (tokens < host->burst) ? tokens : host->burst;
+        host->refilled = now;
+
+        while (host->queue != NULL && host->inflight < host->max_inflight && now >= host->resume && host->tokens >= 1.0) {
+            scheduler_request_t* req = host->queue;
+            host->queue = req->next;
+            if (host->queue == NULL) host->queue_tail = NULL;
+            host->queued--;
+
+            host->tokens -= 1.0;
+            dispatch(scheduler, req, now);
+        }
+
+        // hosts at their concurrency cap are woken by a completion instead
+        if (host->queue == NULL || host->inflight >= host->max_inflight) continue;
+
+        int64_t at = (now < host->resume) ? host->resume : now + (int64_t)((1.0 - host->tokens) / host->rate * 1e9) + 1;
+        if (wake < 0 || at < wake) wake = at;
+    }
+
+    return wake;
+}
+
+/**
+ * @brief Create a new scheduler.
+ * 
+ * @public
+ * 
+ * @param engine The engine to send the requests with
+ * @return scheduler_t* The new scheduler, or NULL if an error occurred
+*/
+scheduler_t* scheduler_new(engine_t* engine) {
+    if (engine == NULL) return NULL;
+
+    scheduler_t* scheduler = calloc(1, sizeof(scheduler_t));
+    if (scheduler == NULL) return NULL;
+
+    scheduler->engine = engine;
+    scheduler->rate = SCHEDULER_DEFAULT_RATE;
+    scheduler->burst = SCHEDULER_DEFAULT_BURST;
+    scheduler->concurrency = SCHEDULER_DEFAULT_CONCURRENCY;
+    scheduler->maxlag = astring_from(SCHEDULER_DEFAULT_MAXLAG);
+    if (scheduler->maxlag == NULL) {
+        free(scheduler);
+        return NULL;
+    }
+
+    return scheduler;
+}
+
+/**
+ * @brief Free a scheduler.
+ * 
+ * @note Queued requests are dropped and requests in flight are run to
+ * completion, in both cases without calling their callbacks.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to free
+*/
+void scheduler_free(scheduler_t* scheduler) {
+    if (scheduler == NULL) return;
+
+    scheduler->closing = true;
+    size_t i = 0;
+
+    for (; i < scheduler->host_count; i++) {
+        scheduler_host_t* host = scheduler->hosts[i];
+
+        while (host->queue != NULL) {
+            scheduler_request_t* next = host->queue->next;
+            request_free(host->queue);
+            scheduler->pending--;
+            host->queue = next;
+        }
+    }
+
+    while (scheduler->pending > 0) {
+        if (engine_poll(scheduler->engine, -1) < 0) break;
+    }
+
+    for (i = 0; i < scheduler->host_count; i++) {
+        astring_free(scheduler->hosts[i]->name);
+        free(scheduler->hosts[i]);
+    }
+
+    free(scheduler->hosts);
+    astring_free(scheduler->maxlag);
+    free(scheduler);
+}
+
+/**
+ * @brief Set the limits of hosts without their own configuration.
+ * 
+ * @note Hosts that have already been seen keep their limits.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to configure
+ * @param rate The requests per second
+ * @param burst The most requests sent back to back
+ * @param concurrency The most requests in flight
+*/
+void scheduler_setdefaults(scheduler_t* scheduler, double rate, double burst, size_t concurrency) {
+    if (scheduler == NULL || rate <= 0 || burst < 1 || concurrency == 0) return;
+
+    scheduler->rate = rate;
+    scheduler->burst = burst;
+    scheduler->concurrency = concurrency;
+}
+
+/**
+ * @brief Set the limits of one host.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to configure
+ * @param endpoint An endpoint on the host
+ * @param rate The requests per second
+ * @param burst The most requests sent back to back
+ * @param concurrency The most requests in flight
+ * @return bool True if the host was configured, false otherwise
+*/
+bool scheduler_sethost(scheduler_t* scheduler, const char* endpoint, double rate, double burst, size_t concurrency) {
+    if (scheduler == NULL || endpoint == NULL || rate <= 0 || burst < 1 || concurrency == 0) return false;
+
+    scheduler_host_t* host = host_get(scheduler, endpoint);
+    if (host == NULL) return false;
+
+    host->rate = rate;
+    host->max_rate = rate;
+    host->burst = burst;
+    host->tokens = (host->tokens < burst) ? host->tokens : burst;
+    host->max_inflight = concurrency;
+    return true;
+}
+
+/**
+ * @brief Set the maxlag value added to queries.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to configure
+ * @param maxlag The value in seconds, or NULL to stop adding maxlag
+ * @return bool True if the value was set, false otherwise
+*/
+bool scheduler_setmaxlag(scheduler_t* scheduler, const char* maxlag) {
+    if (scheduler == NULL) return false;
+
+    astring_t* value = NULL;
+    if (maxlag != NULL && (value = astring_from(maxlag)) == NULL) return false;
+
+    astring_free(scheduler->maxlag);
+    scheduler->maxlag = value;
+    return true;
+}
+
+/**
+ * @brief Queue a request on its host.
+ * 
+ * @internal
+*/
+static scheduler_request_t* submit(scheduler_t* scheduler, const char* endpoint, astring_t* url, astring_t* post, engine_callback_t callback, void* userdata) {
+    scheduler_host_t* host = host_get(scheduler, endpoint);
+    scheduler_request_t* req = calloc(1, sizeof(scheduler_request_t));
+
+    if (host == NULL || req == NULL || url == NULL) {
+        astring_free(url);
+        astring_free(post);
+        free(req);
+        return NULL;
+    }
+
+    req->url = url;
+    req->post = post;
+    req->callback = callback;
+    req->userdata = userdata;
+    req->scheduler = scheduler;
+    req->host = host;
+
+    enqueue(req, false);
+    scheduler->pending++;
+    return req;
+}
+
+/**
+ * @brief Add the maxlag parameter to a query that does not set it.
+ * 
+ * @internal
+*/
+static bool inject_maxlag(scheduler_t* scheduler, querystring_t* qs) {
+    if (scheduler->maxlag == NULL || querystring_getk(qs, APIKEY_MAXLAG) != NULL) return true;
+
+    return querystring_addk(qs, APIKEY_MAXLAG, scheduler->maxlag->raw) != NULL;
+}
+
+/**
+ * @brief Queue a GET request to an API endpoint.
+ * 
+ * @note maxlag is added to qs unless it is already set. The query is
+ * serialized immediately, but the request is only sent from scheduler_poll or
+ * scheduler_run once its host allows it.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to submit to
+ * @param endpoint The API endpoint URL
+ * @param qs The query parameters
+ * @param callback The function called with the final attempt
+ * @param userdata Passed through to the callback
+ * @return scheduler_request_t* The request, or NULL if an error occurred
+*/
+scheduler_request_t* scheduler_submit(scheduler_t* scheduler, const char* endpoint, querystring_t* qs, engine_callback_t callback, void* userdata) {
+    if (scheduler == NULL || endpoint == NULL || qs == NULL || inject_maxlag(scheduler, qs) == false) return NULL;
+
+    bool timed = scheduler->engine->timing != NULL;
+    uint64_t start = timed ? timing_now() : 0;
+    astring_t* url = engine_url(endpoint, qs);
+    uint64_t built = timed ? timing_now() - start : 0;
+
+    scheduler_request_t* req = submit(scheduler, endpoint, url, NULL, callback, userdata);
+    if (req != NULL) req->build_ns = built;
+
+    return req;
+}
+
+/**
+ * @brief Queue a POST request to an API endpoint.
+ * 
+ * @note maxlag is added to qs unless it is already set.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to submit to
+ * @param endpoint The API endpoint URL
+ * @param qs The form parameters
+ * @param callback The function called with the final attempt
+ * @param userdata Passed through to the callback
+ * @return scheduler_request_t* The request, or NULL if an error occurred
+*/
+scheduler_request_t* scheduler_submitpost(scheduler_t* scheduler, const char* endpoint, querystring_t* qs, engine_callback_t callback, void* userdata) {
+    if (scheduler == NULL || endpoint == NULL || qs == NULL || inject_maxlag(scheduler, qs) == false) return NULL;
+
+    bool timed = scheduler->engine->timing != NULL;
+    uint64_t start = timed ? timing_now() : 0;
+    astring_t* post = querystring_tostring(qs);
+    if (post == NULL) return NULL;
+
+    uint64_t built = timed ? timing_now() - start : 0;
+    scheduler_request_t* req = submit(scheduler, endpoint, astring_from(endpoint), post, callback, userdata);
+    if (req != NULL) req->build_ns = built;
+
+    return req;
+}
+
+/**
+ * @brief Stream a scheduled request's body to a sink.
+ * 
+ * @note Requests with a sink are not retried when throttled, because the
+ * sink has already seen the error response.
+ * 
+ * @public
+ * 
+ * @param req The request to redirect
+ * @param sink The function receiving each chunk
+ * @param userdata Passed through to the sink
+*/
+void scheduler_setsink(scheduler_request_t* req, engine_sink_t sink, void* userdata) {
+    if (req == NULL) return;
+
+    req->sink = sink;
+    req->sink_data = userdata;
+}
+
+/**
+ * @brief Send what the hosts allow and wait for activity once.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to poll
+ * @param timeout_ms The most time to wait in milliseconds, or -1 to wait for activity
+ * @return int The number of requests still pending, or -1 if an error occurred
+*/
+int scheduler_poll(scheduler_t* scheduler, int timeout_ms) {
+    if (scheduler == NULL) return -1;
+
+    int64_t wake = pump(scheduler);
+    if (scheduler->pending == 0) return 0;
+
+    if (wake >= 0) {
+        int64_t wait = (wake - now_ns() + 999999) / 1000000;
+        if (wait < 0) wait = 0;
+        if (timeout_ms < 0 || wait < timeout_ms) timeout_ms = (int)wait;
+    }
+
+    if (engine_poll(scheduler->engine, timeout_ms) < 0) return -1;
+
+    pump(scheduler);
+    return (int)scheduler->pending;
+}
+
+/**
+ * @brief Run until every scheduled request has completed.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to run
+ * @return int 0 on success, or -1 if an error occurred
+*/
+int scheduler_run(scheduler_t* scheduler) {
+    if (scheduler == NULL) return -1;
+
+    while (scheduler->pending > 0) {
+        if (scheduler_poll(scheduler, -1) < 0) return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Get the number of requests queued or in flight.
+ * 
+ * @public
+ * 
+ * @param scheduler The scheduler to query
+ * @return size_t The number of pending requests
+*/
+size_t scheduler_pending(const scheduler_t* scheduler) {
+    return (scheduler != NULL) ? scheduler->pending : 0;
+}
\ No newline at end of file
@@ -0,0 +1,536 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "timing.h"
+
+/** Hands out collector and thread ids, never reused so stale caches cannot match. */
+static uint64_t next_id = 1;
+
+/** The calling thread's id, 0 until it first records. */
+static __thread uint64_t thread_id;
+
+/** The calling thread's shard of the collector it last recorded into. */
+static __thread uint64_t cached_timing;
+static __thread timing_shard_t* cached_shard;
+
+static const char* const phase_names[TIMING_PHASES] = {
+    "build", "dns", "connect", "tls", "ttfb", "transfer", "parse", "total"
+};
+
+/**
+ * @brief Map a value to its histogram bucket.
+ * 
+ * @internal
+*/
+static size_t bucket_of(uint64_t value) {
+    if (value < (2u << TIMING_SUB_BITS)) return (size_t)value;
+
+    unsigned exponent = 63 - (unsigned)__builtin_clzll(value);
+    size_t index = (size_t)(exponent - TIMING_SUB_BITS) << TIMING_SUB_BITS;
+    index += (size_t)(value >> (exponent - TIMING_SUB_BITS));
+
+    return (index < TIMING_BUCKETS) ? index : TIMING_BUCKETS - 1;
+}
+
+/**
+ * @brief Get the largest value a histogram bucket holds.
+ * 
+ * @internal
+*/
+static uint64_t bucket_max(size_t index) {
+    if (index < (2u << TIMING_SUB_BITS)) return (uint64_t)index;
+
+    unsigned shift = (unsigned)(index >> TIMING_SUB_BITS) - 1;
+    uint64_t mantissa = (uint64_t)(index & ((1u << TIMING_SUB_BITS) - 1)) + (1u << TIMING_SUB_BITS);
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+/**
+ * @brief Add to a counter only the calling thread writes.
+ * 
+ * @note A relaxed load and store instead of an atomic add, readers only
+ * need to see a value that was current at some point.
+ * 
+ * @internal
+*/
+static inline void counter_add(uint64_t* counter, uint64_t value) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Find the calling thread's shard, creating and publishing it if needed.
+ * 
+ * @internal
+*/
+static timing_shard_t* shard_get(timing_t* timing) {
+    if (cached_timing == timing->id) return cached_shard;
+    if (thread_id == 0) thread_id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+
+    timing_shard_t* shard = __atomic_load_n(&timing->shards, __ATOMIC_ACQUIRE);
+    while (shard != NULL && shard->owner != thread_id) shard = shard->next;
+
+    if (shard == NULL) {
+        shard = calloc(1, sizeof(timing_shard_t));
+        if (shard == NULL) return NULL;
+
+        shard->owner = thread_id;
+        shard->next = __atomic_load_n(&timing->shards, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&timing->shards, &shard->next, shard, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    cached_timing = timing->id;
+    cached_shard = shard;
+    return shard;
+}
+
+/**
+ * @brief Copy a name into a fixed buffer, truncating it if needed.
+ * 
+ * @internal
+*/
+static void copy_name(char* dest, size_t cap, const char* src, size_t len) {
+    if (len >= cap) len = cap - 1;
+
+    memcpy(dest, src, len);
+    dest[len] = '\0';
+}
+
+/**
+ * @brief Create a timing collector.
+ * 
+ * @public
+ * 
+ * @return timing_t* The new collector, or NULL if an error occurred
+*/
+timing_t* timing_new(void) {
+    timing_t* timing = calloc(1, sizeof(timing_t));
+    if (timing == NULL) return NULL;
+
+    timing->id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+    return timing;
+}
+
+/**
+ * @brief Free a timing collector.
+ * 
+ * @note No thread may be recording into the collector.
+ * 
+ * @public
+ * 
+ * @param timing The collector to free
+*/
+void timing_free(timing_t* timing) {
+    if (timing == NULL) return;
+
+    timing_shard_t* shard = timing->shards;
+    while (shard != NULL) {
+        timing_shard_t* next = shard->next;
+        size_t i = 0;
+
+        for (; i < shard->used; i++) free(shard->series[i]);
+        free(shard);
+        shard = next;
+    }
+
+    free(timing);
+}
+
+/**
+ * @brief Get the monotonic time in nanoseconds, for measuring phases.
+ * 
+ * @public
+ * 
+ * @return uint64_t The current monotonic time
+*/
+uint64_t timing_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Get the name of a phase, as used in the dumps.
+ * 
+ * @public
+ * 
+ * @param phase The phase
+ * @return const char* The phase name, or NULL if phase is out of range
+*/
+const char* timing_phase_name(timing_phase_t phase) {
+    if ((int)phase < 0 || phase >= TIMING_PHASES) return NULL;
+
+    return phase_names[phase];
+}
+
+/**
+ * @brief Get the calling thread's histograms of a wiki and action.
+ * 
+ * @note The series belongs to the calling thread and must only be recorded
+ * into from it. Once TIMING_MAX_SERIES pairs are in use, new pairs get NULL
+ * and their values are counted as dropped.
+ * 
+ * @public
+ * 
+ * @param timing The collector
+ * @param wiki The wiki, such as https://community.fandom.com
+ * @param wiki_len The length of wiki
+ * @param action The API action, such as query
+ * @param action_len The length of action
+ * @return timing_series_t* The series, or NULL if there is no room or an error occurred
+*/
+timing_series_t* timing_series(timing_t* timing, const char* wiki, size_t wiki_len, const char* action, size_t action_len) {
+    if (timing == NULL || wiki == NULL || action == NULL) return NULL;
+
+    timing_shard_t* shard = shard_get(timing);
+    if (shard == NULL) return NULL;
+
+    if (wiki_len >= TIMING_WIKI_MAX) wiki_len = TIMING_WIKI_MAX - 1;
+    if (action_len >= TIMING_ACTION_MAX) action_len = TIMING_ACTION_MAX - 1;
+
+    uint64_t hash = astring_hashraw(wiki, wiki_len) * 31 + astring_hashraw(action, action_len);
+    size_t i = 0;
+
+    for (; i < shard->used; i++) {
+        timing_series_t* series = shard->series[i];
+
+        if (series->hash == hash && strncmp(series->wiki, wiki, wiki_len) == 0 && series->wiki[wiki_len] == '\0'
+            && strncmp(series->action, action, action_len) == 0 && series->action[action_len] == '\0') {
+            return series;
+        }
+    }
+
+    timing_series_t* series = (shard->used < TIMING_MAX_SERIES) ? calloc(1, sizeof(timing_series_t)) : NULL;
+    if (series == NULL) {
+        counter_add(&shard->dropped, 1);
+        return NULL;
+    }
+
+    series->hash = hash;
+    copy_name(series->wiki, sizeof(series->wiki), wiki, wiki_len);
+    copy_name(series->action, sizeof(series->action), action, action_len);
+
+    // readers only look at series below used, so fill the slot before publishing it
+    shard->series[shard->used] = series;
+    __atomic_store_n(&shard->used, shard->used + 1, __ATOMIC_RELEASE);
+
+    return series;
+}
+
+/**
+ * @brief Record a phase duration into a series.
+ * 
+ * @public
+ * 
+ * @param series The calling thread's series, or NULL to do nothing
+ * @param phase The phase measured
+ * @param ns The duration in nanoseconds
+*/
+void timing_add(timing_series_t* series, timing_phase_t phase, uint64_t ns) {
+    if (series == NULL || (int)phase < 0 || phase >= TIMING_PHASES) return;
+
+    timing_hist_t* hist = &series->phases[phase];
+
+    counter_add(&hist->counts[bucket_of(ns)], 1);
+    counter_add(&hist->sum, ns);
+    if (ns > hist->max) __atomic_store_n(&hist->max, ns, __ATOMIC_RELAXED);
+
+    // the count goes last, so a reader never sees more values than buckets filled
+    __atomic_store_n(&hist->count, hist->count + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Record a phase duration for a wiki and action.
+ * 
+ * @note Looks the series up on every call, use timing_series and timing_add
+ * to record several phases of one request.
+ * 
+ * @public
+ * 
+ * @param timing The collector, or NULL to do nothing
+ * @param wiki The wiki, such as https://community.fandom.com
+ * @param action The API action, such as query
+ * @param phase The phase measured
+ * @param ns The duration in nanoseconds
+*/
+void timing_record(timing_t* timing, const char* wiki, const char* action, timing_phase_t phase, uint64_t ns) {
+    if (timing == NULL || wiki == NULL || action == NULL) return;
+
+    timing_add(timing_series(timing, wiki, strlen(wiki), action, strlen(action)), phase, ns);
+}
+
+/**
+ * @brief Estimate a quantile of a histogram.
+ * 
+ * @public
+ * 
+ * @param hist The histogram
+ * @param quantile The quantile, from 0 to 1
+ * @return uint64_t The largest value of the bucket the quantile falls in, at most the largest value recorded
+*/
+uint64_t timing_percentile(const timing_hist_t* hist, double quantile) {
+    if (hist == NULL || hist->count == 0) return 0;
+    if (quantile < 0) quantile = 0;
+    if (quantile > 1) quantile = 1;
+
+    uint64_t rank = (uint64_t)(quantile * (double)hist->count + 0.5);
+    uint64_t seen = 0;
+    size_t i = 0;
+
+    if (rank == 0) rank = 1;
+
+    for (; i < TIMING_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= rank) break;
+    }
+
+    uint64_t value = bucket_max((i < TIMING_BUCKETS) ? i : TIMING_BUCKETS - 1);
+    return (value < hist->max) ? value : hist->max;
+}
+
+/**
+ * @brief Merge one histogram being written by another thread into another.
+ * 
+ * @internal
+*/
+static void hist_merge(timing_hist_t* dest, const timing_hist_t* src) {
+    uint64_t count = __atomic_load_n(&src->count, __ATOMIC_ACQUIRE);
+    if (count == 0) return;
+
+    size_t i = 0;
+    for (; i < TIMING_BUCKETS; i++) dest->counts[i] += __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    dest->count += count;
+    dest->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+    if (max > dest->max) dest->max = max;
+}
+
+/**
+ * @brief Merge every thread's series into one series per wiki and action.
+ * 
+ * @internal
+ * 
+ * @param count Set to the number of merged series
+ * @param dropped Set to the number of values dropped for want of a series slot
+ * @return timing_series_t* The merged series, to be freed by the caller, or NULL if there are none or an error occurred
+*/
+static timing_series_t* merge(timing_t* timing, size_t* count, uint64_t* dropped) {
+    timing_series_t* merged = NULL;
+    size_t cap = 0;
+
+    *count = 0;
+    *dropped = 0;
+
+    timing_shard_t* shard = __atomic_load_n(&timing->shards, __ATOMIC_ACQUIRE);
+    for (; shard != NULL; shard = shard->next) {
+        size_t used = __atomic_load_n(&shard->used, __ATOMIC_ACQUIRE);
+        size_t i = 0;
+
+        *dropped += __atomic_load_n(&shard->dropped, __ATOMIC_RELAXED);
+
+        for (; i < used; i++) {
+            const timing_series_t* src = shard->series[i];
+            size_t j = 0;
+
+            while (j < *count && (merged[j].hash != src->hash || strcmp(merged[j].wiki, src->wiki) != 0 || strcmp(merged[j].action, src->action) != 0)) j++;
+
+            if (j == *count) {
+                if (*count == cap) {
+                    cap = (cap == 0) ? 8 : cap * 2;
+                    timing_series_t* grown = realloc(merged, sizeof(timing_series_t) * cap);
+                    if (grown == NULL) {
+                        free(merged);
+                        *count = 0;
+                        return NULL;
+                    }
+
+                    merged = grown;
+                }
+
+                memset(&merged[j], 0, sizeof(timing_series_t));
+                merged[j].hash = src->hash;
+                memcpy(merged[j].wiki, src->wiki, sizeof(src->wiki));
+                memcpy(merged[j].action, src->action, sizeof(src->action));
+                (*count)++;
+            }
+
+            timing_phase_t phase = TIMING_BUILD;
+            for (; phase < TIMING_PHASES; phase++) hist_merge(&merged[j].phases[phase], &src->phases[phase]);
+        }
+    }
+
+    return merged;
+}
+
+/**
+ * @brief Append a name as the body of a JSON string or Prometheus label value.
+ * 
+ * @internal
+*/
+static astring_t* append_escaped(astring_t* dest, const char* name) {
+    for (; dest != NULL && *name != '\0'; name++) {
+        if (*name == '"' || *name == '\\') dest = astring_appendn(dest, "\\", 1);
+        if (dest != NULL) dest = astring_appendn(dest, name, 1);
+    }
+
+    return dest;
+}
+
+/**
+ * @brief Dump every wiki and action's phase summaries as JSON.
+ * 
+ * @note Durations are in microseconds. Phases with nothing recorded are left
+ * out. Values keep accumulating, so consecutive dumps are cumulative.
+ * 
+ * @public
+ * 
+ * @param timing The collector
+ * @return astring_t* The JSON document, or NULL if an error occurred
+*/
+astring_t* timing_json(timing_t* timing) {
+    if (timing == NULL) return NULL;
+
+    size_t count;
+    uint64_t dropped;
+    timing_series_t* merged = merge(timing, &count, &dropped);
+    astring_t* out = astring_new(256 + count * 1024);
+    char buf[256];
+    size_t i = 0;
+
+    out = astring_append(out, "{\"series\":[");
+    for (; out != NULL && i < count; i++) {
+        out = astring_append(out, (i > 0) ? ",{\"wiki\":\"" : "{\"wiki\":\"");
+        out = append_escaped(out, merged[i].wiki);
+        out = astring_append(out, "\",\"action\":\"");
+        out = append_escaped(out, merged[i].action);
+        out = astring_append(out, "\",\"phases\":{");
+
+        bool first = true;
+        timing_phase_t phase = TIMING_BUILD;
+        for (; out != NULL && phase < TIMING_PHASES; phase++) {
+            const timing_hist_t* hist = &merged[i].phases[phase];
+            if (hist->count == 0) continue;
+
+            snprintf(buf, sizeof(buf), "%s\"%s\":{\"count\":%llu,\"mean_us\":%.1f,\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f}",
+                first ? "" : ",", phase_names[phase], (unsigned long long)hist->count, (double)hist->sum / (double)hist->count / 1e3,
+                (double)timing_percentile(hist, 0.5) / 1e3, (double)timing_percentile(hist, 0.9) / 1e3, (double)timing_percentile(hist, 0.99) / 1e3,
+                (double)timing_percentile(hist, 0.999) / 1e3, (double)hist->max / 1e3);
+            out = astring_append(out, buf);
+            first = false;
+        }
+
+        out = astring_append(out, "}}");
+    }
+
+    snprintf(buf, sizeof(buf), "],\"dropped\":%llu}\n", (unsigned long long)dropped);
+    out = astring_append(out, buf);
+
+    free(merged);
+    return out;
+}
+
+/**
+ * @brief Dump every wiki and action's phase summaries in the Prometheus text format.
+ * 
+ * @note Every phase is a summary series of curlybot_request_phase_seconds
+ * with wiki, action and phase labels, suitable for the node exporter's
+ * textfile collector. Values keep accumulating, as Prometheus expects.
+ * 
+ * @public
+ * 
+ * @param timing The collector
+ * @return astring_t* The exposition text, or NULL if an error occurred
+*/
+astring_t* timing_prometheus(timing_t* timing) {
+    if (timing == NULL) return NULL;
+
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    size_t count;
+    uint64_t dropped;
+    timing_series_t* merged = merge(timing, &count, &dropped);
+    astring_t* out = astring_new(256 + count * 4096);
+    char buf[128];
+    size_t i = 0;
+
+    out = astring_append(out,
+        "# HELP curlybot_request_phase_seconds Time spent in each phase of an API request.\n"
+        "# TYPE curlybot_request_phase_seconds summary\n");
+
+    for (; out != NULL && i < count; i++) {
+        timing_phase_t phase = TIMING_BUILD;
+        for (; out != NULL && phase < TIMING_PHASES; phase++) {
+            const timing_hist_t* hist = &merged[i].phases[phase];
+            if (hist->count == 0) continue;
+
+            // the labels are the same for every line of the series, bar quantile
+            astring_t* labels = astring_from("{wiki=\"");
+            labels = append_escaped(labels, merged[i].wiki);
+            labels = astring_append(labels, "\",action=\"");
+            labels = append_escaped(labels, merged[i].action);
+            labels = astring_append(labels, "\",phase=\"");
+            labels = astring_append(labels, phase_names[phase]);
+            labels = astring_append(labels, "\"");
+            if (labels == NULL) {
+                astring_free(out);
+                out = NULL;
+                break;
+            }
+
+            size_t q = 0;
+            for (; out != NULL && q < sizeof(quantiles) / sizeof(quantiles[0]); q++) {
+                out = astring_append(out, "curlybot_request_phase_seconds");
+                out = astring_appenda(out, labels);
+                snprintf(buf, sizeof(buf), ",quantile=\"%g\"} %.9f\n", quantiles[q], (double)timing_percentile(hist, quantiles[q]) / 1e9);
+                out = astring_append(out, buf);
+            }
+
+            out = astring_append(out, "curlybot_request_phase_seconds_sum");
+            out = astring_appenda(out, labels);
+            snprintf(buf, sizeof(buf), "} %.9f\n", (double)hist->sum / 1e9);
+            out = astring_append(out, buf);
+
+            out = astring_append(out, "curlybot_request_phase_seconds_count");
+            out = astring_appenda(out, labels);
+            snprintf(buf, sizeof(buf), "} %llu\n", (unsigned long long)hist->count);
+            out = astring_append(out, buf);
+
+            astring_free(labels);
+        }
+    }
+
+    out = astring_append(out,
+        "# HELP curlybot_timing_dropped_total Timings dropped because a thread had no series slot left.\n"
+        "# TYPE curlybot_timing_dropped_total counter\n");
+    snprintf(buf, sizeof(buf), "curlybot_timing_dropped_total %llu\n", (unsigned long long)dropped);
+    out = astring_append(out, buf);
+
+    free(merged);
+    return out;
+}
@@ -1,27 +1,492 @@
-#include <curl/curl.h>
+#include <stdint.h>
 
 #include "astring.h"
+#include "simd.h"
+#include "urlencode.h"
 
+/*
+ * RFC 3986 percent-encoding. Only the unreserved set (ALPHA / DIGIT / "-" /
+ * "." / "_" / "~") is passed through, every other byte becomes "%XX" with
+ * upper-case hex digits. This matches the output of curl_easy_escape.
+ */
+
+static const char hex_digits[16] = "0123456789ABCDEF";
+
+static const unsigned char unreserved[256] = {
+    ['-'] = 1, ['.'] = 1, ['_'] = 1, ['~'] = 1,
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1,
+    ['5'] = 1, ['6'] = 1, ['7'] = 1, ['8'] = 1, ['9'] = 1,
+    ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1,
+    ['G'] = 1, ['H'] = 1, ['I'] = 1, ['J'] = 1, ['K'] = 1, ['L'] = 1,
+    ['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1, ['Q'] = 1, ['R'] = 1,
+    ['S'] = 1, ['T'] = 1, ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1,
+    ['Y'] = 1, ['Z'] = 1,
+    ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1,
+    ['g'] = 1, ['h'] = 1, ['i'] = 1, ['j'] = 1, ['k'] = 1, ['l'] = 1,
+    ['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1, ['q'] = 1, ['r'] = 1,
+    ['s'] = 1, ['t'] = 1, ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1,
+    ['y'] = 1, ['z'] = 1,
+};
+
+/**
+ * @brief Encodes a run of bytes with the lookup table.
+ *
+ * @internal
+ *
+ * @param dest The buffer to write to
+ * @param src The bytes to encode
+ * @param len The number of bytes to encode
+ * @return size_t The number of bytes written
+*/
+static size_t encode_scalar(char* dest, const unsigned char* src, size_t len) {
+    char* out = dest;
+    size_t i = 0;
+
+    for (; i < len; i++) {
+        unsigned char c = src[i];
+
+        if (unreserved[c]) {
+            *out++ = (char)c;
+        } else {
+            out[0] = '%';
+            out[1] = hex_digits[c >> 4];
+            out[2] = hex_digits[c & 0x0F];
+            out += 3;
+        }
+    }
+
+    return (size_t)(out - dest);
+}
+
+/**
+ * @brief Counts the bytes that need escaping with the lookup table.
+ *
+ * @internal
+*/
+static size_t count_scalar(const unsigned char* src, size_t len) {
+    size_t reserved = 0;
+    size_t i = 0;
+
+    for (; i < len; i++) reserved += !unreserved[src[i]];
+
+    return reserved;
+}
+
+#if defined(CURLYBOT_SSE2)
+
+/**
+ * @brief Computes a bitmask of the unreserved bytes in a 16 byte block.
+ *
+ * @internal
+*/
+static inline uint32_t unreserved_mask_sse2(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+    __m128i mark = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')), _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~'))));
+
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), mark));
+}
+
+/**
+ * @brief Encodes bytes 16 at a time, copying unreserved runs in bulk.
+ *
+ * @internal
+*/
+static size_t encode_sse2(char* dest, const unsigned char* src, size_t len) {
+    char* out = dest;
+    size_t i = 0;
+
+    while (i + 16 <= len) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        uint32_t reserved = ~unreserved_mask_sse2(v) & 0xFFFFu;
+
+        // the remaining output is at least as long as the remaining input,
+        // so a full 16 byte store never runs past the end of dest
+        _mm_storeu_si128((__m128i*)out, v);
+
+        if (reserved == 0) {
+            out += 16;
+            i += 16;
+            continue;
+        }
+
+        unsigned run = simd_ctz(reserved);
+        out += run;
+        out += encode_scalar(out, src + i + run, 16 - run);
+        i += 16;
+    }
+
+    out += encode_scalar(out, src + i, len - i);
+
+    return (size_t)(out - dest);
+}
+
+/**
+ * @brief Counts the bytes that need escaping 16 at a time.
+ *
+ * @internal
+*/
+static size_t count_sse2(const unsigned char* src, size_t len) {
+    size_t reserved = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        reserved += 16 - simd_popcount(unreserved_mask_sse2(v));
+    }
+
+    return reserved + count_scalar(src + i, len - i);
+}
+
+/**
+ * @brief Finds the next byte that needs decoding 16 bytes at a time.
+ *
+ * @internal
+*/
+static size_t special_sse2(const char* src, size_t len, bool plus) {
+    const __m128i pct = _mm_set1_epi8('%');
+    const __m128i sp = _mm_set1_epi8(plus ? '+' : '%');
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, pct), _mm_cmpeq_epi8(v, sp)));
+
+        if (mask != 0) return i + simd_ctz(mask);
+    }
+
+    for (; i < len; i++) {
+        if (src[i] == '%' || (plus && src[i] == '+')) return i;
+    }
+
+    return len;
+}
+
+#endif /* CURLYBOT_SSE2 */
+
+#if defined(CURLYBOT_AVX2)
+
+/**
+ * @brief Computes a bitmask of the unreserved bytes in a 32 byte block.
+ *
+ * @internal
+*/
+SIMD_TARGET_AVX2
+static inline uint32_t unreserved_mask_avx2(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+    __m256i mark = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('~'))));
+
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(alpha, digit), mark));
+}
+
+/**
+ * @brief Encodes bytes 32 at a time, copying unreserved runs in bulk.
+ *
+ * @internal
+*/
+SIMD_TARGET_AVX2
+static size_t encode_avx2(char* dest, const unsigned char* src, size_t len) {
+    char* out = dest;
+    size_t i = 0;
+
+    while (i + 32 <= len) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        uint32_t reserved = ~unreserved_mask_avx2(v);
+
+        _mm256_storeu_si256((__m256i*)out, v);
+
+        if (reserved == 0) {
+            out += 32;
+            i += 32;
+            continue;
+        }
+
+        unsigned run = simd_ctz(reserved);
+        out += run;
+        out += encode_scalar(out, src + i + run, 32 - run);
+        i += 32;
+    }
+
+    out += encode_sse2(out, src + i, len - i);
+
+    return (size_t)(out - dest);
+}
+
+/**
+ * @brief Counts the bytes that need escaping 32 at a time.
+ *
+ * @internal
+*/
+SIMD_TARGET_AVX2
+static size_t count_avx2(const unsigned char* src, size_t len) {
+    size_t reserved = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        reserved += 32 - simd_popcount(unreserved_mask_avx2(v));
+    }
+
+    return reserved + count_sse2(src + i, len - i);
+}
+
+/**
+ * @brief Finds the next byte that needs decoding 32 bytes at a time.
+ *
+ * @internal
+*/
+SIMD_TARGET_AVX2
+static size_t special_avx2(const char* src, size_t len, bool plus) {
+    const __m256i pct = _mm256_set1_epi8('%');
+    const __m256i sp = _mm256_set1_epi8(plus ? '+' : '%');
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, pct), _mm256_cmpeq_epi8(v, sp)));
+
+        if (mask != 0) return i + simd_ctz(mask);
+    }
+
+    return i + special_sse2(src + i, len - i, plus);
+}
+
+#endif /* CURLYBOT_AVX2 */
+
+/**
+ * @brief Finds the next byte that needs decoding.
+ *
+ * @internal
+ *
+ * @param src The bytes to scan
+ * @param len The number of bytes to scan
+ * @param plus Whether '+' needs decoding
+ * @return size_t The offset of the next '%' (or '+'), or len if there is none
+*/
+static size_t find_special(const char* src, size_t len, bool plus) {
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) return special_avx2(src, len, plus);
+    return special_sse2(src, len, plus);
+#elif defined(CURLYBOT_SSE2)
+    return special_sse2(src, len, plus);
+#else
+    size_t i = 0;
+    for (; i < len; i++) {
+        if (src[i] == '%' || (plus && src[i] == '+')) return i;
+    }
+
+    return len;
+#endif
+}
+
+/**
+ * @brief Get the value of a hex digit.
+ *
+ * @internal
+ *
+ * @return int The value of the digit, or -1 if c is not a hex digit
+*/
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+
+    return -1;
+}
+
+/**
+ * @brief Get the exact length of the urlencoded form of a string.
+ *
+ * @public
+ *
+ * @param src The bytes to encode
+ * @param len The number of bytes to encode
+ * @return size_t The length of the encoded string, excluding the null terminator
+*/
+size_t urlencode_len(const char* src, size_t len) {
+    if (src == NULL) return 0;
+
+    const unsigned char* s = (const unsigned char*)src;
+    size_t reserved;
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) reserved = count_avx2(s, len);
+    else reserved = count_sse2(s, len);
+#elif defined(CURLYBOT_SSE2)
+    reserved = count_sse2(s, len);
+#else
+    reserved = count_scalar(s, len);
+#endif
+
+    return len + (reserved * 2);
+}
+
+/**
+ * @brief Urlencode a string into a raw buffer.
+ *
+ * @note dest must have room for at least urlencode_len(src, len) bytes. No
+ * null terminator is written.
+ *
+ * @public
+ *
+ * @param dest The buffer to write the encoded string to
+ * @param src The bytes to encode
+ * @param len The number of bytes to encode
+ * @return size_t The number of bytes written to dest
+*/
+size_t urlencode_raw(char* dest, const char* src, size_t len) {
+    if (dest == NULL || src == NULL) return 0;
+
+    const unsigned char* s = (const unsigned char*)src;
+
+#if defined(CURLYBOT_AVX2)
+    if (simd_has_avx2()) return encode_avx2(dest, s, len);
+    return encode_sse2(dest, s, len);
+#elif defined(CURLYBOT_SSE2)
+    return encode_sse2(dest, s, len);
+#else
+    return encode_scalar(dest, s, len);
+#endif
+}
+
+/**
+ * @brief Urlencode a string onto the end of an astring.
+ *
+ * @public
+ *
+ * @param dest The astring to append the encoded string to
+ * @param src The bytes to encode
+ * @param len The number of bytes to encode
+ * @return astring_t* The updated astring or NULL if an error occurred
+*/
+astring_t* urlencode_append(astring_t* dest, const char* src, size_t len) {
+    if (dest == NULL || src == NULL) return NULL;
+
+    size_t encoded_len = urlencode_len(src, len);
+    size_t needed = dest->len + encoded_len + 1;
+
+    if (astring_reserve(dest, needed) == NULL) return NULL;
+
+    dest->len += urlencode_raw(dest->raw + dest->len, src, len);
+    dest->raw[dest->len] = '\0';
+
+    return dest;
+}
+
+/**
+ * @brief Urlencode an astring into another astring, replacing its contents.
+ *
+ * @public
+ *
+ * @param dest The astring to write the encoded string to
+ * @param str The astring to encode
+ * @return astring_t* The updated astring or NULL if an error occurred
+*/
+astring_t* urlencode_into(astring_t* dest, const astring_t* str) {
+    if (dest == NULL || str == NULL) return NULL;
+
+    dest->len = 0;
+    return urlencode_append(dest, str->raw, str->len);
+}
 
 /**
  * @brief Creates a new urlencoded astring.
- * 
+ *
  * @public
- * 
+ *
  * @param str The string to url encode
  * @return astring_t* The new urlencoded astring
 */
-astring_t* urlencode(CURL* curl, astring_t* str) {
-    if (curl == NULL) return NULL;
+astring_t* urlencode(const astring_t* str) {
+    if (str == NULL || str->raw == NULL) return NULL;
 
-    char* encoded;
-    astring_t* ret;
-    
-    encoded = curl_easy_escape(curl, str->raw, str->len);
-    if (encoded == NULL) return NULL;
+    size_t encoded_len = urlencode_len(str->raw, str->len);
+    astring_t* ret = astring_new(encoded_len + 1);
+    if (ret == NULL) return NULL;
 
-    ret = astring_from(encoded);
-    curl_free(encoded);
+    ret->len = urlencode_raw(ret->raw, str->raw, str->len);
+    ret->raw[ret->len] = '\0';
 
     return ret;
 }
+
+/**
+ * @brief Urldecode a string into a raw buffer.
+ *
+ * @note dest may be the same buffer as src to decode in place, the output is
+ * never longer than the input. Malformed escapes are copied through unchanged.
+ * No null terminator is written.
+ *
+ * @public
+ *
+ * @param dest The buffer to write the decoded string to
+ * @param src The bytes to decode
+ * @param len The number of bytes to decode
+ * @param plus Whether '+' decodes to a space, as in form-encoded query strings
+ * @return size_t The number of bytes written to dest
+*/
+size_t urldecode_raw(char* dest, const char* src, size_t len, bool plus) {
+    if (dest == NULL || src == NULL) return 0;
+
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < len) {
+        size_t run = find_special(src + in, len - in, plus);
+
+        // plain runs stay where they are until the first escape shifts them
+        if (dest + out != src + in) memmove(dest + out, src + in, run);
+        in += run;
+        out += run;
+
+        if (in >= len) break;
+
+        if (src[in] == '+') {
+            dest[out++] = ' ';
+            in++;
+            continue;
+        }
+
+        int hi = (in + 2 < len) ? hex_value(src[in + 1]) : -1;
+        int lo = (hi >= 0) ? hex_value(src[in + 2]) : -1;
+        if (hi >= 0 && lo >= 0) {
+            dest[out++] = (char)((hi << 4) | lo);
+            in += 3;
+        } else {
+            dest[out++] = src[in++];
+        }
+    }
+
+    return out;
+}
+
+/**
+ * @brief Creates a new urldecoded astring.
+ *
+ * @public
+ *
+ * @param str The string to url decode
+ * @return astring_t* The new urldecoded astring
+*/
+astring_t* urldecode(const astring_t* str) {
+    if (str == NULL || str->raw == NULL) return NULL;
+
+    astring_t* ret = astring_new(str->len + 1);
+    if (ret == NULL) return NULL;
+
+    ret->len = urldecode_raw(ret->raw, str->raw, str->len, true);
+    ret->raw[ret->len] = '\0';
+
+    return ret;
+}
\ No newline at end of file
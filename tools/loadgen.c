@@ -0,0 +1,350 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "engine.h"
+#include "json.h"
+#include "querystring.h"
+#include "scheduler.h"
+#include "timing.h"
+
+/*
+ * Drives the request and parse pipeline against an API endpoint, normally a
+ * local curlybot_mockwiki, at a fixed rate. Requests are sent open loop on a
+ * schedule and latency is measured from the scheduled send time, so a slow
+ * server cannot hide queueing delay by slowing the generator down.
+ */
+
+#define LOAD_DEFAULT_URL "http://127.0.0.1:8080/api.php"
+#define LOAD_DEFAULT_QPS 200.0
+#define LOAD_DEFAULT_SECONDS 10.0
+#define LOAD_DEFAULT_HANDLES 64
+
+/** How long to wait for stragglers once the sending window closes, in nanoseconds. */
+#define LOAD_DRAIN_NS 30000000000LL
+
+/** How often --timing-out is rewritten, in seconds. */
+#define LOAD_DEFAULT_TIMING_EVERY 10.0
+
+typedef struct {
+    size_t index;
+    int64_t scheduled;          /**< When the request was due to be sent. */
+} load_request_t;
+
+typedef struct {
+    int64_t* latencies;         /**< The latency of every response, in nanoseconds. */
+    size_t measured;            /**< The number of latencies, one per response. */
+    size_t completed;           /**< Requests finished, with a response or a failure. */
+    size_t failed;              /**< Transfers that did not get a response. */
+    size_t http_errors;         /**< Responses with a status other than 200. */
+    size_t api_errors;          /**< Responses carrying an API error, such as maxlag. */
+    size_t pages;               /**< Page contents found by the parser. */
+    size_t bytes;               /**< The decoded response bytes. */
+    size_t wire_bytes;          /**< The response bytes on the wire. */
+    json_parser_t* parser;
+    bool api_error;             /**< Whether the response being parsed carries an error code. */
+} load_stats_t;
+
+static load_stats_t stats;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void on_content(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    if (ev->more == false) stats.pages++;
+}
+
+static void on_error_code(json_parser_t* parser, const json_event_t* ev, void* userdata) {
+    stats.api_error = true;
+}
+
+static void on_response(engine_request_t* req, void* userdata) {
+    load_request_t* load = userdata;
+
+    if (req->result != CURLE_OK) {
+        stats.failed++;
+    } else {
+        if (req->status != 200) stats.http_errors++;
+
+        // parsing is part of the measured pipeline
+        stats.api_error = false;
+        json_reset(stats.parser);
+        json_feed(stats.parser, req->body->raw, req->body->len);
+        json_finish(stats.parser);
+
+        if (stats.api_error) stats.api_errors++;
+        stats.bytes += (size_t)req->decoded_bytes;
+        stats.wire_bytes += (size_t)req->wire_bytes;
+
+        // failures have no latency to speak of and would only pull the percentiles down
+        stats.latencies[stats.measured++] = now_ns() - load->scheduled;
+    }
+
+    stats.completed++;
+    free(load);
+}
+
+/**
+ * Writes the phase timings to path, or stdout without one. The file is
+ * replaced through a rename, so a scraper such as the node exporter's
+ * textfile collector never reads it half written.
+ */
+static bool dump_timing(timing_t* timing, bool prometheus, const char* path) {
+    astring_t* text = prometheus ? timing_prometheus(timing) : timing_json(timing);
+    if (text == NULL) return false;
+
+    if (path == NULL) {
+        fputs(text->raw, stdout);
+        astring_free(text);
+        return true;
+    }
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE* file = fopen(tmp, "w");
+    bool ok = file != NULL && fwrite(text->raw, 1, text->len, file) == text->len;
+    if (file != NULL && fclose(file) != 0) ok = false;
+    if (ok && rename(tmp, path) != 0) ok = false;
+
+    if (ok == false) fprintf(stderr, "cannot write %s\n", path);
+    astring_free(text);
+    return ok;
+}
+
+static void print_alloc_stats(size_t completed) {
+    alloc_category_t category = ALLOC_ASTRING_BUFFER;
+    double requests = (completed > 0) ? (double)completed : 1;
+
+    printf("%-16s %12s %10s %12s %12s %12s\n", "allocations", "calls", "per req", "bytes", "live", "peak");
+    for (; category < ALLOC_CATEGORIES; category++) {
+        alloc_stats_t st;
+        alloc_getstats(category, &st);
+
+        uint64_t calls = st.allocs + st.reallocs;
+        printf("%-16s %12llu %10.1f %12llu %12llu %12llu\n", alloc_category_name(category), (unsigned long long)calls,
+            (double)calls / requests, (unsigned long long)st.bytes, (unsigned long long)st.live, (unsigned long long)st.peak);
+    }
+}
+
+static querystring_t* make_query(size_t index, size_t titles) {
+    querystring_t* qs = querystring_new();
+    astring_t* value = astring_new(16 * titles + 1);
+    char title[32];
+    size_t i = 0;
+
+    for (; i < titles; i++) {
+        snprintf(title, sizeof(title), "%sPage_%zu", (i > 0) ? "|" : "", index * titles + i);
+        astring_append(value, title);
+    }
+
+    qs = querystring_addk(qs, APIKEY_ACTION, "query");
+    qs = querystring_addk(qs, APIKEY_PROP, "revisions");
+    qs = querystring_addk(qs, APIKEY_RVPROP, "content");
+    qs = querystring_addk(qs, APIKEY_RVSLOTS, "main");
+    qs = querystring_addk(qs, APIKEY_TITLES, value->raw);
+    qs = querystring_addk(qs, APIKEY_FORMAT, "json");
+    qs = querystring_addk(qs, APIKEY_FORMATVERSION, "2");
+
+    astring_free(value);
+    return qs;
+}
+
+static int compare_latency(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(double p) {
+    if (stats.measured == 0) return 0;
+
+    size_t rank = (size_t)(p / 100.0 * (double)(stats.measured - 1) + 0.5);
+    return (double)stats.latencies[rank] / 1e6;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --url URL         the API endpoint, default %s\n"
+        "  --qps N           the requests sent per second, default %.0f\n"
+        "  --duration S      how long to send for, default %.0f\n"
+        "  --handles N       the most requests in flight, default %d\n"
+        "  --titles N        the titles per request, default 1\n"
+        "  --scheduler       go through the maxlag-aware scheduler, with maxlag and its rate limits\n"
+        "  --timing FORMAT   dump per-phase request timings as json or prometheus\n"
+        "  --timing-out FILE write the timings to FILE instead of stdout, refreshed while running\n"
+        "  --timing-every S  how often FILE is refreshed, default %.0f\n"
+        "  --alloc-stats     count astring and querystring allocations per category\n",
+        argv0, LOAD_DEFAULT_URL, LOAD_DEFAULT_QPS, LOAD_DEFAULT_SECONDS, LOAD_DEFAULT_HANDLES, LOAD_DEFAULT_TIMING_EVERY);
+}
+
+int main(int argc, char** argv) {
+    const char* url = LOAD_DEFAULT_URL;
+    double qps = LOAD_DEFAULT_QPS;
+    double seconds = LOAD_DEFAULT_SECONDS;
+    size_t handles = LOAD_DEFAULT_HANDLES;
+    size_t titles = 1;
+    bool use_scheduler = false;
+    bool alloc_stats = false;
+    const char* timing_format = NULL;
+    const char* timing_out = NULL;
+    double timing_every = LOAD_DEFAULT_TIMING_EVERY;
+
+    int arg = 1;
+    for (; arg < argc; arg++) {
+        const char* next = (arg + 1 < argc) ? argv[arg + 1] : NULL;
+
+        if (strcmp(argv[arg], "--scheduler") == 0) {
+            use_scheduler = true;
+            continue;
+        }
+
+        if (strcmp(argv[arg], "--alloc-stats") == 0) {
+            alloc_stats = true;
+            continue;
+        }
+
+        if (strcmp(argv[arg], "--url") == 0 && next != NULL) url = next;
+        else if (strcmp(argv[arg], "--qps") == 0 && next != NULL) qps = atof(next);
+        else if (strcmp(argv[arg], "--duration") == 0 && next != NULL) seconds = atof(next);
+        else if (strcmp(argv[arg], "--handles") == 0 && next != NULL) handles = strtoul(next, NULL, 10);
+        else if (strcmp(argv[arg], "--titles") == 0 && next != NULL) titles = strtoul(next, NULL, 10);
+        else if (strcmp(argv[arg], "--timing") == 0 && next != NULL) timing_format = next;
+        else if (strcmp(argv[arg], "--timing-out") == 0 && next != NULL) timing_out = next;
+        else if (strcmp(argv[arg], "--timing-every") == 0 && next != NULL) timing_every = atof(next);
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+
+        arg++;
+    }
+
+    bool prometheus = timing_format != NULL && strcmp(timing_format, "prometheus") == 0;
+    if (timing_out != NULL && timing_format == NULL) timing_format = "json";
+
+    if (qps <= 0 || seconds <= 0 || handles == 0 || titles == 0 || timing_every <= 0
+        || (timing_format != NULL && prometheus == false && strcmp(timing_format, "json") != 0)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // counting goes on before anything is allocated, so every block is counted both ways
+    alloc_setcounting(alloc_stats);
+
+    size_t total = (size_t)(qps * seconds);
+    engine_t* engine = engine_new(handles);
+    scheduler_t* scheduler = use_scheduler ? scheduler_new(engine) : NULL;
+    timing_t* timing = (timing_format != NULL) ? timing_new() : NULL;
+
+    stats.latencies = malloc(sizeof(int64_t) * (total + 1));
+    stats.parser = json_new();
+    if (engine == NULL || stats.latencies == NULL || stats.parser == NULL || (use_scheduler && scheduler == NULL) || (timing_format != NULL && timing == NULL)) {
+        fprintf(stderr, "cannot set up the engine\n");
+        return 1;
+    }
+
+    json_subscribe(stats.parser, "query.pages[].revisions[].slots.main.content", on_content, NULL);
+    json_subscribe(stats.parser, "error.code", on_error_code, NULL);
+
+    engine_settiming(engine, timing);
+
+    // the scheduler's own pacing would cap the offered load, so it only gets the concurrency limit
+    if (scheduler != NULL) scheduler_sethost(scheduler, url, qps * 2, qps, handles);
+
+    int64_t start = now_ns();
+    int64_t interval = (int64_t)(1e9 / qps);
+    size_t sent = 0;
+    int64_t timing_due = start + (int64_t)(timing_every * 1e9);
+
+    while (stats.completed < sent || sent < total) {
+        int64_t now = now_ns();
+
+        while (sent < total && start + (int64_t)sent * interval <= now) {
+            load_request_t* load = malloc(sizeof(load_request_t));
+            querystring_t* qs = make_query(sent, titles);
+
+            load->index = sent;
+            load->scheduled = start + (int64_t)sent * interval;
+
+            void* req = (scheduler != NULL) ? (void*)scheduler_submit(scheduler, url, qs, on_response, load) : (void*)engine_submit(engine, url, qs, on_response, load);
+            querystring_free(qs, true);
+
+            if (req == NULL) {
+                stats.failed++;
+                stats.completed++;
+                free(load);
+            }
+
+            sent++;
+        }
+
+        if (now - start > (int64_t)(seconds * 1e9) + LOAD_DRAIN_NS) break;
+
+        if (timing_out != NULL && now >= timing_due) {
+            dump_timing(timing, prometheus, timing_out);
+            timing_due = now + (int64_t)(timing_every * 1e9);
+        }
+
+        int64_t next = (sent < total) ? start + (int64_t)sent * interval : now + 100000000;
+        int timeout = (next <= now) ? 0 : (int)((next - now + 999999) / 1000000);
+
+        if (scheduler != NULL) scheduler_poll(scheduler, timeout);
+        else engine_poll(engine, timeout);
+    }
+
+    double elapsed = (double)(now_ns() - start) / 1e9;
+    qsort(stats.latencies, stats.measured, sizeof(int64_t), compare_latency);
+
+    printf("sent %zu, completed %zu in %.2fs: %.1f req/s\n", sent, stats.completed, elapsed, (double)stats.completed / elapsed);
+    printf("failed %zu, http errors %zu, api errors %zu, pages parsed %zu\n", stats.failed, stats.http_errors, stats.api_errors, stats.pages);
+    printf("received %.1f MB decoded, %.1f MB on the wire\n", (double)stats.bytes / 1e6, (double)stats.wire_bytes / 1e6);
+    if (stats.measured == 0) {
+        printf("latency ms: no responses\n");
+    } else {
+        printf("latency ms: p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+            percentile_ms(50), percentile_ms(90), percentile_ms(99), percentile_ms(99.9), percentile_ms(100));
+    }
+
+    if (alloc_stats) print_alloc_stats(stats.completed);
+    if (timing != NULL) dump_timing(timing, prometheus, timing_out);
+
+    scheduler_free(scheduler);
+    engine_free(engine);
+    timing_free(timing);
+    json_free(stats.parser);
+    free(stats.latencies);
+    return (stats.completed == sent && stats.failed == 0) ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,700 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "astring.h"
+#include "memsearch.h"
+#include "querystring.h"
+
+/*
+ * A stand-in for a MediaWiki api.php, for load tests that must not touch a
+ * real wiki. It answers action=query from fixtures or generated pages, and
+ * can add latency, rate limiting and maxlag errors. One thread serves every
+ * connection through epoll; keep-alive is supported, pipelining is handled
+ * one request at a time.
+ */
+
+#define MOCK_DEFAULT_PORT 8080
+#define MOCK_DEFAULT_PAGE_BYTES 4096
+#define MOCK_DEFAULT_LIST_SIZE 1000
+#define MOCK_DEFAULT_LAG 5
+#define MOCK_MAX_REQUEST (1024 * 1024)
+#define MOCK_EVENTS 256
+
+typedef struct {
+    int port;
+    int64_t latency_ns;         /**< The delay added to every response. */
+    int64_t jitter_ns;          /**< The most random delay added on top of latency. */
+    double rate;                /**< The requests per second served before answering 429, 0 for unlimited. */
+    double maxlag_rate;         /**< The fraction of maxlag requests answered with a maxlag error. */
+    int lag;                    /**< The lag reported in maxlag errors, and their Retry-After, in seconds. */
+    size_t page_bytes;          /**< The size of generated page content. */
+    size_t list_size;           /**< The number of items generated lists hold before they stop continuing. */
+    const char* fixtures;       /**< The directory of recorded responses, or NULL. */
+} mock_config_t;
+
+typedef struct {
+    astring_t* name;            /**< The module the response answers, such as query.allpages. */
+    astring_t* body;
+} mock_fixture_t;
+
+typedef struct {
+    int fd;
+    astring_t* in;              /**< The bytes received and not yet handled. */
+    astring_t* out;             /**< The response being sent. */
+    size_t out_pos;             /**< The bytes of out already sent. */
+    int64_t due;                /**< When the response may be sent, 0 if none is waiting. */
+    bool close_after;           /**< Whether to close once the response is sent. */
+    bool open;
+} mock_conn_t;
+
+typedef struct {
+    size_t requests;
+    size_t throttled;
+    size_t lagged;
+    size_t fixtures;
+    size_t errors;
+} mock_stats_t;
+
+static mock_config_t config;
+static mock_stats_t stats;
+static mock_fixture_t* fixtures = NULL;
+static size_t fixture_count = 0;
+static astring_t* page_content = NULL;
+static mock_conn_t* conns = NULL;
+static size_t conn_cap = 0;
+static double tokens = 0;
+static int64_t refilled = 0;
+static volatile sig_atomic_t stopping = 0;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void on_signal(int sig) {
+    stopping = 1;
+}
+
+/**
+ * @brief Read every *.json file in the fixture directory, named after the module it answers.
+ * 
+ * @internal
+*/
+static bool load_fixtures(const char* dir) {
+    DIR* d = opendir(dir);
+    if (d == NULL) return false;
+
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= 5 || strcmp(entry->d_name + len - 5, ".json") != 0) continue;
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+
+        FILE* f = fopen(path, "rb");
+        if (f == NULL) continue;
+
+        astring_t* body = astring_new(4096);
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) astring_appendn(body, buf, n);
+        fclose(f);
+
+        mock_fixture_t* tmp = realloc(fixtures, sizeof(mock_fixture_t) * (fixture_count + 1));
+        if (tmp == NULL) {
+            astring_free(body);
+            break;
+        }
+
+        fixtures = tmp;
+        fixtures[fixture_count].name = astring_new(len);
+        astring_appendn(fixtures[fixture_count].name, entry->d_name, len - 5);
+        fixtures[fixture_count].body = body;
+        fixture_count++;
+    }
+
+    closedir(d);
+    return true;
+}
+
+static const astring_t* find_fixture(const char* name, size_t len) {
+    size_t i = 0;
+    for (; i < fixture_count; i++) {
+        if (fixtures[i].name->len == len && memcmp(fixtures[i].name->raw, name, len) == 0) return fixtures[i].body;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Generate page content that looks like wikitext and needs no JSON escaping.
+ * 
+ * @internal
+*/
+static astring_t* make_content(size_t bytes) {
+    static const char* pieces[] = {
+        "The ", "character ", "appears in ", "[[Season 2]] ", "and ", "{{Infobox|name=Example}} ",
+        "'''bold''' ", "== History == ", "[[Category:Characters]] ", "episode ",
+    };
+    astring_t* str = astring_new(bytes + 64);
+    size_t i = 0;
+
+    while (str->len < bytes) astring_append(str, pieces[i++ % (sizeof(pieces) / sizeof(pieces[0]))]);
+    return str;
+}
+
+/**
+ * @brief Append a string to a JSON document, escaping quotes and backslashes.
+ * 
+ * @internal
+*/
+static void append_json_string(astring_t* dest, const char* src, size_t len) {
+    astring_append(dest, "\"");
+
+    size_t i = 0;
+    for (; i < len; i++) {
+        if (src[i] == '"' || src[i] == '\\') astring_append(dest, "\\");
+        astring_appendn(dest, &src[i], 1);
+    }
+
+    astring_append(dest, "\"");
+}
+
+/**
+ * @brief Answer prop=revisions for every title in titles.
+ * 
+ * @internal
+*/
+static void answer_pages(astring_t* body, const astring_t* titles) {
+    astring_append(body, "{\"batchcomplete\":true,\"query\":{\"pages\":[");
+
+    const char* title = titles->raw;
+    const char* end = titles->raw + titles->len;
+    size_t index = 0;
+    char number[64];
+
+    while (title < end) {
+        const char* bar = memchr(title, '|', (size_t)(end - title));
+        size_t len = (bar != NULL) ? (size_t)(bar - title) : (size_t)(end - title);
+
+        snprintf(number, sizeof(number), "%s{\"pageid\":%zu,\"ns\":0,\"title\":", (index > 0) ? "," : "", 1000 + index);
+        astring_append(body, number);
+        append_json_string(body, title, len);
+        snprintf(number, sizeof(number), ",\"revisions\":[{\"revid\":%zu,\"slots\":{\"main\":{\"content\":\"", 50000 + index);
+        astring_append(body, number);
+        astring_appenda(body, page_content);
+        astring_append(body, "\"}}}]}");
+
+        title += len + 1;
+        index++;
+    }
+
+    astring_append(body, "]}}");
+}
+
+/**
+ * @brief Answer list=allpages, continuing until list_size items have been listed.
+ * 
+ * @internal
+*/
+static void answer_allpages(astring_t* body, const querystring_t* qs) {
+    const astring_t* limit_str = querystring_getk(qs, APIKEY_APLIMIT);
+    const astring_t* from_str = querystring_getk(qs, APIKEY_APCONTINUE);
+    size_t limit = (limit_str != NULL) ? strtoul(limit_str->raw, NULL, 10) : 10;
+    size_t from = (from_str != NULL) ? strtoul(from_str->raw + strcspn(from_str->raw, "0123456789"), NULL, 10) : 0;
+    char item[128];
+
+    if (limit == 0 || limit > 500) limit = 500;
+    if (from + limit > config.list_size) limit = (from < config.list_size) ? config.list_size - from : 0;
+
+    astring_append(body, "{\"batchcomplete\":true");
+
+    if (from + limit < config.list_size) {
+        snprintf(item, sizeof(item), ",\"continue\":{\"apcontinue\":\"Page_%zu\",\"continue\":\"-||\"}", from + limit);
+        astring_append(body, item);
+    }
+
+    astring_append(body, ",\"query\":{\"allpages\":[");
+
+    size_t i = 0;
+    for (; i < limit; i++) {
+        snprintf(item, sizeof(item), "%s{\"pageid\":%zu,\"ns\":0,\"title\":\"Page_%zu\"}", (i > 0) ? "," : "", 1000 + from + i, from + i);
+        astring_append(body, item);
+    }
+
+    astring_append(body, "]}}");
+}
+
+/**
+ * @brief Build the response to one API call.
+ * 
+ * @internal
+ * 
+ * @return int The HTTP status
+*/
+static int answer(const querystring_t* qs, astring_t* body, astring_t* headers) {
+    const astring_t* action = querystring_getk(qs, APIKEY_ACTION);
+
+    if (config.rate > 0) {
+        int64_t now = now_ns();
+        tokens += config.rate * (double)(now - refilled) / 1e9;
+        if (tokens > config.rate) tokens = config.rate;
+        refilled = now;
+
+        if (tokens < 1.0) {
+            stats.throttled++;
+            astring_append(headers, "Retry-After: 1\r\n");
+            astring_append(body, "{\"error\":{\"code\":\"ratelimited\",\"info\":\"You've exceeded your rate limit.\"}}");
+            return 429;
+        }
+
+        tokens -= 1.0;
+    }
+
+    if (config.maxlag_rate > 0 && querystring_getk(qs, APIKEY_MAXLAG) != NULL && (double)rand() / RAND_MAX < config.maxlag_rate) {
+        char error[256];
+
+        stats.lagged++;
+        snprintf(error, sizeof(error), "Retry-After: %d\r\nX-Database-Lag: %d\r\n", config.lag, config.lag);
+        astring_append(headers, error);
+        snprintf(error, sizeof(error), "{\"error\":{\"code\":\"maxlag\",\"info\":\"Waiting for 10.0.0.1: %d seconds lagged.\",\"host\":\"10.0.0.1\",\"lag\":%d}}", config.lag, config.lag);
+        astring_append(body, error);
+        return 200;
+    }
+
+    if (action == NULL) {
+        stats.errors++;
+        astring_append(body, "{\"error\":{\"code\":\"noaction\",\"info\":\"The \\\"action\\\" parameter must be set.\"}}");
+        return 200;
+    }
+
+    // a fixture for the module, such as query.allpages, wins over one for the action
+    static const apikey_t modules[] = { APIKEY_PROP, APIKEY_LIST, APIKEY_META };
+    char name[256];
+    size_t i = 0;
+
+    for (; i < sizeof(modules) / sizeof(modules[0]); i++) {
+        const astring_t* module = querystring_getk(qs, modules[i]);
+        if (module == NULL) continue;
+
+        int len = snprintf(name, sizeof(name), "%s.%.*s", action->raw, (int)strcspn(module->raw, "|"), module->raw);
+        const astring_t* fixture = (len > 0 && (size_t)len < sizeof(name)) ? find_fixture(name, (size_t)len) : NULL;
+
+        if (fixture != NULL) {
+            stats.fixtures++;
+            astring_appenda(body, fixture);
+            return 200;
+        }
+    }
+
+    const astring_t* fixture = find_fixture(action->raw, action->len);
+    if (fixture != NULL) {
+        stats.fixtures++;
+        astring_appenda(body, fixture);
+        return 200;
+    }
+
+    if (astring_eqs(action, "query")) {
+        const astring_t* titles = querystring_getk(qs, APIKEY_TITLES);
+        const astring_t* list = querystring_getk(qs, APIKEY_LIST);
+
+        if (titles != NULL) answer_pages(body, titles);
+        else if (list != NULL && astring_eqs(list, "allpages")) answer_allpages(body, qs);
+        else astring_append(body, "{\"batchcomplete\":true,\"query\":{}}");
+
+        return 200;
+    }
+
+    stats.errors++;
+    astring_append(body, "{\"error\":{\"code\":\"badvalue\",\"info\":\"Unrecognized value for parameter \\\"action\\\".\"}}");
+    return 200;
+}
+
+/**
+ * @brief Look for a header in the raw header block, case-insensitively.
+ * 
+ * @internal
+*/
+static const char* find_header(const char* head, size_t len, const char* name) {
+    size_t name_len = strlen(name);
+    const char* line = head;
+    const char* end = head + len;
+
+    while (line < end) {
+        const char* eol = memsearch(line, (size_t)(end - line), "\r\n", 2);
+        if (eol == NULL) eol = end;
+
+        if ((size_t)(eol - line) > name_len && strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char* value = line + name_len + 1;
+            while (*value == ' ') value++;
+            return value;
+        }
+
+        line = eol + 2;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Handle the request at the front of the connection's input, if it is complete.
+ * 
+ * @internal
+ * 
+ * @return bool True if a response was produced, false if more input is needed
+*/
+static bool handle_request(mock_conn_t* conn) {
+    const char* head_end = memsearch(conn->in->raw, conn->in->len, "\r\n\r\n", 4);
+    if (head_end == NULL) return false;
+
+    size_t head_len = (size_t)(head_end - conn->in->raw) + 4;
+    const char* length = find_header(conn->in->raw, head_len, "Content-Length");
+    const char* connection = find_header(conn->in->raw, head_len, "Connection");
+    size_t body_len = (length != NULL) ? strtoul(length, NULL, 10) : 0;
+
+    if (head_len + body_len > conn->in->len) return false;
+
+    stats.requests++;
+    conn->close_after = connection != NULL && strncasecmp(connection, "close", 5) == 0;
+
+    // the parameters come from the URL for GET and the form body for POST
+    const char* target = memchr(conn->in->raw, ' ', head_len);
+    const char* params = NULL;
+    size_t params_len = 0;
+
+    if (body_len > 0) {
+        params = conn->in->raw + head_len;
+        params_len = body_len;
+    } else if (target != NULL) {
+        const char* target_end = memchr(target + 1, ' ', head_len - (size_t)(target + 1 - conn->in->raw));
+        const char* query = memchr(target, '?', (target_end != NULL) ? (size_t)(target_end - target) : 0);
+
+        if (query != NULL) {
+            params = query + 1;
+            params_len = (size_t)(target_end - params);
+        }
+    }
+
+    char* buf = malloc(params_len + 1);
+    if (params_len > 0) memcpy(buf, params, params_len);
+    buf[params_len] = '\0';
+
+    querystring_t* qs = querystring_parse(buf, params_len);
+    astring_t* body = astring_new(config.page_bytes + 256);
+    astring_t* headers = astring_new(128);
+    int status = (qs != NULL) ? answer(qs, body, headers) : 400;
+
+    char status_line[256];
+    const char* reason = (status == 200) ? "OK" : (status == 429) ? "Too Many Requests" : "Bad Request";
+    snprintf(status_line, sizeof(status_line),
+        "HTTP/1.1 %d %s\r\nContent-Type: application/json; charset=utf-8\r\nContent-Length: %zu\r\n%s",
+        status, reason, body->len, conn->close_after ? "Connection: close\r\n" : "");
+
+    conn->out->len = 0;
+    conn->out_pos = 0;
+    astring_append(conn->out, status_line);
+    astring_appenda(conn->out, headers);
+    astring_append(conn->out, "\r\n");
+    astring_appenda(conn->out, body);
+
+    int64_t delay = config.latency_ns;
+    if (config.jitter_ns > 0) delay += (int64_t)((double)rand() / RAND_MAX * (double)config.jitter_ns);
+    conn->due = now_ns() + delay;
+
+    // drop the handled request from the input
+    size_t used = head_len + body_len;
+    memmove(conn->in->raw, conn->in->raw + used, conn->in->len - used);
+    conn->in->len -= used;
+
+    querystring_free(qs, true);
+    astring_free(body);
+    astring_free(headers);
+    free(buf);
+    return true;
+}
+
+static void conn_close(int epfd, mock_conn_t* conn) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->open = false;
+    conn->due = 0;
+    conn->in->len = 0;
+    conn->out->len = 0;
+}
+
+/**
+ * @brief Send what is due on a connection, then move on to its next buffered request.
+ * 
+ * @internal
+*/
+static void conn_flush(int epfd, mock_conn_t* conn) {
+    for (;;) {
+        if (conn->due == 0 || conn->due > now_ns()) return;
+
+        while (conn->out_pos < conn->out->len) {
+            ssize_t n = send(conn->fd, conn->out->raw + conn->out_pos, conn->out->len - conn->out_pos, MSG_NOSIGNAL);
+
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                struct epoll_event ev = { .events = EPOLLIN | EPOLLOUT, .data.fd = conn->fd };
+                epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+                return;
+            }
+
+            if (n <= 0) {
+                conn_close(epfd, conn);
+                return;
+            }
+
+            conn->out_pos += (size_t)n;
+        }
+
+        conn->due = 0;
+
+        if (conn->close_after) {
+            conn_close(epfd, conn);
+            return;
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.fd = conn->fd };
+        epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev);
+
+        if (handle_request(conn) == false) return;
+    }
+}
+
+static mock_conn_t* conn_get(int fd) {
+    if ((size_t)fd >= conn_cap) {
+        size_t cap = (conn_cap == 0) ? 1024 : conn_cap;
+        while (cap <= (size_t)fd) cap *= 2;
+
+        mock_conn_t* tmp = realloc(conns, sizeof(mock_conn_t) * cap);
+        if (tmp == NULL) return NULL;
+
+        memset(tmp + conn_cap, 0, sizeof(mock_conn_t) * (cap - conn_cap));
+        conns = tmp;
+        conn_cap = cap;
+    }
+
+    mock_conn_t* conn = &conns[fd];
+    if (conn->in == NULL) {
+        conn->in = astring_new(4096);
+        conn->out = astring_new(config.page_bytes + 1024);
+    }
+
+    return conn;
+}
+
+static void on_readable(int epfd, mock_conn_t* conn) {
+    char buf[16384];
+
+    for (;;) {
+        ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0 || conn->in->len + (size_t)n > MOCK_MAX_REQUEST) {
+            conn_close(epfd, conn);
+            return;
+        }
+
+        astring_appendn(conn->in, buf, (size_t)n);
+    }
+
+    if (conn->due == 0 && handle_request(conn)) conn_flush(epfd, conn);
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --port N          the port to listen on, default %d\n"
+        "  --latency MS      the delay before every response\n"
+        "  --jitter MS       the most random delay added to latency\n"
+        "  --rate QPS        answer 429 beyond this many requests per second\n"
+        "  --maxlag-rate P   answer this fraction of requests carrying maxlag with a maxlag error\n"
+        "  --lag S           the lag and Retry-After of maxlag errors, default %d\n"
+        "  --page-bytes N    the size of generated page content, default %d\n"
+        "  --list-size N     the items in generated lists, default %d\n"
+        "  --fixtures DIR    answer from DIR/<action>.<module>.json or DIR/<action>.json first\n",
+        argv0, MOCK_DEFAULT_PORT, MOCK_DEFAULT_LAG, MOCK_DEFAULT_PAGE_BYTES, MOCK_DEFAULT_LIST_SIZE);
+}
+
+int main(int argc, char** argv) {
+    config.port = MOCK_DEFAULT_PORT;
+    config.lag = MOCK_DEFAULT_LAG;
+    config.page_bytes = MOCK_DEFAULT_PAGE_BYTES;
+    config.list_size = MOCK_DEFAULT_LIST_SIZE;
+
+    int arg = 1;
+    for (; arg < argc; arg++) {
+        const char* next = (arg + 1 < argc) ? argv[arg + 1] : NULL;
+
+        if (strcmp(argv[arg], "--port") == 0 && next != NULL) config.port = atoi(next);
+        else if (strcmp(argv[arg], "--latency") == 0 && next != NULL) config.latency_ns = (int64_t)(atof(next) * 1e6);
+        else if (strcmp(argv[arg], "--jitter") == 0 && next != NULL) config.jitter_ns = (int64_t)(atof(next) * 1e6);
+        else if (strcmp(argv[arg], "--rate") == 0 && next != NULL) config.rate = atof(next);
+        else if (strcmp(argv[arg], "--maxlag-rate") == 0 && next != NULL) config.maxlag_rate = atof(next);
+        else if (strcmp(argv[arg], "--lag") == 0 && next != NULL) config.lag = atoi(next);
+        else if (strcmp(argv[arg], "--page-bytes") == 0 && next != NULL) config.page_bytes = strtoul(next, NULL, 10);
+        else if (strcmp(argv[arg], "--list-size") == 0 && next != NULL) config.list_size = strtoul(next, NULL, 10);
+        else if (strcmp(argv[arg], "--fixtures") == 0 && next != NULL) config.fixtures = next;
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+
+        arg++;
+    }
+
+    if (config.fixtures != NULL && load_fixtures(config.fixtures) == false) {
+        fprintf(stderr, "cannot read fixtures from %s\n", config.fixtures);
+        return 1;
+    }
+
+    page_content = make_content(config.page_bytes);
+    tokens = config.rate;
+    refilled = now_ns();
+    srand(1);
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)config.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (listener < 0 || bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 1024) != 0) {
+        perror("listen");
+        return 1;
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = listener };
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    printf("mockwiki listening on http://127.0.0.1:%d/api.php (%zu fixtures)\n", config.port, fixture_count);
+    fflush(stdout);
+
+    struct epoll_event events[MOCK_EVENTS];
+
+    while (stopping == 0) {
+        // wake for the earliest delayed response, a scan is cheap next to the network
+        int64_t now = now_ns();
+        int64_t next = -1;
+        size_t i = 0;
+
+        for (; i < conn_cap; i++) {
+            if (conns[i].open && conns[i].due > 0 && (next < 0 || conns[i].due < next)) next = conns[i].due;
+        }
+
+        int timeout = (next < 0) ? -1 : (next <= now) ? 0 : (int)((next - now + 999999) / 1000000);
+        int n = epoll_wait(epfd, events, MOCK_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) break;
+
+        int e = 0;
+        for (; e < n; e++) {
+            int fd = events[e].data.fd;
+
+            if (fd == listener) {
+                int client;
+                while ((client = accept(listener, NULL, NULL)) >= 0) {
+                    mock_conn_t* conn = conn_get(client);
+                    if (conn == NULL) {
+                        close(client);
+                        continue;
+                    }
+
+                    fcntl(client, F_SETFL, O_NONBLOCK);
+                    fcntl(client, F_SETFD, FD_CLOEXEC);
+                    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    conn->fd = client;
+                    conn->open = true;
+                    conn->due = 0;
+                    conn->close_after = false;
+
+                    struct epoll_event cev = { .events = EPOLLIN, .data.fd = client };
+                    epoll_ctl(epfd, EPOLL_CTL_ADD, client, &cev);
+                }
+
+                continue;
+            }
+
+            mock_conn_t* conn = &conns[fd];
+            if (conn->open == false) continue;
+
+            if (events[e].events & (EPOLLERR | EPOLLHUP)) conn_close(epfd, conn);
+            else if (events[e].events & EPOLLIN) on_readable(epfd, conn);
+            if (conn->open && (events[e].events & EPOLLOUT)) conn_flush(epfd, conn);
+        }
+
+        for (i = 0; i < conn_cap; i++) {
+            if (conns[i].open && conns[i].due > 0) conn_flush(epfd, &conns[i]);
+        }
+    }
+
+    printf("served %zu requests: %zu rate limited, %zu maxlag, %zu from fixtures, %zu errors\n",
+        stats.requests, stats.throttled, stats.lagged, stats.fixtures, stats.errors);
+
+    size_t i = 0;
+    for (; i < conn_cap; i++) {
+        if (conns[i].open) close(conns[i].fd);
+        astring_free(conns[i].in);
+        astring_free(conns[i].out);
+    }
+
+    for (i = 0; i < fixture_count; i++) {
+        astring_free(fixtures[i].name);
+        astring_free(fixtures[i].body);
+    }
+
+    free(conns);
+    free(fixtures);
+    astring_free(page_content);
+    close(epfd);
+    close(listener);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2023 Abish Young
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "mpmc.h"
+
+/*
+ * Hammers an mpmc_t from several producers and consumers at once and checks
+ * that every item comes out exactly once. The ring is kept small so it is
+ * full and empty often, which is where the sequence numbers matter. Build it
+ * with -DCURLYBOT_SANITIZE=thread, or on its own as the stress target does,
+ * so ThreadSanitizer checks the memory ordering as well.
+ */
+
+#define STRESS_DEFAULT_ITEMS 100000
+#define STRESS_CAPACITY 64
+#define STRESS_BATCH 7
+
+typedef struct {
+    mpmc_t* queue;
+    size_t items;               /**< The items each producer pushes. */
+    unsigned char* seen;        /**< How often each item was popped, updated atomically. */
+    int done;                   /**< Set once every producer has finished, updated atomically. */
+} stress_t;
+
+typedef struct {
+    stress_t* stress;
+    size_t id;
+} stress_thread_t;
+
+/**
+ * Odd producers push runs of up to STRESS_BATCH items with mpmc_pushn, even
+ * ones push one at a time. Items are their index plus one, so none is NULL.
+ */
+static void* produce(void* arg) {
+    stress_thread_t* thread = arg;
+    stress_t* stress = thread->stress;
+    size_t base = thread->id * stress->items;
+    size_t i = 0;
+    void* batch[STRESS_BATCH];
+
+    while (i < stress->items) {
+        size_t want = (thread->id % 2 == 1) ? 1 + i % STRESS_BATCH : 1;
+        size_t k = 0;
+
+        if (want > stress->items - i) want = stress->items - i;
+        for (; k < want; k++) batch[k] = (void*)(uintptr_t)(base + i + k + 1);
+
+        size_t pushed = mpmc_pushn(stress->queue, batch, want);
+        if (pushed == 0) sched_yield();
+        i += pushed;
+    }
+
+    return NULL;
+}
+
+/** Odd consumers pop with mpmc_popn, even ones with mpmc_pop. */
+static void* consume(void* arg) {
+    stress_thread_t* thread = arg;
+    stress_t* stress = thread->stress;
+    void* batch[STRESS_BATCH];
+
+    for (;;) {
+        size_t n = 0;
+
+        if (thread->id % 2 == 1) n = mpmc_popn(stress->queue, batch, STRESS_BATCH);
+        else if ((batch[0] = mpmc_pop(stress->queue)) != NULL) n = 1;
+
+        if (n == 0) {
+            // the queue can only stay empty once every producer is done
+            if (__atomic_load_n(&stress->done, __ATOMIC_ACQUIRE) && mpmc_size(stress->queue) == 0) return NULL;
+            sched_yield();
+            continue;
+        }
+
+        size_t k = 0;
+        for (; k < n; k++) __atomic_add_fetch(&stress->seen[(uintptr_t)batch[k] - 1], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/** Runs one round and reports the items lost or popped more than once. */
+static bool run(size_t producers, size_t consumers, size_t items) {
+    stress_t stress;
+    pthread_t* threads = calloc(producers + consumers, sizeof(pthread_t));
+    stress_thread_t* args = calloc(producers + consumers, sizeof(stress_thread_t));
+    size_t total = producers * items;
+    size_t i = 0;
+
+    memset(&stress, 0, sizeof(stress));
+    stress.queue = mpmc_new(STRESS_CAPACITY);
+    stress.items = items;
+    stress.seen = calloc(total, 1);
+    if (threads == NULL || args == NULL || stress.queue == NULL || stress.seen == NULL) {
+        fprintf(stderr, "cannot set up the queue\n");
+        return false;
+    }
+
+    for (i = 0; i < producers + consumers; i++) {
+        args[i].stress = &stress;
+        args[i].id = (i < producers) ? i : i - producers;
+        pthread_create(&threads[i], NULL, (i < producers) ? produce : consume, &args[i]);
+    }
+
+    for (i = 0; i < producers; i++) pthread_join(threads[i], NULL);
+    __atomic_store_n(&stress.done, 1, __ATOMIC_RELEASE);
+    for (; i < producers + consumers; i++) pthread_join(threads[i], NULL);
+
+    size_t lost = 0;
+    size_t duplicated = 0;
+    for (i = 0; i < total; i++) {
+        if (stress.seen[i] == 0) lost++;
+        if (stress.seen[i] > 1) duplicated++;
+    }
+
+    printf("%zu producers, %zu consumers, %zu items: %zu lost, %zu duplicated\n", producers, consumers, total, lost, duplicated);
+
+    mpmc_free(stress.queue);
+    free(stress.seen);
+    free(threads);
+    free(args);
+    return lost == 0 && duplicated == 0;
+}
+
+int main(int argc, char** argv) {
+    static const size_t rounds[][2] = { { 1, 1 }, { 1, 4 }, { 4, 1 }, { 4, 4 }, { 8, 8 } };
+    size_t items = (argc > 1) ? strtoul(argv[1], NULL, 10) : STRESS_DEFAULT_ITEMS;
+    bool ok = true;
+    size_t i = 0;
+
+    if (items == 0) {
+        fprintf(stderr, "usage: %s [items per producer]\n", argv[0]);
+        return 2;
+    }
+
+    for (; i < sizeof(rounds) / sizeof(rounds[0]); i++) {
+        if (run(rounds[i][0], rounds[i][1], items) == false) ok = false;
+    }
+
+    return ok ? 0 : 1;
+}